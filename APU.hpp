@@ -0,0 +1,827 @@
+#ifndef APU_HPP_INCLUDED
+#define APU_HPP_INCLUDED
+
+#include<cstdint>
+#include"Bus.hpp"
+#include"RingBuffer.hpp"
+#include"Blip.hpp"
+#include"SaveState.hpp"
+
+#define CPU_CLOCK 1789773
+#define AUDIO_BUFFER_SIZE 16384
+
+static constexpr std::uint8_t LENGTH_TABLE[32] = {
+    10, 254, 20, 2, 40, 4, 80, 6, 160, 8, 60, 10, 14, 12, 26, 14,
+    12, 16, 24, 18, 48, 20, 96, 22, 192, 24, 72, 26, 16, 28, 32, 30
+};
+
+static constexpr std::uint8_t DUTY_TABLE[4] = {
+    0b01000000, 0b01100000, 0b01111000, 0b10011111
+};
+
+static constexpr std::uint8_t TRIANGLE_TABLE[32] = {
+    15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15
+};
+
+//periods in cpu cycles, NTSC
+static constexpr std::uint16_t NOISE_TABLE[16] = {
+    4, 8, 16, 32, 64, 96, 128, 160, 202, 254, 380, 508, 762, 1016, 2034, 4068
+};
+
+static constexpr std::uint16_t DMC_TABLE[16] = {
+    428, 380, 340, 320, 286, 254, 226, 214, 190, 160, 142, 128, 106, 84, 72, 54
+};
+
+//runs a divider that reloads from reload after reaching 0 for n cycles at once,
+//returns how many times it reached 0
+inline std::uint32_t advanceTimer(std::uint16_t& timer, std::uint32_t reload, std::uint32_t n){
+    if(n <= timer){
+        timer -= n;
+        return 0;
+    }
+    n -= timer + 1;
+    timer = reload - n % (reload + 1);
+    return 1 + n / (reload + 1);
+}
+
+//volume envelope shared by the pulse and noise channels, clocked every quarter frame
+struct Envelope {
+    bool start;
+    bool loop;
+    bool constant;
+    std::uint8_t period;        //also the constant volume
+    std::uint8_t divider;
+    std::uint8_t decay;
+
+    void write(std::uint8_t value){
+        loop = value & 0b00100000;
+        constant = value & 0b00010000;
+        period = value & 0x0f;
+    }
+
+    void clock(){
+        if(start){
+            start = false;
+            decay = 15;
+            divider = period;
+        }else if(divider == 0){
+            divider = period;
+            if(decay > 0){
+                decay--;
+            }else if(loop){
+                decay = 15;
+            }
+        }else{
+            divider--;
+        }
+    }
+
+    std::uint8_t volume() const{
+        return constant ? period : decay;
+    }
+};
+
+struct Pulse {
+    bool second;                //pulse 2 negates the sweep differently
+    bool enabled;
+    std::uint8_t duty;
+    std::uint8_t step;
+    std::uint16_t period;       //11 bit timer reload
+    std::uint16_t timer;        //counts cpu cycles
+    std::uint8_t length;
+    Envelope envelope;
+    bool sweep_enabled;
+    bool sweep_negate;
+    bool sweep_reload;
+    std::uint8_t sweep_period;
+    std::uint8_t sweep_shift;
+    std::uint8_t sweep_divider;
+
+    std::uint16_t sweepTarget() const{
+        std::uint16_t change = period >> sweep_shift;
+        if(sweep_negate){
+            return period - change - (second ? 0 : 1);
+        }
+        return period + change;
+    }
+
+    void write(int reg, std::uint8_t value){
+        switch(reg){
+            case 0:
+                duty = value >> 6;
+                envelope.write(value);
+                break;
+            case 1:
+                sweep_enabled = value & 0b10000000;
+                sweep_period = (value >> 4) & 0b111;
+                sweep_negate = value & 0b00001000;
+                sweep_shift = value & 0b111;
+                sweep_reload = true;
+                break;
+            case 2:
+                period = (period & 0x700) | value;
+                break;
+            case 3:
+                period = (period & 0x0ff) | ((value & 0b111) << 8);
+                if(enabled){
+                    length = LENGTH_TABLE[value >> 3];
+                }
+                step = 0;
+                envelope.start = true;
+                break;
+        }
+    }
+
+    void advance(std::uint32_t n){
+        step = (step + advanceTimer(timer, period * 2 + 1, n)) & 0b111;
+    }
+
+    //false while the output is stuck at 0 whatever the sequencer does
+    bool audible() const{
+        return length > 0 && period >= 8 && sweepTarget() <= 0x7ff && envelope.volume() > 0;
+    }
+
+    void clockLength(){
+        if(!envelope.loop && length > 0){
+            length--;
+        }
+    }
+
+    void clockSweep(){
+        if(sweep_divider == 0 && sweep_enabled && sweep_shift > 0 && period >= 8 && sweepTarget() <= 0x7ff){
+            period = sweepTarget();
+        }
+        if(sweep_divider == 0 || sweep_reload){
+            sweep_divider = sweep_period;
+            sweep_reload = false;
+        }else{
+            sweep_divider--;
+        }
+    }
+
+    std::uint8_t output() const{
+        if(length == 0 || period < 8 || sweepTarget() > 0x7ff || !(DUTY_TABLE[duty] & (0b10000000 >> step))){
+            return 0;
+        }
+        return envelope.volume();
+    }
+};
+
+struct Triangle {
+    bool enabled;
+    bool control;               //also halts the length counter
+    bool linear_reload;
+    std::uint8_t linear_period;
+    std::uint8_t linear;
+    std::uint8_t step;
+    std::uint16_t period;
+    std::uint16_t timer;
+    std::uint8_t length;
+
+    void write(int reg, std::uint8_t value){
+        switch(reg){
+            case 0:
+                control = value & 0b10000000;
+                linear_period = value & 0x7f;
+                break;
+            case 2:
+                period = (period & 0x700) | value;
+                break;
+            case 3:
+                period = (period & 0x0ff) | ((value & 0b111) << 8);
+                if(enabled){
+                    length = LENGTH_TABLE[value >> 3];
+                }
+                linear_reload = true;
+                break;
+        }
+    }
+
+    void advance(std::uint32_t n){
+        std::uint32_t steps = advanceTimer(timer, period, n);
+        if(audible()){
+            step = (step + steps) & 31;
+        }
+    }
+
+    //the sequencer only moves when this is true, otherwise the level holds
+    bool audible() const{
+        return length > 0 && linear > 0 && period >= 2;
+    }
+
+    void clockLinear(){
+        if(linear_reload){
+            linear = linear_period;
+        }else if(linear > 0){
+            linear--;
+        }
+        if(!control){
+            linear_reload = false;
+        }
+    }
+
+    void clockLength(){
+        if(!control && length > 0){
+            length--;
+        }
+    }
+
+    std::uint8_t output() const{
+        return TRIANGLE_TABLE[step];
+    }
+};
+
+struct Noise {
+    bool enabled;
+    bool mode;                  //short 93 step sequence
+    std::uint16_t shift;        //15 bit lfsr
+    std::uint16_t period;
+    std::uint16_t timer;
+    std::uint8_t length;
+    Envelope envelope;
+
+    void write(int reg, std::uint8_t value){
+        switch(reg){
+            case 0:
+                envelope.write(value);
+                break;
+            case 2:
+                mode = value & 0b10000000;
+                period = NOISE_TABLE[value & 0x0f];
+                break;
+            case 3:
+                if(enabled){
+                    length = LENGTH_TABLE[value >> 3];
+                }
+                envelope.start = true;
+                break;
+        }
+    }
+
+    void advance(std::uint32_t n){
+        std::uint32_t steps = advanceTimer(timer, period - 1, n);
+        for(std::uint32_t i = 0; i < steps; i++){
+            std::uint16_t feedback = (shift ^ (shift >> (mode ? 6 : 1))) & 1;
+            shift = (shift >> 1) | (feedback << 14);
+        }
+    }
+
+    bool audible() const{
+        return length > 0 && envelope.volume() > 0;
+    }
+
+    void clockLength(){
+        if(!envelope.loop && length > 0){
+            length--;
+        }
+    }
+
+    std::uint8_t output() const{
+        if(length == 0 || (shift & 1)){
+            return 0;
+        }
+        return envelope.volume();
+    }
+};
+
+//delta modulation channel, plays 1 bit samples fetched from cpu memory
+struct DMC {
+    bool irq_enabled;
+    bool loop;
+    std::uint16_t period;
+    std::uint16_t timer;
+    std::uint8_t level;         //7 bit output
+    std::uint16_t sample_adress;
+    std::uint16_t sample_length;
+    std::uint16_t adress;       //next byte to fetch
+    std::uint16_t remaining;    //bytes left to fetch
+    std::uint8_t buffer;
+    bool buffer_empty;
+    std::uint8_t shift;
+    std::uint8_t bits;
+    bool silence;
+
+    void restart(){
+        adress = sample_adress;
+        remaining = sample_length;
+    }
+
+    //false once the output unit has nothing left to play or fetch
+    bool active() const{
+        return !silence || !buffer_empty || remaining > 0;
+    }
+
+    std::uint8_t output() const{
+        return level;
+    }
+};
+
+//audio processing unit of the 2A03
+//clocked from the cpu cycle counter, samples go into a lock free ring buffer so the
+//emulation thread never waits on whoever plays or records them
+//the channels are stepped from one timer event to the next and only level changes reach
+//the band limited BlipBuffer, building with APU_NAIVE_MIX clocks every cycle and averages instead
+class APU {
+private:
+    Bus& bus;
+    Pulse pulse1;
+    Pulse pulse2;
+    Triangle triangle;
+    Noise noise;
+    DMC dmc;
+
+    //frame counter
+    bool five_step;
+    bool irq_inhibit;
+    bool frame_irq;
+    std::uint32_t frame_cycle;      //cpu cycles since the sequence started
+
+    std::uint64_t cycle;            //cpu cycle the apu has reached
+    std::uint64_t next_event;       //first cycle where the output, an irq or a dma could change
+
+    //mixer lookup tables from the nesdev wiki's non linear formulas
+    float pulse_table[31];
+    float tnd_table[203];
+
+    std::uint32_t sample_rate;
+#ifdef APU_NAIVE_MIX
+    DcBlocker dc_blocker;
+    //a sample is the average of the mixer over its cpu cycles
+    std::uint32_t sample_phase;     //counts up by sample_rate every cycle
+    float sample_sum;
+    std::uint32_t sample_count;
+#else
+    BlipBuffer blip;
+    std::uint64_t blip_start;       //cpu cycle of clock 0 in the blip frame
+    float level;                    //mixer output already handed to the blip buffer
+#endif
+    RingBuffer<std::int16_t, AUDIO_BUFFER_SIZE> samples;
+    std::uint64_t dropped;          //samples lost because the consumer fell behind
+
+    void quarterFrame(){
+        pulse1.envelope.clock();
+        pulse2.envelope.clock();
+        noise.envelope.clock();
+        triangle.clockLinear();
+    }
+
+    void halfFrame(){
+        pulse1.clockLength();
+        pulse2.clockLength();
+        triangle.clockLength();
+        noise.clockLength();
+        pulse1.clockSweep();
+        pulse2.clockSweep();
+    }
+
+    //runs whatever the frame counter does on frame_cycle
+    void frameStep(){
+        switch(frame_cycle){
+            case 7457:
+                quarterFrame();
+                break;
+            case 14913:
+                quarterFrame();
+                halfFrame();
+                break;
+            case 22371:
+                quarterFrame();
+                break;
+            case 29829:
+                if(!five_step){
+                    quarterFrame();
+                    halfFrame();
+                    if(!irq_inhibit){
+                        frame_irq = true;
+                        bus.setIrq(IRQ_APU_FRAME, true);
+                    }
+                }
+                break;
+            case 29830:
+                if(!five_step){
+                    frame_cycle = 0;
+                }
+                break;
+            case 37281:
+                quarterFrame();
+                halfFrame();
+                break;
+            case 37282:
+                frame_cycle = 0;
+                break;
+        }
+    }
+
+    //cycles until frame_cycle hits the next case of frameStep
+    std::uint32_t nextFrameStep() const{
+        static constexpr std::uint32_t steps[7] = {7457, 14913, 22371, 29829, 29830, 37281, 37282};
+        for(std::uint32_t step : steps){
+            if(step > frame_cycle){
+                return step - frame_cycle;
+            }
+        }
+        return 1;
+    }
+
+    //refills the sample buffer from cpu memory
+    void fillDmc(){
+        if(dmc.buffer_empty && dmc.remaining > 0){
+            dmc.buffer = bus.read(dmc.adress);
+            dmc.buffer_empty = false;
+            dmc.adress = dmc.adress == 0xffff ? 0x8000 : dmc.adress + 1;
+            dmc.remaining--;
+            if(dmc.remaining == 0){
+                if(dmc.loop){
+                    dmc.restart();
+                }else if(dmc.irq_enabled){
+                    bus.setIrq(IRQ_APU_DMC, true);
+                }
+            }
+        }
+    }
+
+    //one tick of the output unit, every time the dmc timer reaches 0
+    void clockDmcOutput(){
+        if(!dmc.silence){
+            if(dmc.shift & 1){
+                if(dmc.level <= 125){
+                    dmc.level += 2;
+                }
+            }else if(dmc.level >= 2){
+                dmc.level -= 2;
+            }
+            dmc.shift >>= 1;
+        }
+        if(dmc.bits > 0){
+            dmc.bits--;
+        }
+        if(dmc.bits == 0){
+            dmc.bits = 8;
+            if(dmc.buffer_empty){
+                dmc.silence = true;
+            }else{
+                dmc.silence = false;
+                dmc.shift = dmc.buffer;
+                dmc.buffer_empty = true;
+                fillDmc();
+            }
+        }
+    }
+
+    void advanceDmc(std::uint32_t n){
+        std::uint32_t steps = advanceTimer(dmc.timer, dmc.period - 1, n);
+        for(std::uint32_t i = 0; i < steps; i++){
+            clockDmcOutput();
+        }
+    }
+
+    float mix() const{
+        return pulse_table[pulse1.output() + pulse2.output()]
+             + tnd_table[3 * triangle.output() + 2 * noise.output() + dmc.output()];
+    }
+
+    void push(std::int16_t sample){
+        if(!samples.push(sample)){
+            dropped++;
+        }
+    }
+
+#ifdef APU_NAIVE_MIX
+    void clock(){
+        frame_cycle++;
+        frameStep();
+        pulse1.advance(1);
+        pulse2.advance(1);
+        triangle.advance(1);
+        noise.advance(1);
+        advanceDmc(1);
+
+        sample_sum += mix();
+        sample_count++;
+        sample_phase += sample_rate;
+        if(sample_phase >= CPU_CLOCK){
+            sample_phase -= CPU_CLOCK;
+            push(dc_blocker.process(sample_sum / sample_count, 32767.0f));
+            sample_sum = 0;
+            sample_count = 0;
+        }
+    }
+#else
+    //hands a change of the mixer output to the blip buffer
+    void updateLevel(){
+        float value = mix();
+        if(value != level){
+            blip.addDelta(cycle - blip_start, value - level);
+            level = value;
+        }
+    }
+
+    //cycles to the next point where the output could change, at most n
+    std::uint32_t nextEvent(std::uint32_t n) const{
+        //silent channels are skipped over, their timers still advance
+        if(pulse1.audible() && pulse1.timer + 1u < n){
+            n = pulse1.timer + 1u;
+        }
+        if(pulse2.audible() && pulse2.timer + 1u < n){
+            n = pulse2.timer + 1u;
+        }
+        if(triangle.audible() && triangle.timer + 1u < n){
+            n = triangle.timer + 1u;
+        }
+        if(noise.audible() && noise.timer + 1u < n){
+            n = noise.timer + 1u;
+        }
+        if(dmc.active() && dmc.timer + 1u < n){
+            n = dmc.timer + 1u;
+        }
+        return n;
+    }
+
+    //moves every channel to the next event, at most n cycles
+    void step(std::uint32_t n){
+        std::uint32_t frame = nextFrameStep();
+        n = nextEvent(frame < n ? frame : n);
+
+        pulse1.advance(n);
+        pulse2.advance(n);
+        triangle.advance(n);
+        noise.advance(n);
+        advanceDmc(n);
+        frame_cycle += n;
+        cycle += n;
+        if(n == frame){
+            frameStep();
+        }
+        updateLevel();
+    }
+
+    void scheduleNext(){
+        std::uint32_t frame = nextFrameStep();
+        next_event = cycle + nextEvent(frame);
+    }
+
+    //moves the finished part of the blip buffer into the ring buffer
+    void flush(){
+        blip.endFrame(cycle - blip_start);
+        blip_start = cycle;
+        std::int16_t out[256];
+        std::size_t count;
+        while((count = blip.readSamples(out, 256, 32767.0f)) > 0){
+            for(std::size_t i = 0; i < count; i++){
+                push(out[i]);
+            }
+        }
+    }
+#endif
+
+public:
+    APU(Bus& bus) : bus(bus)
+#ifndef APU_NAIVE_MIX
+        , blip(AUDIO_BUFFER_SIZE)
+#endif
+    {
+        pulse_table[0] = 0;
+        for(int i = 1; i < 31; i++){
+            pulse_table[i] = 95.52f / (8128.0f / i + 100.0f);
+        }
+        tnd_table[0] = 0;
+        for(int i = 1; i < 203; i++){
+            tnd_table[i] = 163.67f / (24329.0f / i + 100.0f);
+        }
+        setSampleRate(48000);
+        reset(0);
+    }
+
+    APU(const APU&) = delete;
+    APU& operator=(const APU&) = delete;
+
+    //the apu starts counting from the given cpu cycle
+    void reset(std::uint64_t cpu_cycle){
+        pulse1 = Pulse();
+        pulse2 = Pulse();
+        pulse2.second = true;
+        triangle = Triangle();
+        noise = Noise();
+        noise.shift = 1;
+        noise.period = NOISE_TABLE[0];
+        dmc = DMC();
+        dmc.period = DMC_TABLE[0];
+        dmc.buffer_empty = true;
+        dmc.bits = 8;
+        dmc.silence = true;
+        five_step = false;
+        irq_inhibit = false;
+        frame_irq = false;
+        frame_cycle = 0;
+        cycle = cpu_cycle;
+#ifdef APU_NAIVE_MIX
+        dc_blocker.clear();
+        sample_phase = 0;
+        sample_sum = 0;
+        sample_count = 0;
+#else
+        blip.clear();
+        blip_start = cpu_cycle;
+        level = 0;
+        scheduleNext();
+#endif
+        dropped = 0;
+        bus.setIrq(IRQ_APU_FRAME | IRQ_APU_DMC, false);
+    }
+
+    //host output rate, the 1.79MHz channel output is resampled to it
+    void setSampleRate(std::uint32_t rate){
+        sample_rate = rate;
+#ifndef APU_NAIVE_MIX
+        blip.setRates(CPU_CLOCK, rate);
+#endif
+    }
+
+    std::uint32_t getSampleRate() const{
+        return sample_rate;
+    }
+
+    //brings the apu up to the given cpu cycle, needed before touching its registers
+    void sync(std::uint64_t cpu_cycle){
+#ifdef APU_NAIVE_MIX
+        while(cycle < cpu_cycle){
+            clock();
+            cycle++;
+        }
+#else
+        while(cycle < cpu_cycle){
+            std::uint64_t left = cpu_cycle - cycle;
+            step(left > 0xffff ? 0xffff : (std::uint32_t)left);
+        }
+        //about 2.5ms of audio per flush, small enough to keep latency down
+        if(cycle - blip_start >= 4096){
+            flush();
+        }
+        scheduleNext();
+#endif
+    }
+
+    //called as the cpu goes, does nothing until something can actually happen
+    void run(std::uint64_t cpu_cycle){
+#ifndef APU_NAIVE_MIX
+        if(cpu_cycle < next_event){
+            return;
+        }
+#endif
+        sync(cpu_cycle);
+    }
+
+    //channels, frame counter and the cycle reached. samples already made stay in the ring buffer
+    void saveState(StateWriter& state) const{
+        state.put(pulse1);
+        state.put(pulse2);
+        state.put(triangle);
+        state.put(noise);
+        state.put(dmc);
+        state.put(five_step);
+        state.put(irq_inhibit);
+        state.put(frame_irq);
+        state.put(frame_cycle);
+        state.put(cycle);
+    }
+
+    void loadState(StateReader& state){
+#ifndef APU_NAIVE_MIX
+        //hand over the output up to now, the restored level then starts as a step at the new cycle
+        flush();
+#endif
+        state.get(pulse1);
+        state.get(pulse2);
+        state.get(triangle);
+        state.get(noise);
+        state.get(dmc);
+        state.get(five_step);
+        state.get(irq_inhibit);
+        state.get(frame_irq);
+        state.get(frame_cycle);
+        state.get(cycle);
+#ifndef APU_NAIVE_MIX
+        blip_start = cycle;
+        updateLevel();
+        scheduleNext();
+#endif
+    }
+
+    //cpu cycle by which sync has to be called so nothing the cpu can see happens late: the next
+    //frame counter step (frame irq) or dmc clock (sample fetch, dmc irq). the output between
+    //them is made up whenever sync is called
+    std::uint64_t nextSyncCycle() const{
+        std::uint64_t next = cycle + nextFrameStep();
+        if(dmc.active() && cycle + dmc.timer + 1 < next){
+            next = cycle + dmc.timer + 1;
+        }
+        return next;
+    }
+
+    //0x4000-0x4013, 0x4015 and 0x4017
+    void writeRegister(std::uint16_t adress, std::uint8_t value){
+        int reg = adress & 0b11;
+        switch(adress){
+            case 0x4000: case 0x4001: case 0x4002: case 0x4003:
+                pulse1.write(reg, value);
+                break;
+            case 0x4004: case 0x4005: case 0x4006: case 0x4007:
+                pulse2.write(reg, value);
+                break;
+            case 0x4008: case 0x400a: case 0x400b:
+                triangle.write(reg, value);
+                break;
+            case 0x400c: case 0x400e: case 0x400f:
+                noise.write(reg, value);
+                break;
+            case 0x4010:
+                dmc.irq_enabled = value & 0b10000000;
+                dmc.loop = value & 0b01000000;
+                dmc.period = DMC_TABLE[value & 0x0f];
+                if(!dmc.irq_enabled){
+                    bus.setIrq(IRQ_APU_DMC, false);
+                }
+                break;
+            case 0x4011:
+                dmc.level = value & 0x7f;
+                break;
+            case 0x4012:
+                dmc.sample_adress = 0xc000 | (value << 6);
+                break;
+            case 0x4013:
+                dmc.sample_length = (value << 4) | 1;
+                break;
+            case 0x4015:
+                pulse1.enabled = value & 0b00001;
+                pulse2.enabled = value & 0b00010;
+                triangle.enabled = value & 0b00100;
+                noise.enabled = value & 0b01000;
+                if(!pulse1.enabled){
+                    pulse1.length = 0;
+                }
+                if(!pulse2.enabled){
+                    pulse2.length = 0;
+                }
+                if(!triangle.enabled){
+                    triangle.length = 0;
+                }
+                if(!noise.enabled){
+                    noise.length = 0;
+                }
+                if(!(value & 0b10000)){
+                    dmc.remaining = 0;
+                }else if(dmc.remaining == 0){
+                    dmc.restart();
+                    fillDmc();
+                }
+                bus.setIrq(IRQ_APU_DMC, false);
+                break;
+            case 0x4017:
+                five_step = value & 0b10000000;
+                irq_inhibit = value & 0b01000000;
+                if(irq_inhibit){
+                    frame_irq = false;
+                    bus.setIrq(IRQ_APU_FRAME, false);
+                }
+                frame_cycle = 0;
+                //the 5 step mode clocks everything right away
+                if(five_step){
+                    quarterFrame();
+                    halfFrame();
+                }
+                break;
+        }
+#ifndef APU_NAIVE_MIX
+        updateLevel();
+        scheduleNext();
+#endif
+    }
+
+    //0x4015
+    std::uint8_t readStatus(){
+        std::uint8_t value = 0;
+        value = value | (pulse1.length > 0 ? 0b00000001 : 0);
+        value = value | (pulse2.length > 0 ? 0b00000010 : 0);
+        value = value | (triangle.length > 0 ? 0b00000100 : 0);
+        value = value | (noise.length > 0 ? 0b00001000 : 0);
+        value = value | (dmc.remaining > 0 ? 0b00010000 : 0);
+        value = value | (frame_irq ? 0b01000000 : 0);
+        value = value | (bus.getIrq() & IRQ_APU_DMC ? 0b10000000 : 0);
+        //reading clears the frame interrupt
+        frame_irq = false;
+        bus.setIrq(IRQ_APU_FRAME, false);
+        return value;
+    }
+
+    //the consumer side of this buffer may be drained from another thread
+    RingBuffer<std::int16_t, AUDIO_BUFFER_SIZE>& getSamples(){
+        return samples;
+    }
+
+    std::uint64_t getDroppedSamples() const{
+        return dropped;
+    }
+};
+
+#endif // APU_HPP_INCLUDED
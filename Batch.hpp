@@ -0,0 +1,90 @@
+#ifndef BATCH_HPP_INCLUDED
+#define BATCH_HPP_INCLUDED
+
+#include<chrono>
+#include<cstdint>
+#include<memory>
+#include<string>
+#include<vector>
+#include"CPU.hpp"
+#include"Movie.hpp"
+#include"ThreadPool.hpp"
+
+//one emulator to run headless, from power on
+struct BatchJob {
+    std::shared_ptr<const Rom> rom;         //opened once with Rom::openShared, every job can use the same one
+    std::shared_ptr<const Movie> movie;     //input for every frame, null runs with nothing held
+    std::uint64_t frames;
+    bool jit;                               //use the recompiler where it is available
+    TraceBuffer* trace;                     //records the run into it when set, one buffer per job
+    bool trace_memory;                      //reads and writes go into the trace too
+};
+
+struct BatchResult {
+    RomError error;             //nothing below is set unless this is None
+    std::uint64_t frames;
+    std::uint64_t instructions;
+    double seconds;             //host wall time of this instance alone
+    bool jammed;
+    std::uint64_t hash;         //of ram and the last frame, equal runs give equal hashes
+};
+
+//fnv-1a over what a run leaves behind, to compare instances and builds
+inline std::uint64_t consoleHash(CPU& cpu){
+    std::uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](std::uint64_t value){
+        hash = (hash ^ value) * 1099511628211ull;
+    };
+    mix(cpu.getCycles());
+    mix(cpu.getStatus());
+    const std::uint8_t* ram = cpu.getBus().getRam();
+    for(int i = 0; i < RAM_SIZE; i++){
+        mix(ram[i]);
+    }
+    const std::uint32_t* pixels = cpu.getPPU().getFramebuffer();
+    for(int i = 0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i++){
+        mix(pixels[i]);
+    }
+    return hash;
+}
+
+//runs one job on the calling thread. a console only writes its own members and the rom is
+//read only, so any number of these can run at once on different threads
+inline BatchResult runJob(const BatchJob& job){
+    BatchResult result = {};
+    auto start = std::chrono::steady_clock::now();
+    auto cpu = std::make_unique<CPU>();
+    result.error = cpu->load(job.rom);
+    if(result.error != RomError::None){
+        return result;
+    }
+    cpu->setJit(job.jit);
+    cpu->setTrace(job.trace, job.trace_memory);
+    for(std::uint64_t frame = 0; frame < job.frames && !result.jammed; frame++){
+        if(job.movie){
+            cpu->setButtons(0, job.movie->getButtons(frame, 0));
+            cpu->setButtons(1, job.movie->getButtons(frame, 1));
+        }
+        RunSummary summary = cpu->runFrames(1);
+        result.frames += summary.frames;
+        result.instructions += summary.instructions;
+        result.jammed = summary.jammed;
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.hash = consoleHash(*cpu);
+    return result;
+}
+
+//runs every job on the pool and waits for all of them, results are in job order
+inline std::vector<BatchResult> runBatch(const std::vector<BatchJob>& jobs, ThreadPool& pool){
+    std::vector<BatchResult> results(jobs.size());
+    for(std::size_t i = 0; i < jobs.size(); i++){
+        pool.submit([&jobs, &results, i]{
+            results[i] = runJob(jobs[i]);
+        });
+    }
+    pool.wait();
+    return results;
+}
+
+#endif // BATCH_HPP_INCLUDED
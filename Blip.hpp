@@ -0,0 +1,141 @@
+#ifndef BLIP_HPP_INCLUDED
+#define BLIP_HPP_INCLUDED
+
+#include<algorithm>
+#include<bit>
+#include<cmath>
+#include<cstdint>
+#include<cstring>
+#include<vector>
+
+#define BLIP_PHASES 32          //sub sample positions a step can land on, a power of two
+#define BLIP_TAPS 16            //length of the band limited step, in output samples
+
+static_assert(std::has_single_bit((unsigned)BLIP_PHASES), "the phase is taken from the top bits of the position");
+#define BLIP_PHASE_BITS std::countr_zero((unsigned)BLIP_PHASES)
+
+//one pole high pass that takes the dc offset off the mixer output and scales it to 16 bit,
+//the blip buffer and the APU_NAIVE_MIX path both end in it
+class DcBlocker {
+private:
+    float dc;                   //running average removed from the signal
+
+public:
+    DcBlocker(){
+        clear();
+    }
+
+    void clear(){
+        dc = 0;
+    }
+
+    std::int16_t process(float value, float volume){
+        dc += (value - dc) * (1.0f / 1024);
+        float sample = (value - dc) * volume;
+        if(sample > 32767.0f){
+            sample = 32767.0f;
+        }else if(sample < -32768.0f){
+            sample = -32768.0f;
+        }
+        return (std::int16_t)sample;
+    }
+};
+
+//band limited step buffer
+//a signal is described by the times and sizes of its level changes, each change is
+//drawn into the output as a band limited step so nothing above the output nyquist
+//aliases back in. work is done per change instead of per input clock, a channel
+//that holds its level costs nothing
+class BlipBuffer {
+private:
+    float kernel[BLIP_PHASES][BLIP_TAPS];
+    std::vector<float> buffer;  //differences of the output, summed up when read
+    std::uint64_t factor;       //output samples per input clock, 32.32 fixed point
+    std::uint64_t offset;       //output position of clock 0 of the current frame, 32.32
+    float integrator;
+    DcBlocker dc_blocker;
+
+    //windowed sinc impulses, one per phase, each summing to 1 so a step of delta ends exactly at delta
+    void makeKernel(double cutoff){
+        const double pi = 3.14159265358979323846;
+        for(int phase = 0; phase < BLIP_PHASES; phase++){
+            double sum = 0;
+            double taps[BLIP_TAPS];
+            for(int i = 0; i < BLIP_TAPS; i++){
+                double x = i - (BLIP_TAPS / 2 - 1) - (double)phase / BLIP_PHASES;
+                double sinc = x == 0 ? 1.0 : std::sin(pi * cutoff * x) / (pi * cutoff * x);
+                //blackman window over the whole kernel width
+                double w = (x + BLIP_TAPS / 2) / BLIP_TAPS;
+                double window = 0.42 - 0.5 * std::cos(2 * pi * w) + 0.08 * std::cos(4 * pi * w);
+                taps[i] = sinc * window;
+                sum += taps[i];
+            }
+            for(int i = 0; i < BLIP_TAPS; i++){
+                kernel[phase][i] = taps[i] / sum;
+            }
+        }
+    }
+
+public:
+    //capacity is the most output samples that can be waiting to be read
+    BlipBuffer(std::size_t capacity) : buffer(capacity + BLIP_TAPS, 0.0f){
+        makeKernel(0.9);
+        factor = 0;
+        clear();
+    }
+
+    void setRates(double clock_rate, double sample_rate){
+        factor = (std::uint64_t)(sample_rate / clock_rate * 4294967296.0 + 0.5);
+    }
+
+    void clear(){
+        std::fill(buffer.begin(), buffer.end(), 0.0f);
+        offset = 0;
+        integrator = 0;
+        dc_blocker.clear();
+    }
+
+    //adds a level change of delta at the given clock of the current frame
+    void addDelta(std::uint32_t clock_time, float delta){
+        std::uint64_t position = clock_time * factor + offset;
+        std::size_t index = position >> 32;
+        int phase = (position >> (32 - BLIP_PHASE_BITS)) & (BLIP_PHASES - 1);
+        if(index + BLIP_TAPS > buffer.size()){
+            return;             //frame longer than the capacity, caller has to end frames sooner
+        }
+        float* out = &buffer[index];
+        const float* taps = kernel[phase];
+        for(int i = 0; i < BLIP_TAPS; i++){
+            out[i] += taps[i] * delta;
+        }
+    }
+
+    //makes the samples before clock_duration readable and starts the next frame there
+    void endFrame(std::uint32_t clock_duration){
+        offset += clock_duration * factor;
+    }
+
+    std::size_t available() const{
+        return offset >> 32;
+    }
+
+    //integrates, removes dc and converts to 16 bit, returns how many samples were read
+    std::size_t readSamples(std::int16_t* out, std::size_t count, float volume){
+        std::size_t ready = available();
+        if(count > ready){
+            count = ready;
+        }
+        for(std::size_t i = 0; i < count; i++){
+            integrator += buffer[i];
+            out[i] = dc_blocker.process(integrator, volume);
+        }
+        //shift what is left, including the tails of steps drawn past the read point
+        std::size_t left = ready - count + BLIP_TAPS;
+        std::memmove(buffer.data(), buffer.data() + count, left * sizeof(float));
+        std::fill(buffer.begin() + left, buffer.begin() + std::min(left + count, buffer.size()), 0.0f);
+        offset -= (std::uint64_t)count << 32;
+        return count;
+    }
+};
+
+#endif // BLIP_HPP_INCLUDED
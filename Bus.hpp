@@ -0,0 +1,247 @@
+#ifndef BUS_HPP_INCLUDED
+#define BUS_HPP_INCLUDED
+
+#include<cstdint>
+#include<cstddef>
+#include"SaveState.hpp"
+
+#define PAGE_SIZE 256
+#define PAGE_COUNT 256
+#define RAM_SIZE (2 * 1024)
+
+//devices that can pull the irq line low, one bit each
+#define IRQ_MAPPER 0b00000001
+#define IRQ_APU_FRAME 0b00000010
+#define IRQ_APU_DMC 0b00000100
+
+//cpu adress space split into 256 pages of 256 bytes
+//every page either points straight at memory (ram, rom) so an access is a single indexed load,
+//or it has read/write callbacks for i/o registers
+class Bus {
+public:
+    typedef std::uint8_t (*ReadHandler)(void* context, std::uint16_t adress);
+    typedef void (*WriteHandler)(void* context, std::uint16_t adress, std::uint8_t value);
+    typedef void (*SyncHandler)(void* context, std::uint16_t adress);
+
+private:
+    struct Page {
+        const std::uint8_t* read_memory;    //null when the page uses the read handler
+        std::uint8_t* write_memory;         //null when the page uses the write handler
+        ReadHandler read;
+        WriteHandler write;
+        void* context;
+        std::uint32_t* version;             //bumped by every direct write, mirrors of the same memory share it
+    };
+
+    Page pages[PAGE_COUNT];
+    std::uint8_t ram[RAM_SIZE];     //internal 2KB, mirrored up to 0x1fff
+    std::uint8_t open_bus;          //last value seen on the data bus
+    std::uint8_t irq_lines;         //IRQ_* bits of devices asking for an interrupt
+    bool nmi_pending;               //set on the nmi edge, cleared when the cpu takes it
+    std::uint32_t versions[PAGE_COUNT]; //write counters behind Page::version, lets cached code notice it was changed
+    SyncHandler sync;               //called before every handler access, so devices running behind can catch up
+    void* sync_context;
+
+    static std::uint8_t readOpenBus(void* context, std::uint16_t){
+        return static_cast<Bus*>(context)->open_bus;
+    }
+
+    static void writeIgnored(void*, std::uint16_t, std::uint8_t){
+    }
+
+public:
+    Bus(){
+        for(int i = 0 ; i < RAM_SIZE ; i++){
+            ram[i] = 0;
+        }
+        open_bus = 0;
+        sync = nullptr;
+        sync_context = nullptr;
+        irq_lines = 0;
+        nmi_pending = false;
+        for(int i = 0 ; i < PAGE_COUNT ; i++){
+            versions[i] = 0;
+            pages[i].read_memory = nullptr;
+            pages[i].version = &versions[i];
+        }
+
+        unmap(0x00, 0xff);
+        mapMemory(0x00, 0x1f, ram, RAM_SIZE, true);
+    }
+
+    //copying would leave the ram pages pointing into the other bus
+    Bus(const Bus&) = delete;
+    Bus& operator=(const Bus&) = delete;
+
+    //open_bus is only refreshed on the slow path, plain memory reads stay a single load
+    std::uint8_t read(std::uint16_t adress){
+        const Page& page = pages[adress >> 8];
+        if(page.read_memory){
+            return page.read_memory[adress & 0xff];
+        }
+        if(sync){
+            sync(sync_context, adress);
+        }
+        open_bus = page.read(page.context, adress);
+        return open_bus;
+    }
+
+    void write(std::uint16_t adress, std::uint8_t value){
+        const Page& page = pages[adress >> 8];
+        if(page.write_memory){
+            page.write_memory[adress & 0xff] = value;
+            (*page.version)++;
+        }else{
+            if(sync){
+                sync(sync_context, adress);
+            }
+            open_bus = value;
+            page.write(page.context, adress, value);
+        }
+    }
+
+    //maps pages first..last onto a block of memory, repeating the block if the range is bigger
+    //size has to be a multiple of the page size
+    void mapMemory(std::uint8_t first, std::uint8_t last, std::uint8_t* memory, std::size_t size, bool writable){
+        std::size_t offset = 0;
+        for(int page = first; page <= last; page++){
+            //remapping counts as a write to whatever was there, bank switches included,
+            //mapping the same memory again (a restored state) leaves code cached from it alone
+            if(pages[page].read_memory != memory + offset || (pages[page].write_memory != nullptr) != writable){
+                (*pages[page].version)++;
+            }
+            pages[page].read_memory = memory + offset;
+            pages[page].write_memory = writable ? memory + offset : nullptr;
+            pages[page].version = &versions[first + offset / PAGE_SIZE];
+            if(!writable){
+                pages[page].write = writeIgnored;
+                pages[page].context = this;
+            }
+            offset = (offset + PAGE_SIZE) % size;
+        }
+    }
+
+    //read only version for rom, writes go to the handler (mapper registers) or are ignored
+    void mapMemory(std::uint8_t first, std::uint8_t last, const std::uint8_t* memory, std::size_t size,
+                   WriteHandler write = nullptr, void* context = nullptr){
+        mapMemory(first, last, const_cast<std::uint8_t*>(memory), size, false);
+        if(write){
+            for(int page = first; page <= last; page++){
+                pages[page].write = write;
+                pages[page].context = context;
+            }
+        }
+    }
+
+    //routes every access to pages first..last through the handlers
+    void mapHandlers(std::uint8_t first, std::uint8_t last, ReadHandler read, WriteHandler write, void* context){
+        for(int page = first; page <= last; page++){
+            //only pages backed by memory can have cached code to throw away
+            if(pages[page].read_memory){
+                (*pages[page].version)++;
+            }
+            pages[page].read_memory = nullptr;
+            pages[page].write_memory = nullptr;
+            pages[page].read = read;
+            pages[page].write = write;
+            pages[page].context = context;
+            pages[page].version = &versions[page];
+        }
+    }
+
+    //unmapped pages read back the open bus value and ignore writes
+    void unmap(std::uint8_t first, std::uint8_t last){
+        mapHandlers(first, last, readOpenBus, writeIgnored, this);
+    }
+
+    //registers or mapper writes can see a device that is behind the cpu, the handler brings it up to date first
+    void setSyncHandler(SyncHandler handler, void* context){
+        sync = handler;
+        sync_context = context;
+    }
+
+    //counts as a write to pages first..last, for memory that was changed without going through the bus
+    void touch(std::uint8_t first, std::uint8_t last){
+        for(int page = first; page <= last; page++){
+            (*pages[page].version)++;
+        }
+    }
+
+    //ram and the lines, the page map belongs to whoever set it up and is restored by them
+    void saveState(StateWriter& state) const{
+        state.tracked(ram, RAM_SIZE, 0x00);
+        state.put(open_bus);
+        state.put(irq_lines);
+        state.put(nmi_pending);
+    }
+
+    void loadState(StateReader& state){
+        state.align();
+        if(state.update(ram, RAM_SIZE)){
+            touch(0x00, 0x07);
+        }
+        state.get(open_bus);
+        state.get(irq_lines);
+        state.get(nmi_pending);
+    }
+
+    std::uint8_t getOpenBus() const{
+        return open_bus;
+    }
+
+    void setIrq(std::uint8_t line, bool active){
+        if(active){
+            irq_lines = irq_lines | line;
+        }else{
+            irq_lines = irq_lines & ~line;
+        }
+    }
+
+    std::uint8_t getIrq() const{
+        return irq_lines;
+    }
+
+    void triggerNmi(){
+        nmi_pending = true;
+    }
+
+    //true when the cpu has to check for an interrupt before the next instruction
+    bool interruptPending() const{
+        return nmi_pending || irq_lines;
+    }
+
+    bool takeNmi(){
+        bool pending = nmi_pending;
+        nmi_pending = false;
+        return pending;
+    }
+
+    //where the interrupt lines live, compiled code polls them between instructions
+    const bool* getNmiLine() const{
+        return &nmi_pending;
+    }
+
+    const std::uint8_t* getIrqLines() const{
+        return &irq_lines;
+    }
+
+    //memory behind a page, null when it goes through handlers
+    const std::uint8_t* getPageMemory(std::uint8_t page) const{
+        return pages[page].read_memory;
+    }
+
+    const std::uint32_t* getPageVersion(std::uint8_t page) const{
+        return pages[page].version;
+    }
+
+    //false when writes to the page go through handlers
+    bool isPageWritable(std::uint8_t page) const{
+        return pages[page].write_memory;
+    }
+
+    std::uint8_t* getRam(){
+        return ram;
+    }
+};
+
+#endif // BUS_HPP_INCLUDED
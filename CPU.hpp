@@ -1,230 +1,346 @@
 #ifndef CPU_HPP_INCLUDED
 #define CPU_HPP_INCLUDED
 
+#include<algorithm>
+#include<array>
+#include<cstdint>
+#include<cstdlib>
+#include<cstring>
 #include<fstream>
 #include<iostream>
 #include<iomanip>
 #include<thread>
 #include<chrono>
+#include<memory>
+#include<string>
+#include<vector>
+#include"Bus.hpp"
+#include"Rom.hpp"
+#include"Mapper.hpp"
+#include"PPU.hpp"
+#include"APU.hpp"
+#include"Jit.hpp"
+#include"Scheduler.hpp"
+#include"Controller.hpp"
+#include"SaveState.hpp"
+#include"Snapshot.hpp"
+#include"Trace.hpp"
+#include"Profiler.hpp"
 
 #define KB 1024
-#define MEMORY_SIZE (64 * KB)
+#define BLOCK_CACHE_SIZE 2048   //blocks, direct mapped on the low bits of their start adress
+#define BLOCK_LENGTH 32         //most instructions one block holds
+#define JIT_HOT_BLOCK 8         //times a block is entered before it gets compiled
+
+//the recompiler works on blocks, so it goes away with the block cache
+#if defined(JIT_AVAILABLE) && !defined(CPU_NO_BLOCK_CACHE)
+#define CPU_JIT 1
+#endif
+
+//what a headless run did, returned by CPU::runHeadless and CPU::runFrames
+struct RunSummary {
+    std::uint64_t instructions;
+    std::uint64_t cycles;
+    double seconds;             //host wall time
+    double mips;                //emulated instructions per host second, in millions
+    std::uint64_t frames;       //frames the ppu finished
+    bool jammed;                //the run stopped on an unsupported op code
+};
+
+//programmer visible registers, P with N, V, Z and C packed in
+struct Registers {
+    std::uint8_t a;
+    std::uint8_t x;
+    std::uint8_t y;
+    std::uint8_t p;
+    std::uint8_t sp;
+    std::uint16_t pc;
+};
+
+//N and Z for every result, so instructions set them with a mask and an or instead of two branches
+constexpr std::array<std::uint8_t, 256> makeNzTable(){
+    std::array<std::uint8_t, 256> table{};
+    for(int value = 0; value < 256; value++){
+        table[value] = (value & 0b10000000) | (value == 0 ? 0b00000010 : 0);
+    }
+    return table;
+}
+
+inline constexpr std::array<std::uint8_t, 256> NZ_TABLE = makeNzTable();
+
 class CPU {
 private:
-    std::uint8_t memory[MEMORY_SIZE];     //ffff bytes
+    Bus bus;                    //everything the cpu reads or writes goes through here
+    std::shared_ptr<const Rom> rom; //the loaded cartridge, read only and shared with every console running it
+    std::unique_ptr<Mapper> mapper; //board logic for the loaded rom, switches banks on the bus
+    PPU ppu;
+    APU apu;
+    Scheduler scheduler;        //when the ppu and apu next have to be run, they are left alone until then
+    Controller controllers[2];  //joypads on 0x4016 and 0x4017
     std::uint8_t regA;          //accumulator
     std::uint8_t regX;          //x and y are index regs
     std::uint8_t regY;
     std::uint8_t regP;          //status register  -- Negative, Overflow, ignored, Break, Decimal, Interrupt, Zero, Carry
     std::uint8_t regSP;         //stack pointer     |    7         6         5       4       3         2        1     0
     std::uint16_t regPC;        //program counter
-    std::uint16_t PRG_ROM_size;
-    std::uint16_t CHR_ROM_size;
-    std::uint8_t flag6;
+#ifdef CPU_LAZY_FLAGS
+    //N, Z, C and V live outside regP and are only packed into it when someone looks
+    std::uint16_t nz_result;    //last result, Z when the low byte is 0, N when bit 7 or bit 8 is set
+    std::uint8_t carry;         //0 or 1
+    std::uint8_t v_left;        //inputs and result of the last add, V is worked out from their sign bits
+    std::uint8_t v_right;
+    std::uint8_t v_result;
+#endif
+    std::uint64_t cycles;       //cpu cycles since power on
+    bool jammed;                //set when an unsupported op code is hit
+    std::uint16_t operand;      //operand bytes of the instruction running from the block cache
+    std::vector<std::uint8_t> snapshot_buffer;     //state taken apart into or put back from a Snapshot
+    std::vector<TrackedRegion> snapshot_regions;
+#ifndef CPU_NO_TRACE
+    TraceBuffer* trace;         //where instructions are recorded, null while tracing is off
+    bool trace_memory;          //record reads and writes too
+#endif
+#ifdef CPU_PROFILE
+    Profiler* profiler;         //null while profiling is off
+#endif
 public:
-    CPU(){
-        for(int i = 0 ; i < MEMORY_SIZE ; i++){
-            memory[i] = 0;
-        }
-        
+    CPU() : ppu(bus), apu(bus){
         regA = 0;
         regX = 0;
         regY = 0;
-        regP = 0;
+        regP = 0b00100100; //interrupts start disabled, the apu frame irq is live from power on
+#ifdef CPU_LAZY_FLAGS
+        nz_result = 1;
+        carry = 0;
+        setOverflow(false);
+#endif
         regSP = 0xff; //stack goes from 0x01ff to 0x0100, since its one byte you add 256(0x0100) for it to work
         regPC = 0;
-        PRG_ROM_size = 0;
-        CHR_ROM_size = 0;
-        flag6 = 0;
+        cycles = 0;
+        jammed = false;
+        operand = 0;
+        controllers[0] = {};
+        controllers[1] = {};
+#ifndef CPU_NO_TRACE
+        trace = nullptr;
+        trace_memory = false;
+#endif
+#ifdef CPU_PROFILE
+        profiler = nullptr;
+#endif
+#ifndef CPU_NO_BLOCK_CACHE
+        blocks = std::make_unique<Block[]>(BLOCK_CACHE_SIZE);
+        flushBlocks();
+#endif
+#ifdef CPU_JIT
+        jit_enabled = false;
+        jit_deadline = 0;
+#endif
+
+        bus.mapHandlers(0x40, 0x40, readIo, writeIo, this);
+        bus.setSyncHandler(syncDevices, this);
+        scheduleDevices();
     }
 
-    void ADC(std::uint16_t adress_index){
-        std::uint8_t carry_bit = 1 & regP;
-        std::uint8_t adder = memory[adress_index];
-        //checks for setting carry and overflow flags
-        if((adder + regA + carry_bit) > 255){
-            regP = regP | 0b01000001;
+    //flag access, building with CPU_LAZY_FLAGS defers N, Z, C and V until the status is read
+    //sets negative and zero from a result
+    void setNZ(std::uint8_t value){
+#ifdef CPU_LAZY_FLAGS
+        nz_result = value;
+#else
+        regP = (regP & 0b01111101) | NZ_TABLE[value];
+#endif
+    }
 
-        }else{
-            regP = regP & 0b10111110;
-        }
+    void setCarry(std::uint8_t value){
+#ifdef CPU_LAZY_FLAGS
+        carry = value;
+#else
+        regP = (regP & 0b11111110) | value;
+#endif
+    }
 
-        //the operation
-        regA += adder + carry_bit;
+    std::uint8_t getCarry() const{
+#ifdef CPU_LAZY_FLAGS
+        return carry;
+#else
+        return regP & 0b00000001;
+#endif
+    }
 
-        //checks for setting zero flag
-        if(regA == 0){
-            regP = regP | 0b00000010;
-        }else{
-            regP = regP & 0b11111101;
-        }
+    bool getZero() const{
+#ifdef CPU_LAZY_FLAGS
+        return (nz_result & 0xff) == 0;
+#else
+        return regP & 0b00000010;
+#endif
+    }
 
-        //checks for setting negative flag
-        if((regA & 0b10000000) != 0){
-            regP = regP | 0b10000000;
-        }else{
-            regP = regP & 0b01111111;
-        }
+    bool getNegative() const{
+#ifdef CPU_LAZY_FLAGS
+        return nz_result & 0x180;
+#else
+        return regP & 0b10000000;
+#endif
+    }
 
+    //overflow when both inputs of an add have the same sign and the result has the other one
+    bool getOverflow() const{
+#ifdef CPU_LAZY_FLAGS
+        return ~(v_left ^ v_right) & (v_left ^ v_result) & 0b10000000;
+#else
+        return regP & 0b01000000;
+#endif
+    }
 
+    //V from anything but an add, BIT, CLV and restoring the status
+    void setOverflow(bool value){
+#ifdef CPU_LAZY_FLAGS
+        //an add of two positive numbers that came out negative
+        v_left = 0;
+        v_right = 0;
+        v_result = value ? 0b10000000 : 0;
+#else
+        regP = (regP & 0b10111111) | (value ? 0b01000000 : 0);
+#endif
     }
 
-    void AND(std::uint16_t adress_index){
-        regA = memory[adress_index] & regA;
+    //the status register as the 6502 would push it, minus B
+    std::uint8_t getStatus() const{
+#ifdef CPU_LAZY_FLAGS
+        return (regP & 0b00111100) | (getNegative() ? 0b10000000 : 0) | (getOverflow() ? 0b01000000 : 0) |
+               (getZero() ? 0b00000010 : 0) | carry;
+#else
+        return regP;
+#endif
+    }
 
-        //checks for setting negative flag
-        if((regA & 0b10000000) != 0){
-            regP = regP | 0b10000000;
-        }else{
-            regP = regP & 0b01111111;
-        }
+    void setStatus(std::uint8_t value){
+        regP = value;
+#ifdef CPU_LAZY_FLAGS
+        //bit 8 keeps N when Z is set too
+        nz_result = ((value & 0b10000000) << 1) | ((value & 0b00000010) ^ 0b00000010);
+        carry = value & 0b00000001;
+        setOverflow(value & 0b01000000);
+#endif
+    }
 
-        //checks for setting zero flag
-        if(regA == 0){
-            regP = regP | 0b00000010;
-        }else{
-            regP = regP & 0b11111101;
-        }
+    //binary add shared by ADC and SBC, the 2A03 has no decimal mode
+    void addWithCarry(std::uint8_t operand){
+        unsigned sum = regA + operand + getCarry();
+#ifdef CPU_LAZY_FLAGS
+        v_left = regA;
+        v_right = operand;
+        v_result = sum;
+#else
+        //overflow when both inputs have the same sign and the result has the other one
+        regP = (regP & 0b10111111) | ((~(regA ^ operand) & (regA ^ sum) & 0b10000000) >> 1);
+#endif
+        setCarry(sum > 0xff);
+        regA = sum;
+        setNZ(regA);
     }
 
-    void ASL(std::uint16_t adress_index){
-        std::uint8_t operand = memory[adress_index];
-        //checking for setting the carry flag
-        if((operand & 0b10000000) != 0){
-            regP = regP | 0b00000001;
-        }else{
-            regP = regP & 0b11111110;
-        }
+    void ADC(std::uint8_t operand){
+        addWithCarry(operand);
+    }
 
-        //doing actual operation
-        operand <<= 1;
+    void AND(std::uint8_t operand){
+        regA = operand & regA;
+        setNZ(regA);
+    }
 
-        //checking for setting the zero flag
-        if(operand == 0){
-            regP = regP | 0b00000010;
-        }else{
-            regP = regP & 0b11111101;
-        }
+    std::uint8_t ASL(std::uint8_t operand){
+        //bit 7 goes into carry
+        setCarry(operand >> 7);
+        operand <<= 1;
+        setNZ(operand);
+        return operand;
+    }
 
-        //checking for setting the negative flag
-        if((operand & 0b10000000) != 0){
-            regP = regP | 0b10000000;
-        }else{
-            regP = regP & 0b01111111;
-        }
+    //taken branches cost one cycle, and one more if the target is on another page
+    void branch(std::uint16_t adress_index){
+        cycles += 1 + ((regPC ^ adress_index) >> 8 != 0);
+        regPC = adress_index;
     }
 
     void BCC(std::uint16_t adress_index){
-        if(!(regP & 0b00000001)){
-            regPC = adress_index;
-        }
-        else{
-            regPC += 2; 
+        if(!getCarry()){
+            branch(adress_index);
         }
     }
 
     void BCS(std::uint16_t adress_index){
-        if(regP & 0b00000001){
-            regPC = adress_index;
-        }
-        else{
-            regPC += 2;
+        if(getCarry()){
+            branch(adress_index);
         }
     }
 
     void BEQ(std::uint16_t adress_index){
-        if(regP & 0b00000010){
-            regPC = adress_index;
-        }
-        else{
-            regPC += 2;
+        if(getZero()){
+            branch(adress_index);
         }
     }
 
     void BIT(std::uint16_t adress_index){
-        std::uint8_t operand = memory[adress_index];
-
-        //setting negative flag
-        if(operand & 0b10000000){
-            regP = regP | 0b10000000;
-        }else{
-            regP = regP & 0b01111111;
-        }
-
-        //setting overflow flag
-        if(operand & 0b01000000){
-            regP = regP | 0b01000000;
-        }else{
-            regP = regP & 0b10111111;
-        }
-
-        //setting zero flag
-        if(!(operand & regA)){
-            regP = regP | 0b00000010;
-        }else{
-            regP = regP & 0b11111101;
-        }
+        std::uint8_t operand = read(adress_index);
+
+        //negative and overflow are copied from the operand, zero comes from the and
+#ifdef CPU_LAZY_FLAGS
+        setOverflow(operand & 0b01000000);
+        nz_result = (operand & regA) | ((operand & 0b10000000) << 1);
+#else
+        regP = (regP & 0b00111101) | (operand & 0b11000000) | (NZ_TABLE[operand & regA] & 0b00000010);
+#endif
     }
 
     void BMI(std::uint16_t adress_index){
-        if(regP & 0b10000000){
-            regPC = adress_index;
-        }
-        else{
-            regPC += 2;
+        if(getNegative()){
+            branch(adress_index);
         }
     }
 
     void BNE(std::uint16_t adress_index){
-        if(!(regP & 0b00000010)){
-            regPC = adress_index;
-        }
-        else{
-            regPC += 2;
+        if(!getZero()){
+            branch(adress_index);
         }
     }
 
     void BPL(std::uint16_t adress_index){
-        if(!(regP & 0b10000000)){
-            regPC = adress_index;
-        }
-        else{
-            regPC += 2;
+        if(!getNegative()){
+            branch(adress_index);
         }
     }
 
     void BRK(){
-        //pushing PC to stack
-        memory[0x100 + (regSP--)] = regPC + 2;
-
+        //the byte after BRK is skipped, RTI comes back two bytes after it
+        std::uint16_t return_adress = regPC + 1;
+        write(0x100 + regSP--, return_adress >> 8);
+        write(0x100 + regSP--, return_adress & 0xff);
 
-        //setting break flag
-        regP = regP | 0b00010000;
-
-        //pushing SR to stack
-        memory[0x100 + (regSP--)] = regP;
+        //B only exists in the pushed copy, that is how the handler tells BRK from an irq
+        write(0x100 + regSP--, getStatus() | 0b00110000);
+        regP = regP | 0b00000100;
+        std::uint16_t adress = read(0xffff);
+        adress <<= 8;
+        adress += read(0xfffe);
+        regPC = adress;
     }
 
     void BVC(std::uint16_t adress_index){
-        if(!(regP & 0b01000000)){
-            regPC = adress_index;
-        }
-        else{
-            regPC += 2;
+        if(!getOverflow()){
+            branch(adress_index);
         }
     }
 
     void BVS(std::uint16_t adress_index){
-        if(regP & 0b01000000){
-            regPC = adress_index;
-        }
-        else{
-            regPC += 2;
+        if(getOverflow()){
+            branch(adress_index);
         }
     }
 
     void CLC(){
-        regP = regP & 0b11111110;
+        setCarry(0);
     }
 
     void CLI(){
@@ -232,212 +348,66 @@ public:
     }
 
     void CLV(){
-        regP = regP & 0b10111111;
+        setOverflow(false);
     }
 
-    void CMP(std::uint16_t adress_index){
-        std::uint8_t operand = memory[adress_index];
-
-        //setting the carry flag
-        if(regA >= operand){
-            regP = regP | 0b00000001;
-        }else{
-            regP = regP & 0b11111110;
-        }
-
-        std::uint8_t result = regA - operand;
-
-        //setting the zero flag
-        if(!result){
-            regP = regP | 0b00000010;
-        }else{
-            regP = regP & 0b11111101;
-        }
-
-        //setting the negative flag
-        if((result & 0b10000000) != 0){
-            regP = regP | 0b10000000;
-        }else{
-            regP = regP & 0b01111111;
-        }
+    void CMP(std::uint8_t operand){
+        //carry is set when there is no borrow
+        setCarry(regA >= operand);
+        setNZ(regA - operand);
     }
 
-    void CPX(std::uint16_t adress_index){
-        std::uint8_t operand = memory[adress_index];
-
-        //setting the carry flag
-        if(regX >= operand){
-            regP = regP | 0b00000001;
-        }else{
-            regP = regP & 0b11111110;
-        }
-
-        std::uint8_t result = regX - operand;
-
-        //setting the zero flag
-        if(!result){
-            regP = regP | 0b00000010;
-        }else{
-            regP = regP & 0b11111101;
-        }
-
-        //setting the negative flag
-        if((result & 0b10000000) != 0){
-            regP = regP | 0b10000000;
-        }else{
-            regP = regP & 0b01111111;
-        }
+    void CPX(std::uint8_t operand){
+        //carry is set when there is no borrow
+        setCarry(regX >= operand);
+        setNZ(regX - operand);
     }
 
-    void CPY(std::uint16_t adress_index){
-        std::uint8_t operand = memory[adress_index];
-
-        //setting the carry flag
-        if(regY >= operand){
-            regP = regP | 0b00000001;
-        }else{
-            regP = regP & 0b11111110;
-        }
-
-        std::uint8_t result = regY - operand;
-
-        //setting the zero flag
-        if(!result){
-            regP = regP | 0b00000010;
-        }else{
-            regP = regP & 0b11111101;
-        }
-
-        //setting the negative flag
-        if((result & 0b10000000) != 0){
-            regP = regP | 0b10000000;
-        }else{
-            regP = regP & 0b01111111;
-        }
+    void CPY(std::uint8_t operand){
+        //carry is set when there is no borrow
+        setCarry(regY >= operand);
+        setNZ(regY - operand);
     }
 
     void CLD(){
-        regP = regP & 0x11110111;
+        regP = regP & 0b11110111;
     }
 
-    void DEC(std::uint16_t adress_index){
-        memory[adress_index]--;
-
-        //setting the zero flag
-        if(!memory[adress_index]){
-            regP = regP | 0b00000010;
-        }else{
-            regP = regP & 0b11111101;
-        }
-
-        //setting the negative flag
-        if((memory[adress_index] & 0b10000000) != 0){
-            regP = regP | 0b10000000;
-        }else{
-            regP = regP & 0b01111111;
-        }
+    std::uint8_t DEC(std::uint8_t operand){
+        operand--;
+        setNZ(operand);
+        return operand;
     }
 
     void DEX(){
         regX--;
-
-        //setting the zero flag
-        if(!regX){
-            regP = regP | 0b00000010;
-        }else{
-            regP = regP & 0b11111101;
-        }
-
-        //setting the negative flag
-        if((regX & 0b10000000) != 0){
-            regP = regP | 0b10000000;
-        }else{
-            regP = regP & 0b01111111;
-        }
+        setNZ(regX);
     }
 
     void DEY(){
-       regY--;
-
-        //setting the zero flag
-        if(!regY){
-            regP = regP | 0b00000010;
-        }else{
-            regP = regP & 0b11111101;
-        }
-
-        //setting the negative flag
-        if((regY & 0b10000000) != 0){
-            regP = regP | 0b10000000;
-        }else{
-            regP = regP & 0b01111111;
-        }
+        regY--;
+        setNZ(regY);
     }
 
-    void EOR(std::uint16_t adress_index){
-        regA = regA ^ memory[adress_index];
-
-        //setting the zero flag
-        if(!regA){
-            regP = regP | 0b00000010;
-        }else{
-            regP = regP & 0b11111101;
-        }
-
-        //setting the negative flag
-        if((regA & 0b10000000) != 0){
-            regP = regP | 0b10000000;
-        }else{
-            regP = regP & 0b01111111;
-        }
+    void EOR(std::uint8_t operand){
+        regA = regA ^ operand;
+        setNZ(regA);
     }
 
-    void INC(std::uint16_t adress_index){
-        //setting zero and doing inc
-        if(++memory[adress_index] == 0){
-            regP = regP | 0b00000010;
-        }else{
-            regP = regP & 0b11111101;
-        }
-
-        //setting the negative flag
-        if((memory[adress_index] & 0b10000000) != 0){
-            regP = regP | 0b10000000;
-        }else{
-            regP = regP & 0b01111111;
-        }
+    std::uint8_t INC(std::uint8_t operand){
+        operand++;
+        setNZ(operand);
+        return operand;
     }
 
     void INX(){
-        //setting zero and doing inc
-        if(++regX == 0){
-            regP = regP | 0b00000010;
-        }else{
-            regP = regP & 0b11111101;
-        }
-
-        //setting the negative flag
-        if((regX & 0b10000000) != 0){
-            regP = regP | 0b10000000;
-        }else{
-            regP = regP & 0b01111111;
-        }
+        regX++;
+        setNZ(regX);
     }
 
     void INY(){
-        //setting zero and doing inc
-        if(++regY == 0){
-            regP = regP | 0b00000010;
-        }else{
-            regP = regP & 0b11111101;
-        }
-
-        //setting the negative flag
-        if((regY & 0b10000000) != 0){
-            regP = regP | 0b10000000;
-        }else{
-            regP = regP & 0b01111111;
-        }
+        regY++;
+        setNZ(regY);
     }
 
     void JMP(std::uint16_t adress_index){
@@ -446,9 +416,11 @@ public:
     }
 
     void JSR(std::uint16_t adress_index){
-        //pushing return adress to the stack
+        //pushing the adress of JSR's last byte, high byte first, RTS adds the one back
         //must always add 0x100 to stack pointer!
-        memory[0x100 + (regSP--)] = regPC + 1;
+        std::uint16_t return_adress = regPC - 1;
+        write(0x100 + regSP--, return_adress >> 8);
+        write(0x100 + regSP--, return_adress & 0xff);
 
         //jumping to adress
         regPC = adress_index;
@@ -456,112 +428,48 @@ public:
 
 
 
-    void LDA(std::uint8_t value){
-        regA = value;
-
-        //checks for setting negative flag
-        if((regA & 0b10000000) != 0){
-            regP = regP | 0b10000000;
-        }else{
-            regP = regP & 0b01111111;
-        }
-
-        //checks for setting zero flag
-        if(regA == 0){
-            regP = regP | 0b00000010;
-        }else{
-            regP = regP & 0b11111101;
-        }
+    void LDA(std::uint8_t operand){
+        regA = operand;
+        setNZ(regA);
     }
 
-    void LDX(std::uint8_t value){
-        regX = value;
-
-        //checks for setting negative flag
-        if((regX & 0b10000000) != 0){
-            regP = regP | 0b10000000;
-        }else{
-            regP = regP & 0b01111111;
-        }
-
-        //checks for setting zero flag
-        if(regX == 0){
-            regP = regP | 0b00000010;
-        }else{
-            regP = regP & 0b11111101;
-        }
+    void LDX(std::uint8_t operand){
+        regX = operand;
+        setNZ(regX);
     }
 
-    void LDY(std::uint8_t value){
-        regY = value;
-
-        //checks for setting negative flag
-        if((regY & 0b10000000) != 0){
-            regP = regP | 0b10000000;
-        }else{
-            regP = regP & 0b01111111;
-        }
-
-        //checks for setting zero flag
-        if(regY == 0){
-            regP = regP | 0b00000010;
-        }else{
-            regP = regP & 0b11111101;
-        }
+    void LDY(std::uint8_t operand){
+        regY = operand;
+        setNZ(regY);
     }
 
-    void LSR(std::uint16_t adress_index){
-        //setting the cary flag
-        if(memory[adress_index] & 0x00000001){
-            regP = regP | 0x00000001;
-        }else{
-            regP = regP & 0x11111110;
-        }
-
-        //setting the negative flag
-        regP = regP & 0x01111111;
-
-        memory[adress_index] >>= 1;
-
-        if(!memory[adress_index]){
-            regP = regP | 0x00000010;
-        }else{
-            regP = regP & 0x11111101;
-        }
+    std::uint8_t LSR(std::uint8_t operand){
+        //bit 0 goes into carry, negative always ends up clear
+        setCarry(operand & 0b00000001);
+        operand >>= 1;
+        setNZ(operand);
+        return operand;
     }
 
-    void ORA(uint16_t adress_index){
-        memory[adress_index] = memory[adress_index] | regA;
-
-        //setting zero flag
-        if(memory[adress_index] == 0){
-            regP = regP | 0b00000010;
-        }else{
-            regP = regP & 0b11111101;
-        }
-
-        //setting negative flag
-        if(memory[adress_index] & 0b10000000 != 0){
-            regP = regP | 0b10000000;
-        }else{
-            regP = regP & 0b01111111;
-        }
+    void ORA(std::uint8_t operand){
+        regA = operand | regA;
+        setNZ(regA);
     }
 
     void STA(std::uint16_t adress_index){
-        memory[adress_index] = regA;
+        write(adress_index, regA);
     }
 
     void STX(std::uint16_t adress_index){
-        memory[adress_index] = regX;
+        write(adress_index, regX);
     }
 
     void STY(std::uint16_t adress_index){
-        memory[adress_index] = regY;
+        write(adress_index, regY);
     }
 
     void SEC(){
-        regP = regP | 0b00000001;
+        setCarry(1);
     }
 
     void SEI(){
@@ -574,1443 +482,1561 @@ public:
 
     void TAX(){
         regX = regA;
-
-        //setting negative flag
-        if((regA & 0b10000000)){
-            regP = regP | 0b10000000;
-        }else{
-            regP = regP & 0b01111111;
-        }
-
-        //setting zero flag
-        if(!regA){
-            regP = regP | 0b00000010;
-        }else{
-            regP = regP & 0b11111101;
-        }
+        setNZ(regX);
     }
 
     void TAY(){
         regY = regA;
-
-        //setting negative flag
-        if((regA & 0b10000000)){
-            regP = regP | 0b10000000;
-        }else{
-            regP = regP & 0b01111111;
-        }
-
-        //setting zero flag
-        if(!regA){
-            regP = regP | 0b00000010;
-        }else{
-            regP = regP & 0b11111101;
-        }
+        setNZ(regY);
     }
 
     void TSX(){
         regX = regSP;
-
-        //setting negative flag
-        if((regSP & 0b10000000)){
-            regP = regP | 0b10000000;
-        }else{
-            regP = regP & 0b01111111;
-        }
-
-        //setting zero flag
-        if(!regSP){
-            regP = regP | 0b00000010;
-        }else{
-            regP = regP & 0b11111101;
-        }
+        setNZ(regX);
     }
 
     void TXA(){
         regA = regX;
-
-        //setting negative flag
-        if((regA & 0b10000000)){
-            regP = regP | 0b10000000;
-        }else{
-            regP = regP & 0b01111111;
-        }
-
-        //setting zero flag
-        if(!regA){
-            regP = regP | 0b00000010;
-        }else{
-            regP = regP & 0b11111101;
-        }
+        setNZ(regA);
     }
 
     void TXS(){
+        //the only transfer that leaves the flags alone
         regSP = regX;
-
-        //setting negative flag
-        if((regSP & 0b10000000)){
-            regP = regP | 0b10000000;
-        }else{
-            regP = regP & 0b01111111;
-        }
-
-        //setting zero flag
-        if(!regSP){
-            regP = regP | 0b00000010;
-        }else{
-            regP = regP & 0b11111101;
-        }
     }
 
     void TYA(){
         regA = regY;
-
-        //setting negative flag
-        if((regA & 0b10000000)){
-            regP = regP | 0b10000000;
-        }else{
-            regP = regP & 0b01111111;
-        }
-
-        //setting zero flag
-        if(!regA){
-            regP = regP | 0b00000010;
-        }else{
-            regP = regP & 0b11111101;
-        }
+        setNZ(regA);
     }
 
-    void ROL(std::uint16_t adress_index){
-        bool carry = false;
-        //checking if carry will be 1
-        if(memory[adress_index] & 0b10000000 != 0){
-            carry = true;
-        }
-        //doing it
-        memory[adress_index] <<= 1;
-
-        if(regP & 0b00000001 != 0){
-            memory[adress_index] ++;
-        }
-
-        //setting carry after
-        if(carry){
-            regP = regP | 0b00000001;
-        }else{
-            regP = regP & 0b11111110;
-        }
-
-        //setting negative flag
-        if(memory[adress_index] & 0b10000000 != 0){
-            regP = regP | 0b10000000;
-        }else{
-            regP = regP & 0b01111111;
-        }
-
-        //setting zero flag
-        if(memory[adress_index] == 0){
-            regP = regP | 0b00000010;
-        }else{
-            regP = regP & 0b11111101;
-        }
+    std::uint8_t ROL(std::uint8_t operand){
+        //bit 7 goes into carry, the old carry into bit 0
+        std::uint8_t carry_in = getCarry();
+        setCarry(operand >> 7);
+        operand = (operand << 1) | carry_in;
+        setNZ(operand);
+        return operand;
     }
 
-    void ROR(std::uint16_t adress_index){
-          bool carry = false;
-        //checking if carry will be 1
-        if(memory[adress_index] & 0b00000001 != 0){
-            carry = true;
-        }
-        //doing it
-        memory[adress_index] >>= 1;
-
-        if(regP & 0b00000001 != 0){
-            memory[adress_index] += 0b10000000;
-        }
-
-        //setting carry after
-        if(carry){
-            regP = regP | 0b00000001;
-        }else{
-            regP = regP & 0b11111110;
-        }
-
-        //setting negative flag
-        if(memory[adress_index] & 0b10000000 != 0){
-            regP = regP | 0b10000000;
-        }else{
-            regP = regP & 0b01111111;
-        }
-
-        //setting zero flag
-        if(memory[adress_index] == 0){
-            regP = regP | 0b00000010;
-        }else{
-            regP = regP & 0b11111101;
-        }
+    std::uint8_t ROR(std::uint8_t operand){
+        //bit 0 goes into carry, the old carry into bit 7
+        std::uint8_t carry_in = getCarry();
+        setCarry(operand & 0b00000001);
+        operand = (operand >> 1) | (carry_in << 7);
+        setNZ(operand);
+        return operand;
     }
 
     void RTI(){
-        //pullin SR from stack
-        regP = memory[0x100 + regSP++];
+        //pullin SR from stack, ignoring the break flag, bit 5 always reads as set
+        setStatus((read(0x100 + ++regSP) & 0b11001111) | 0b00100000);
 
-        //ignore fifth flag
-        regP = regP & 0x11101111;
-
-        //pulling PC from stack
-        regPC = memory[0x100 + regSP++];
+        //pulling PC from stack, low byte first
+        regPC = read(0x100 + ++regSP);
+        regPC = regPC | (read(0x100 + ++regSP) << 8);
     }
 
     void RTS(){
-        //just pulling PC froom stack
-        regPC = memory[0x100 + regSP++];
+        //pulling PC from stack, low byte first, it points at JSR's last byte
+        regPC = read(0x100 + ++regSP);
+        regPC = regPC | (read(0x100 + ++regSP) << 8);
+        regPC++;
     }
 
-    void SBC(std::uint16_t adress_index){
-        //carry flag for borrowing
-        if(regA < memory[adress_index]){
-            regP = regP | 0b00000001;
-        }else{
-            regP = regP & 0b11111110;
-        }
-
-        //setting the overflow flag
-        if((int)regA - (int)memory[adress_index] < -128){
-            regP = regP | 0b01000000;
-        }else{
-            regP = regP & 0b10111111;
-        }
-
-        regA -= memory[adress_index];
-
-        //setting the negative flag
-        if(regA & 0b10000000 != 0){
-            regP = regP | 0b10000000;
-        }else{
-            regP = regP & 0b01111111;
-        }
-
-        //setting the zero flag
-        if(regA == 0){
-            regP = regP | 0b00000010;
-        }else{
-            regP = regP & 0b11111101;
-        }
-
+    void SBC(std::uint8_t operand){
+        //A - M - (1 - C) is A + ~M + C, carry ends up set when there was no borrow
+        addWithCarry(~operand);
+    }
 
+    void NOP(){
     }
 
     void PHA(){
         //pushing accumulator to stack
-        memory[0x100 + regSP--] = regA;
+        write(0x100 + regSP--, regA);
     }
 
     void PLA(){
-        //pulling from stack
-        regA = memory[0x100 + regSP++];
-
-        //setting zero flag
-        if(regA == 0){
-            regP = regP | 0b00000010;
-        }else{
-            regP = regP & 0b11111101;
-        }
-
-        //setting negative flag
-        if(regA & 0b10000000 != 0){
-            regP = regP | 0b10000000;
-        }else{
-            regP = regP & 0b01111111;
-        }
+        //pulling from stack, the pointer sits below the last pushed byte
+        regA = read(0x100 + ++regSP);
+        setNZ(regA);
     }
 
     void PHP(){
         //pushing SR to stack with break and bit 5 set to 1
-        memory[0x100 + regSP--] = regP | 0b00110000;
+        write(0x100 + regSP--, getStatus() | 0b00110000);
 
     }
 
     void PLP(){
-        //pulling SR from stack while ignoring break and bit 5
-        regP = memory[0x100 + regSP++] & 0b11001111;
+        //pulling SR from stack while ignoring break, bit 5 always reads as set
+        setStatus((read(0x100 + ++regSP) & 0b11001111) | 0b00100000);
     }
 
-    //loads a .nes file into memory
-    void load(std::string file_name){
-        std::ifstream file(file_name,std::ios_base::binary);
-        if(!file.is_open()){
-            std::cout<<"Could not read <"<<file_name<<">. Exiting program!"<<std::endl;
-            exit(EXIT_FAILURE);
+    //loads a .nes file and maps it into the adress space
+    RomError load(const std::string& file_name){
+        std::shared_ptr<const Rom> image;
+        RomError error = Rom::openShared(file_name, image);
+        if(error != RomError::None){
+            return error;
         }
-        char byte;
-        //begining of PRG_ROM memory
-        std::uint16_t program_adress = 0x4020;
-        //std::uint16_t program_adress = 0;
+        return load(std::move(image));
+    }
 
-        //get past unused bytes
-        for(int i = 0; i < 4; ++i){
-            file.get(byte);
+    //same as above for an image already in memory, the caller keeps it alive
+    RomError load(const std::uint8_t* image, std::size_t size){
+        std::shared_ptr<const Rom> opened;
+        RomError error = Rom::openShared(image, size, opened);
+        if(error != RomError::None){
+            return error;
         }
+        return load(std::move(opened));
+    }
 
-        //set flags and program sizes
-        file.get(byte);
-        PRG_ROM_size = 16 * KB * byte;
-        file.get(byte);
-        CHR_ROM_size = 8 * KB * byte;
-        file.get(byte);
-        flag6 = byte;
-
-        //get past the rest of header bytes
-        for(int i = 7; i < 16; i++){
-            file.get(byte);
+    //runs a rom another console may be running too, see Rom::openShared. the console only
+    //keeps its ram, registers and bank state, PRG and CHR are read from the shared image
+    RomError load(std::shared_ptr<const Rom> image){
+        if(!image){
+            return RomError::CannotOpen;
         }
+        //the old board goes first, it still points into the old image
+        mapper.reset();
+        rom = std::move(image);
+        return insert();
+    }
 
-        while(file.get(byte) && program_adress <= 0xffff){
-            memory[program_adress] = byte;
-            program_adress++;
-        }
+    //the whole console as one binary blob, see SaveState.hpp. out is overwritten and keeps its
+    //capacity, so saving into the same vector again does not allocate
+    void saveState(std::vector<std::uint8_t>& out) const{
+        StateWriter state(out);
+        writeState(state);
+    }
 
-        file.close();
+    //copy on write snapshot sharing every page that did not change since parent, see Snapshot.hpp
+    //parent has to be a snapshot of this cpu to share anything, usually the one taken just before
+    Snapshot takeSnapshot(const Snapshot* parent = nullptr){
+        StateWriter state(snapshot_buffer, &snapshot_regions);
+        writeState(state);
+        Snapshot snapshot;
+        snapshot.capture(snapshot_buffer.data(), snapshot_buffer.size(), snapshot_regions, bus, parent);
+        return snapshot;
     }
 
-    void do_operation(std::uint8_t op_code){
-        std::uint8_t adress_8bit;
-        std::uint16_t adress_16bit;
-        switch(op_code){
-            //ADC (ADD with Carry)
-            //imidiate
-            case 0x69:
-                adress_16bit = regPC + 1;
-                ADC(adress_16bit);
-                regPC += 2;
-                break;
-            //zero page
-            case 0x65:
-                adress_8bit = memory[regPC + 1];
-                ADC(adress_8bit);
-                regPC += 2;
-                break;
-            //zero page, x
-            case 0x75:
-                adress_8bit = memory[regPC + 1] + regX;
-                ADC(adress_8bit);
-                regPC += 2;
-                break;
-            //absolute
-            case 0x6d:
-                //6502 is little endian
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                ADC(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
-            //absolute, x
-            case 0x7d:
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                adress_16bit += regX;
-                ADC(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
-            //absolute, y
-            case 0x79:
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                adress_16bit += regY;
-                ADC(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
-            //indirect, x
-            case 0x61:
-                //high byte
-                adress_16bit = memory[memory[regPC + 1] + 1 + regX];
-                adress_16bit <<= 8;
-                //low byte
-                adress_16bit += memory[memory[regPC + 1] + regX];
-                ADC(adress_16bit);
-                regPC += 2;
-                break;
-            //indirect, y
-            case 0x71:
-                //high byte
-                adress_16bit = memory[memory[regPC + 1] + 1 + regY];
-                adress_16bit <<= 8;
-                //low byte
-                adress_16bit += memory[memory[regPC + 1] + regY];
-                ADC(adress_16bit);
-                regPC += 2;
-                break;
-            
-            //AND (Bitwise and with Accumulator)
-            //imidiate
-            case 0x29:
-                adress_16bit = regPC + 1;
-                AND(adress_16bit);
-                regPC += 2;
-                break;
-            //zero page
-            case 0x25:
-                adress_8bit = memory[regPC + 1];
-                AND(adress_8bit);
-                regPC += 2;
-                break;
-            //zero page, x
-            case 0x35:
-                adress_8bit = memory[regPC + 1] + regX;
-                AND(adress_8bit);
-                regPC += 2;
-                break;
-            //absolute
-            case 0x2d:
-                //6502 is little endian
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1]; 
-                AND(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
-            //absolute, x
-            case 0x3d:
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                adress_16bit += regX;
-                AND(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
-            //absolute, y
-            case 0x39:
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                adress_16bit += regY;
-                AND(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
-            //indirect, X
-            case 0x21:
-                //high byte
-                adress_16bit = memory[memory[regPC + 1] + 1 + regX];
-                adress_16bit <<= 8;
-                //low byte
-                adress_16bit += memory[memory[regPC + 1] + regX];
-                AND(adress_16bit);
-                regPC += 2;
-                break;
-            //indirect, Y
-            case 0x31:
-                //high byte
-                adress_16bit = memory[memory[regPC + 1] + 1 + regY];
-                adress_16bit <<= 8;
-                //low byte
-                adress_16bit += memory[memory[regPC + 1] + regY];
-                AND(adress_16bit);
-                regPC += 2;
-                break;
+    StateError restore(const Snapshot& snapshot){
+        snapshot.copyTo(snapshot_buffer);
+        return loadState(snapshot_buffer);
+    }
 
-            //ASL (Arithmetic Shift Left)
-            //Accumulator
-            case 0x0a:
-                memory[0] = regA;
-                ASL(0);
-                regA = memory[0];
-                regPC ++;
-                break;
-            //zero page
-            case 0x06:
-                adress_8bit = memory[regPC + 1];
-                ASL(adress_8bit);
-                regPC += 2;
-                break;
-            //zero page, x
-            case 0x16:
-                adress_8bit = memory[regPC + 1] + regX;
-                ASL(adress_8bit);
-                regPC += 2;
-                break;
-            //absolute
-            case 0x0e:
-                //6502 is little endian
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                ASL(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
-            //absolute, x
-            case 0x1e:
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                adress_16bit += regX;
-                ASL(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
+    //restores a state saved with the same rom loaded, nothing is touched unless the header checks out.
+    //cached and compiled code only goes away for memory the state actually changes
+    StateError loadState(const std::uint8_t* data, std::size_t size){
+        if(size < sizeof(StateHeader)){
+            return StateError::TooSmall;
+        }
+        StateHeader header;
+        std::memcpy(&header, data, sizeof(header));
+        if(header.magic != STATE_MAGIC){
+            return StateError::BadMagic;
+        }
+        if(header.version != STATE_VERSION){
+            return StateError::BadVersion;
+        }
+        if(header.rom != romChecksum()){
+            return StateError::WrongRom;
+        }
+        if(header.size != size){
+            return StateError::BadSize;
+        }
+
+        StateReader state(data, size);
+        std::uint8_t status;
+        state.get(header);
+        state.get(regA);
+        state.get(regX);
+        state.get(regY);
+        state.get(status);
+        setStatus(status);
+        state.get(regSP);
+        state.get(regPC);
+        state.get(cycles);
+        state.get(jammed);
+        state.get(controllers);
+        bus.loadState(state);
+        if(mapper){
+            mapper->loadState(state);
+        }
+        ppu.loadState(state);
+        apu.loadState(state);
+#ifndef CPU_NO_BLOCK_CACHE
+        next_op = &no_block;
+#endif
+        scheduleDevices();
+        return StateError::None;
+    }
 
-            //BIT (test BITs)
-            //zero page
-            case 0x24:
-                adress_8bit = memory[regPC + 1];
-                BIT(adress_8bit);
-                regPC += 2;
-                break;
-            //absolute
-            case 0x2c:
-                //6502 is little endian
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                BIT(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
+    StateError loadState(const std::vector<std::uint8_t>& state){
+        return loadState(state.data(), state.size());
+    }
 
-            //BRANCH instructions
-            case 0x10:
-                //fix jumps TODO 
-                adress_16bit = 2 + regPC + (std::int8_t)memory[regPC + 1];
-                BPL(adress_16bit);
-                break;
-            case 0x30:
-                adress_16bit = 2 + regPC + (std::int8_t)memory[regPC + 1];
-                BMI(adress_16bit);
-                break;
-            case 0x50:
-                adress_16bit = 2 + regPC + (std::int8_t)memory[regPC + 1];
-                BVC(adress_16bit);
-                break;
-            case 0x70:
-                adress_16bit = 2 + regPC + (std::int8_t)memory[regPC + 1];
-                BVS(adress_16bit);
-                break;
-            case 0x90:
-                adress_16bit = 2 + regPC + (std::int8_t)memory[regPC + 1];
-                BCC(adress_16bit);
-                break;
-            case 0xb0:
-                adress_16bit = 2 + regPC + (std::int8_t)memory[regPC + 1];
-                BCS(adress_16bit);
-                break;
-            case 0xd0:
-                adress_16bit = 2 + regPC + (std::int8_t)memory[regPC + 1];
-                BNE(adress_16bit);
-                break;
-            case 0xf0:
-                adress_16bit = 2 + regPC + (std::int8_t)memory[regPC + 1];
-                BEQ(adress_16bit);
-                break;
+private:
+    //states only fit the cartridge they were saved with
+    std::uint64_t romChecksum() const{
+        return mapper ? rom->getChecksum() : 0;
+    }
 
-            //BRK (Break)
-            case 0x00:
-                BRK();
-                regPC ++;
-                break;
-            
-            //CMP (Compare accumulator)
-            //immediate
-            case 0xc9:
-                adress_16bit = regPC + 1;
-                CMP(adress_16bit);
-                regPC += 2;
-                break;
-            //zero page
-            case 0xc5:
-                adress_8bit = memory[regPC + 1];
-                CMP(adress_8bit);
-                regPC += 2;
-                break;
-            //zero page, x
-            case 0xd5:
-                adress_8bit = memory[regPC + 1] + regX;
-                CMP(adress_8bit);
-                regPC += 2;
-                break;
-            //absolute
-            case 0xcd:
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                CMP(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
-            //absolute, x
-            case 0xdd:
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                adress_16bit += regX;
-                CMP(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
-            //absolute, y
-            case 0xd9:
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                adress_16bit += regY;
-                CMP(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
-            //indirect, x
-            case 0xc1:
-                //high byte
-                adress_16bit = memory[memory[regPC + 1] + 1 + regX];
-                adress_16bit <<= 8;
-                //low byte
-                adress_16bit += memory[memory[regPC + 1] + regX];
-                CMP(adress_16bit);
-                regPC += 2;
-                break;
-            //indirect, y
-            case 0xd1:
-                //high byte
-                adress_16bit = memory[memory[regPC + 1] + 1 + regY];
-                adress_16bit <<= 8;
-                //low byte
-                adress_16bit += memory[memory[regPC + 1] + regY];
-                CMP(adress_16bit);
-                regPC += 2;
-                break;
-            
-            //CPX (Compare X Register)
-            //immediate
-            case 0xe0:
-                adress_16bit = regPC + 1;
-                CPX(adress_16bit);
-                regPC += 2;
-                break;
-            //zero page
-            case 0xe4:
-                adress_8bit = memory[regPC + 1];
-                CPX(adress_8bit);
-                regPC += 2;
-                break;
-            //absolute
-            case 0xec:
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                CPX(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
-            
-            //CPY (Compare Y Register)
-            //immediate
-            case 0xc0:
-                adress_16bit = regPC + 1;
-                CPY(adress_16bit);
-                regPC += 2;
-                break;
-            //zero page
-            case 0xc4:
-                adress_8bit = memory[regPC + 1];
-                CPY(adress_8bit);
-                regPC += 2;
-                break;
-            //absolute
-            case 0xcc:
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                CPY(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
-            
-            //DEC (Decrement memory)
-            //zero page
-            case 0xc6:
-                adress_8bit = memory[regPC + 1];
-                DEC(adress_8bit);
-                regPC += 2;
-                break;
-            //zero page,x
-            case 0xd6:
-                adress_8bit = memory[regPC + 1] + regX;
-                DEC(adress_8bit);
-                regPC += 2;
-                break;
-            //absolute
-            case 0xce:
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                DEC(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
-            //absolute,x
-            case 0xde:
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                adress_16bit += regX;
-                DEC(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
-            
-            //EOR (bitwise Exclusive OR)
-            //imidiate
-            case 0x49:
-                adress_16bit = regPC + 1;
-                EOR(adress_16bit);
-                regPC += 2;
-                break;
-            //zero page
-            case 0x45:
-                adress_8bit = memory[regPC + 1];
-                EOR(adress_8bit);
-                regPC += 2;
-                break;
-            //zero page, x
-            case 0x55:
-                adress_8bit = memory[regPC + 1] + regX;
-                EOR(adress_8bit);
-                regPC += 2;
-                break;
-            //absolute
-            case 0x4d:
-                //6502 is little endian
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                EOR(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
-            //absolute, x
-            case 0x5d:
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                adress_16bit += regX;
-                EOR(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
-            //absolute, y
-            case 0x59:
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                adress_16bit += regY;
-                EOR(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
-            //indirect, X
-            case 0x41:
-                //high byte
-                adress_16bit = memory[memory[regPC + 1] + 1 + regX];
-                adress_16bit <<= 8;
-                //low byte
-                adress_16bit += memory[memory[regPC + 1] + regX];
-                EOR(adress_16bit);
-                regPC += 2;
-                break;
-            //indirect, Y
-            case 0x51:
-                //high byte
-                adress_16bit = memory[memory[regPC + 1] + 1 + regY];
-                adress_16bit <<= 8;
-                //low byte
-                adress_16bit += memory[memory[regPC + 1] + regY];
-                EOR(adress_16bit);
-                regPC += 2;
-                break;
+    void writeState(StateWriter& state) const{
+        StateHeader header = {STATE_MAGIC, STATE_VERSION, 0, romChecksum()};
+        state.put(header);
+        state.put(regA);
+        state.put(regX);
+        state.put(regY);
+        state.put(getStatus());
+        state.put(regSP);
+        state.put(regPC);
+        state.put(cycles);
+        state.put(jammed);
+        state.put(controllers);
+        bus.saveState(state);
+        if(mapper){
+            mapper->saveState(state);
+        }
+        ppu.saveState(state);
+        apu.saveState(state);
+        header.size = state.size();
+        std::memcpy(state.finish(), &header, sizeof(header));
+    }
 
-            //FLAG Instructions
-            case 0x18:
-                CLC();
-                regPC++;
-                break;
-            case 0x38:
-                SEC();
-                regPC++;
-                break;
-            case 0x58:
-                CLI();
-                regPC++;
-                break;
-            case 0x78:
-                SEI();
-                regPC++;
-                break;
-            case 0xb8:
-                CLV();
-                regPC++;
-                break;
-            case 0xd8:
-                CLD();
-                regPC++;
-                break;
-            case 0xf8:
-                SED();
-            
-            //INC (Increment Memory)
-            //zero page
-            case 0xe6:
-                adress_8bit = memory[regPC + 1];
-                INC(adress_8bit);
-                regPC += 2;
-                break;
-            //zero page,x
-            case 0xf6:
-                adress_8bit = memory[regPC + 1] + regX;
-                INC(adress_8bit);
-                regPC += 2;
-                break;
-            //absolute
-            case 0xee:
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                INC(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
-            //absolute,x
-            case 0xfe:
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                adress_16bit += regX;
-                INC(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
-            
-            //JMP (Jump)
-            //absolute
-            case 0x4c:
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                JMP(adress_16bit + 0x4020);
-                //regPC += 3;
-                break;
-            //indirect
-            case 0x6c:
-                //high byte
-                adress_16bit = memory[memory[regPC + 1] + 1];
-                adress_16bit <<= 8;
-                //low byte
-                adress_16bit += memory[memory[regPC + 1]];
-                JMP(adress_16bit);
-                //regPC += 2;
-                break;
-            
-            //JSR (Jump To Subroutine)
-            //absolute
-            case 0x20:
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                JSR(adress_16bit + 0x4020);
-                //regPC += 3;
-                break;
+    //builds the mapper for the opened rom and powers the console on
+    RomError insert(){
+        mapper = createMapper(*rom, bus);
+        if(!mapper){
+            return RomError::UnsupportedMapper;
+        }
+        mapper->reset();
+#ifndef CPU_NO_BLOCK_CACHE
+        flushBlocks();
+#endif
+        ppu.connect(mapper.get());
+        ppu.reset(cycles);
+
+        reset();
+        apu.reset(cycles);
+        scheduleDevices();
+        return RomError::None;
+    }
 
-            //LDA (Load Accumulator)
-            //imidiate
-            case 0xa9:
-                adress_16bit = regPC + 1; 
-                LDA(memory[adress_16bit]);
-                regPC += 2;
-                break;
-            //zero page
-            case 0xa5:
-                adress_8bit = memory[regPC + 1];
-                LDA(adress_8bit);
-                regPC += 2;
-                break;
-            //zero page, x
-            case 0xb5:
-                adress_8bit = memory[regPC + 1] + regX;
-                LDA(adress_8bit);
-                regPC += 2;
-                break;
-            //absolute
-            case 0xad:
-                //6502 is little endian
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                LDA(memory[adress_16bit + 0x4020]); 
-                regPC += 3;
-                break;
-            //absolute, x
-            case 0xbd:
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                adress_16bit += regX;
-                LDA(memory[adress_16bit + 0x4020]);
-                regPC += 3;
-                break;
-            //absolute, y
-            case 0xb9:
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                adress_16bit += regY;
-                LDA(memory[adress_16bit + 0x4020]);
-                regPC += 3;
-                break;
-            //indirect, X
-            case 0xa1:
-                //high byte
-                adress_16bit = memory[memory[regPC + 1] + 1 + regX];
-                adress_16bit <<= 8;
-                //low byte
-                adress_16bit += memory[memory[regPC + 1] + regX];
-                LDA(memory[adress_16bit]);
-                regPC += 2;
-                break;
-            //indirect, Y
-            case 0xb1:
-                //high byte
-                adress_16bit = memory[memory[regPC + 1] + 1 + regY];
-                adress_16bit <<= 8;
-                //low byte
-                adress_16bit += memory[memory[regPC + 1] + regY];
-                LDA(memory[adress_16bit]);
-                regPC += 2;
-                break;
+public:
+    //jumps through the reset vector at 0xfffc like the console does at power on
+    void reset(){
+        regSP = 0xfd;
+        regP = regP | 0b00100100;
+        std::uint16_t adress = read(0xfffd);
+        adress <<= 8;
+        adress += read(0xfffc);
+        regPC = adress;
+        cycles += 7;
+        jammed = false;
+    }
 
-            //LDX (Load X Register)
-            //imidiate
-            case 0xa2:
-                adress_16bit = regPC + 1;
-                LDX(memory[adress_16bit]);
-                regPC += 2;
-                break;
-            //zero page
-            case 0xa6:
-                adress_8bit = memory[regPC + 1];
-                LDX(adress_8bit);
-                regPC += 2;
-                break;
-            //zero page, y
-            case 0xb6:
-                adress_8bit = memory[regPC + 1] + regY;
-                LDX(adress_8bit);
-                regPC += 2;
-                break;
-            //absolute
-            case 0xae:
-                //6502 is little endian
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                LDX(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
-            //absolute, y
-            case 0xbe:
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                adress_16bit += regY;
-                LDX(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
+    Bus& getBus(){
+        return bus;
+    }
 
-            //LDY (Load Y Register)
-            //imidiate
-            case 0xa0:
-                adress_16bit = regPC + 1;
-                LDY(memory[adress_16bit]);
-                regPC += 2;
-                break;
-            //zero page
-            case 0xa4:
-                adress_8bit = memory[regPC + 1];
-                LDY(adress_8bit);
-                regPC += 2;
-                break;
-            //zero page, x
-            case 0xb4:
-                adress_8bit = memory[regPC + 1] + regX;
-                LDY(adress_8bit);
-                regPC += 2;
-                break;
-            //absolute
-            case 0xac:
-                //6502 is little endian
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                LDY(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
-            //absolute, x
-            case 0xbc:
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                adress_16bit += regX;
-                LDY(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
-            
-            //LSR (Logical Shift Right)
-            //Accumulator
-            case 0x4a:
-                memory[0] = regA;
-                LSR(0);
-                regA = memory[0];
-                regPC ++;
-                break;
-            //zero page
-            case 0x46:
-                adress_8bit = memory[regPC + 1];
-                LSR(adress_8bit);
-                regPC += 2;
-                break;
-            //zero page, x
-            case 0x56:
-                adress_8bit = memory[regPC + 1] + regX;
-                LSR(adress_8bit);
-                regPC += 2;
-                break;
-            //absolute
-            case 0x4e:
-                //6502 is little endian
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                LSR(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
-            //absolute, x
-            case 0x5e:
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                adress_16bit += regX;
-                LSR(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
-            
-            //NOP (No Operation)
-            //implied
-            case 0xea:
-                regPC ++;
-                break;
-            
-            //ORA (Bitwise Or With Accumulator)
-            //imidiate
-            case 0x09:
-                adress_16bit = regPC + 1;
-                ORA(adress_16bit);
-                regPC += 2;
-                break;
-            //zero page
-            case 0x05:
-                adress_8bit = memory[regPC + 1];
-                ORA(adress_8bit);
-                regPC += 2;
-                break;
-            //zero page, x
-            case 0x15:
-                adress_8bit = memory[regPC + 1] + regX;
-                ORA(adress_8bit);
-                regPC += 2;
-                break;
-            //absolute
-            case 0x0d:
-                //6502 is little endian
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                ORA(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
-            //absolute, x
-            case 0x1d:
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                adress_16bit += regX;
-                ORA(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
-            //absolute, y
-            case 0x19:
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                adress_16bit += regY;
-                ORA(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
-            //indirect, X
-            case 0x01:
-                //high byte
-                adress_16bit = memory[memory[regPC + 1] + 1 + regX];
-                adress_16bit <<= 8;
-                //low byte
-                adress_16bit += memory[memory[regPC + 1] + regX];
-                ORA(adress_16bit);
-                regPC += 2;
-                break;
-            //indirect, Y
-            case 0x11:
-                //high byte
-                adress_16bit = memory[memory[regPC + 1] + 1 + regY];
-                adress_16bit <<= 8;
-                //low byte
-                adress_16bit += memory[memory[regPC + 1] + regY];
-                ORA(adress_16bit);
-                regPC += 2;
-                break;
-            
-            //Register instructions
-            case 0xaa:
-                TAX();
-                regPC++;
-                break;
-            case 0x8a:
-                TXA();
-                regPC++;
-                break;
-            case 0xca:
-                DEX();
-                regPC++;
-                break;
-            case 0xe8:
-                INX();
-                regPC++;
-                break;
-            case 0xa8:
-                TAY();
-                regPC++;
-                break;
-            case 0x98:
-                TYA();
-                regPC++;
-                break;
-            case 0x88:
-                DEY();
-                regPC++;
-                break;
-            case 0xc8:
-                INY();
-                regPC++;
-                break;
-            
-            //ROL (Rotate Left)
-            //Accumulator
-            case 0x2a:
-                memory[0] = regA;
-                ROL(0);
-                regA = memory[0];
-                regPC ++;
-                break;
-            //zero page
-            case 0x26:
-                adress_8bit = memory[regPC + 1];
-                ROL(adress_8bit);
-                regPC += 2;
-                break;
-            //zero page, x
-            case 0x36:
-                adress_8bit = memory[regPC + 1] + regX;
-                ROL(adress_8bit);
-                regPC += 2;
-                break;
-            //absolute
-            case 0x2e:
-                //6502 is little endian
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                ROL(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
-            //absolute, x
-            case 0x3e:
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                adress_16bit += regX;
-                ROL(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
+    //an empty rom until one is loaded
+    const Rom& getRom() const{
+        static const Rom none;
+        return rom ? *rom : none;
+    }
 
-            //ROR (Rotate Right)
-            //Accumulator
-            case 0x6a:
-                memory[0] = regA;
-                ROR(0);
-                regA = memory[0];
-                regPC ++;
-                break;
-            //zero page
-            case 0x66:
-                adress_8bit = memory[regPC + 1];
-                ROR(adress_8bit);
-                regPC += 2;
-                break;
-            //zero page, x
-            case 0x76:
-                adress_8bit = memory[regPC + 1] + regX;
-                ROR(adress_8bit);
-                regPC += 2;
-                break;
-            //absolute
-            case 0x6e:
-                //6502 is little endian
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                ROR(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
-            //absolute, x
-            case 0x7e:
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                adress_16bit += regX;
-                ROR(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
+    //null until a rom is loaded, hand it to another console's load to run the same image
+    const std::shared_ptr<const Rom>& getSharedRom() const{
+        return rom;
+    }
 
-            //RTI (Return from Intertupt)
-            //implied
-            case 0x40:
-                RTI();
-                break;
-            //RST (Return from Subroutine)
-            //implied
-            case 0x60:
-                RTS();
-                break;
-            
-            //SBC (Subtract with Carry)
-             //imidiate
-            case 0xe9:
-                adress_16bit = regPC + 1;
-                SBC(adress_16bit);
-                regPC += 2;
-                break;
-            //zero page
-            case 0xe5:
-                adress_8bit = memory[regPC + 1];
-                SBC(adress_8bit);
-                regPC += 2;
-                break;
-            //zero page, x
-            case 0xf5:
-                adress_8bit = memory[regPC + 1] + regX;
-                SBC(adress_8bit);
-                regPC += 2;
-                break;
-            //absolute
-            case 0xed:
-                //6502 is little endian
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                SBC(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
-            //absolute, x
-            case 0xfd:
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                adress_16bit += regX;
-                SBC(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
-            //absolute, y
-            case 0xf9:
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                adress_16bit += regY;
-                SBC(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
-            //indirect, X
-            case 0xe1:
-                //high byte
-                adress_16bit = memory[memory[regPC + 1] + 1 + regX];
-                adress_16bit <<= 8;
-                //low byte
-                adress_16bit += memory[memory[regPC + 1] + regX];
-                SBC(adress_16bit);
-                regPC += 2;
-                break;
-            //indirect, Y
-            case 0xf1:
-                //high byte
-                adress_16bit = memory[memory[regPC + 1] + 1 + regY];
-                adress_16bit <<= 8;
-                //low byte
-                adress_16bit += memory[memory[regPC + 1] + regY];
-                SBC(adress_16bit);
-                regPC += 2;
-                break;
+    PPU& getPPU(){
+        return ppu;
+    }
 
-            //STA (Store Accumulator)
-            //zero page
-            case 0x85:
-                adress_8bit = memory[regPC + 1];
-                STA(adress_8bit);
-                regPC += 2;
-                break;
-            //zero page, x
-            case 0x95:
-                adress_8bit = memory[regPC + 1] + regX;
-                STA(adress_8bit);
-                regPC += 2;
-                break;
-            //absolute
-            case 0x8d:
-                //6502 is little endian
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                //adress_16bit = *((short*)&memory[regPC + 1]);
-
-                STA(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
-            //absolute, x
-            case 0x9d:
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                adress_16bit += regX;
-                STA(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
-            //absolute, y
-            case 0x99:
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                adress_16bit += regY;
-                STA(adress_16bit + 0x4020);
-                regPC += 3;
-                break;
-            //indirect, X
-            case 0x81:
-                //high byte
-                adress_16bit = memory[memory[regPC + 1] + 1 + regX];
-                adress_16bit <<= 8;
-                //low byte
-                adress_16bit += memory[memory[regPC + 1] + regX];
-                STA(adress_16bit);
-                regPC += 2;
-                break;
-            //indirect, Y
-            case 0x91:
-                //high byte
-                adress_16bit = memory[memory[regPC + 1] + 1 + regY];
-                adress_16bit <<= 8;
-                //low byte
-                adress_16bit += memory[memory[regPC + 1] + regY];
-                STA(adress_16bit);
-                regPC += 2;
-                break;
-            
-            //Stack INstructions
-            case 0x9a:
-                TXS();
-                regPC++;
-                break;
-            case 0xba:
-                TSX();
-                regPC++;
-                break;
-            case 0x48:
-                PHA(); 
-                regPC++;
-                break;
-            case 0x68:
-                PLA();
-                regPC++;
-                break;
-            case 0x08:
-                PHP();
-                regPC++;
-                break;
-            case 0x28:
-                PLP();
-                regPC++;
-                break;
-            
-            //STX (Store X Register)
-            //zero page
-            case 0x86:
-                adress_8bit = memory[regPC + 1];
-                STX(adress_8bit);
-                regPC += 2;
-                break;
-            //zero page, y
-            case 0x96:
-                adress_8bit = memory[regPC + 1] + regY;
-                STX(adress_8bit);
-                regPC += 2;
+    APU& getAPU(){
+        return apu;
+    }
+
+    //null until a rom is loaded
+    Mapper* getMapper(){
+        return mapper.get();
+    }
+
+private:
+    //pushes PC and SR and jumps through the vector, used for nmi and irq
+    void interrupt(std::uint16_t vector){
+#ifndef CPU_NO_TRACE
+        if(trace){
+            traceRecord(TRACE_INTERRUPT, vector, 0, 0, 0);
+        }
+#endif
+#ifdef CPU_PROFILE
+        std::uint8_t sp = regSP;
+#endif
+        write(0x100 + regSP--, regPC >> 8);
+        write(0x100 + regSP--, regPC & 0xff);
+        write(0x100 + regSP--, (getStatus() | 0b00100000) & 0b11101111);
+        regP = regP | 0b00000100;
+        std::uint16_t adress = read(vector + 1);
+        adress <<= 8;
+        adress += read(vector);
+        regPC = adress;
+        cycles += 7;
+#ifdef CPU_PROFILE
+        if(profiler){
+            profiler->call(profileLocation(regPC), regPC, sp, vector == 0xfffa ? PROFILE_NMI : PROFILE_IRQ);
+            profiler->recordInterrupt(7);
+        }
+#endif
+    }
+
+    //0x4000-0x40ff, apu and joypad registers plus sprite dma
+    static std::uint8_t readIo(void* context, std::uint16_t adress){
+        CPU& cpu = *static_cast<CPU*>(context);
+        if(adress == 0x4015){
+            cpu.apu.sync(cpu.cycles);
+            return cpu.apu.readStatus();
+        }
+        if(adress == 0x4016 || adress == 0x4017){
+            //only bit 0 is driven, the top bits keep what was last on the bus
+            return (cpu.bus.getOpenBus() & 0b11100000) | cpu.controllers[adress - 0x4016].read();
+        }
+        return cpu.bus.getOpenBus();
+    }
+
+    static void writeIo(void* context, std::uint16_t adress, std::uint8_t value){
+        CPU& cpu = *static_cast<CPU*>(context);
+        if(adress == 0x4014){
+            cpu.oamDma(value);
+        }else if(adress == 0x4016){
+            //one strobe line goes to both ports
+            cpu.controllers[0].write(value);
+            cpu.controllers[1].write(value);
+        }else if(adress <= 0x4013 || adress == 0x4015 || adress == 0x4017){
+            cpu.apu.sync(cpu.cycles);
+            cpu.apu.writeRegister(adress, value);
+            cpu.scheduler.schedule(EventType::Apu, cpu.apu.nextSyncCycle());
+        }
+#ifdef CPU_JIT
+        //dma and apu writes move the next events, compiled code has to come back out
+        cpu.jit_deadline = 0;
+#endif
+    }
+
+    //every handler access goes through here first, the ppu is brought up to the cpu so register
+    //reads see the right state and register or bank writes land at the right point of the frame.
+    //the apu syncs itself in readIo and writeIo
+    static void syncDevices(void* context, std::uint16_t){
+        CPU& cpu = *static_cast<CPU*>(context);
+        cpu.ppu.run(cpu.cycles);
+    }
+
+    void scheduleDevices(){
+        scheduler.schedule(EventType::Ppu, ppu.nextSyncCycle());
+        scheduler.schedule(EventType::Apu, apu.nextSyncCycle());
+    }
+
+    //runs every device whose event has come up and asks it for the next one
+    void runEvents(){
+        while(scheduler.nextCycle() <= cycles){
+            switch(scheduler.pop()){
+                case EventType::Ppu:
+                    ppu.run(cycles);
+                    scheduler.schedule(EventType::Ppu, ppu.nextSyncCycle());
+                    break;
+                case EventType::Apu:
+                    apu.sync(cycles);
+                    scheduler.schedule(EventType::Apu, apu.nextSyncCycle());
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    //copies a page to sprite memory, the cpu is stalled for 513 cycles (514 on odd cycles)
+    void oamDma(std::uint8_t page){
+        for(int i = 0; i < 256; i++){
+            ppu.writeOam(read((page << 8) | i));
+        }
+        cycles += 513 + (cycles & 1);
+    }
+
+    //the loop behind every headless run
+    RunSummary runUntil(std::uint64_t cycle_limit, std::uint64_t max_instructions, std::uint64_t frame_limit){
+        std::uint64_t start_cycles = cycles;
+        std::uint64_t start_frame = ppu.getFrame();
+        std::uint64_t instructions = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        while(!jammed && instructions < max_instructions && cycles < cycle_limit && ppu.getFrame() < frame_limit){
+            if(bus.interruptPending()){
+                pollInterrupts();
+            }
+#ifdef CPU_JIT
+            //compiled code only starts on a block boundary, mid block the interpreter finishes the block
+            std::uint64_t ran = 0;
+            if(jit_enabled && next_op->pc != regPC && !isTracing() && !isProfiling()){
+                jit_deadline = std::min(cycle_limit, scheduler.nextCycle());
+                ran = runJit(max_instructions - instructions);
+            }
+            if(ran == 0){
+                execute();
+                ran = 1;
+            }
+            instructions += ran;
+#else
+            execute();
+            instructions++;
+#endif
+            if(cycles >= scheduler.nextCycle()){
+                runEvents();
+            }
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        RunSummary summary;
+        summary.instructions = instructions;
+        summary.cycles = cycles - start_cycles;
+        summary.seconds = std::chrono::duration<double>(end - start).count();
+        summary.mips = summary.seconds > 0 ? instructions / summary.seconds / 1e6 : 0;
+        summary.frames = ppu.getFrame() - start_frame;
+        summary.jammed = jammed;
+        return summary;
+    }
+
+    //nmi always wins, irq waits until the interrupt disable flag is clear
+    void pollInterrupts(){
+        if(bus.takeNmi()){
+            interrupt(0xfffa);
+        }else if(bus.getIrq() && !(regP & 0b00000100)){
+            interrupt(0xfffe);
+        }
+    }
+
+    std::uint8_t read(std::uint16_t adress){
+#ifndef CPU_NO_TRACE
+        if(trace_memory){
+            std::uint8_t value = bus.read(adress);
+            traceRecord(TRACE_READ, adress, value, 0, 0);
+            return value;
+        }
+#endif
+        return bus.read(adress);
+    }
+
+    void write(std::uint16_t adress, std::uint8_t value){
+#ifndef CPU_NO_TRACE
+        if(trace_memory){
+            traceRecord(TRACE_WRITE, adress, value, peek(adress), 0);
+        }
+#endif
+        bus.write(adress, value);
+    }
+
+#ifndef CPU_NO_TRACE
+    //tracing
+    //built in unless CPU_NO_TRACE is defined, costs a test per instruction and per memory access
+    //while off. records go into a TraceBuffer the caller owns, see Trace.hpp
+    //memory behind a plain page without going through the bus, what registers show when looked at
+    //by a debugger. pages with handlers read as 0xff
+    std::uint8_t peek(std::uint16_t adress) const{
+        const std::uint8_t* memory = bus.getPageMemory(adress >> 8);
+        return memory ? memory[adress & 0xff] : 0xff;
+    }
+
+    __attribute__((noinline)) void traceRecord(std::uint8_t kind, std::uint16_t adress, std::uint8_t byte0,
+                                               std::uint8_t byte1, std::uint8_t byte2){
+        TraceRecord record = {};
+        record.cycle = cycles;
+        record.adress = adress;
+        record.kind = kind;
+        record.bytes[0] = byte0;
+        record.bytes[1] = byte1;
+        record.bytes[2] = byte2;
+        record.a = regA;
+        record.x = regX;
+        record.y = regY;
+        record.p = getStatus();
+        record.sp = regSP;
+        trace->push(record);
+    }
+
+    //the instruction at regPC, before it runs
+    void traceInstruction(){
+        traceRecord(TRACE_INSTRUCTION, regPC, peek(regPC), peek(regPC + 1), peek(regPC + 2));
+    }
+#endif
+
+#ifdef CPU_PROFILE
+    //only built in with CPU_PROFILE, without it there is nothing left of the profiler in the cpu
+    //offset of the code at adress in PRG_ROM past PROFILE_ROM, or the adress when it is not in the image
+    std::uint32_t profileLocation(std::uint16_t adress) const{
+        const std::uint8_t* memory = bus.getPageMemory(adress >> 8);
+        std::span<const std::uint8_t> prg = getRom().getPrgRom();
+        if(memory){
+            const std::uint8_t* code = memory + (adress & 0xff);
+            if(code >= prg.data() && code < prg.data() + prg.size()){
+                return PROFILE_ROM + (code - prg.data());
+            }
+        }
+        return adress;
+    }
+
+    //do_operation with the instruction counted, JSR and BRK enter a frame and RTS/RTI leave them
+    __attribute__((noinline)) void profileOperation(std::uint8_t op_code){
+        std::uint16_t pc = regPC;
+        std::uint8_t sp = regSP;
+        std::uint64_t start = cycles;
+        cycles += cycle_table[op_code];
+        dispatch_table[op_code](*this);
+        profiler->record(op_code, profileLocation(pc), pc, cycles - start);
+        if(op_code == 0x20){
+            profiler->call(profileLocation(regPC), regPC, sp, PROFILE_CALL);
+        }else if(op_code == 0x00){
+            profiler->call(profileLocation(regPC), regPC, sp, PROFILE_IRQ);
+        }else if(op_code == 0x60 || op_code == 0x40){
+            profiler->unwind(regSP);
+        }
+    }
+#endif
+
+    //operand bytes of the current instruction, straight from the block cache when cached
+    template<bool cached>
+    std::uint8_t operandByte(){
+        if constexpr(cached){
+            return operand;
+        }else{
+            return read(regPC + 1);
+        }
+    }
+
+    template<bool cached>
+    std::uint16_t operandWord(){
+        if constexpr(cached){
+            return operand;
+        }else{
+            //6502 is little endian
+            std::uint16_t word = read(regPC + 2);
+            word <<= 8;
+            word += read(regPC + 1);
+            return word;
+        }
+    }
+
+    //addressing modes
+    //each one returns the effective adress and moves regPC past the operands
+    //immediate has no adress worth reading again, it returns the value, see execute_immediate
+    template<bool cached>
+    std::uint8_t immediate(){
+        std::uint8_t value = operandByte<cached>();
+        regPC += 2;
+        return value;
+    }
+
+    template<bool cached>
+    std::uint16_t zero_page(){
+        std::uint8_t adress = operandByte<cached>();
+        regPC += 2;
+        return adress;
+    }
+
+    template<bool cached>
+    std::uint16_t zero_page_x(){
+        std::uint8_t adress = operandByte<cached>() + regX;
+        regPC += 2;
+        return adress;
+    }
+
+    template<bool cached>
+    std::uint16_t zero_page_y(){
+        std::uint8_t adress = operandByte<cached>() + regY;
+        regPC += 2;
+        return adress;
+    }
+
+    template<bool cached>
+    std::uint16_t absolute(){
+        std::uint16_t adress = operandWord<cached>();
+        regPC += 3;
+        return adress;
+    }
+
+    //indexed modes cost one extra cycle when the index crosses a page,
+    //but only for reads, stores and read-modify-writes always pay it in their base count
+    template<bool cached, bool page_penalty>
+    std::uint16_t absolute_x(){
+        std::uint16_t base = operandWord<cached>();
+        std::uint16_t adress = base + regX;
+        if(page_penalty){
+            cycles += (base ^ adress) >> 8 != 0;
+        }
+        regPC += 3;
+        return adress;
+    }
+
+    template<bool cached, bool page_penalty>
+    std::uint16_t absolute_y(){
+        std::uint16_t base = operandWord<cached>();
+        std::uint16_t adress = base + regY;
+        if(page_penalty){
+            cycles += (base ^ adress) >> 8 != 0;
+        }
+        regPC += 3;
+        return adress;
+    }
+
+    template<bool cached>
+    std::uint16_t indirect(){
+        std::uint16_t pointer = absolute<cached>();
+        //high byte, the 6502 does not carry into the pointer's high byte
+        std::uint16_t adress = read((pointer & 0xff00) | ((pointer + 1) & 0x00ff));
+        adress <<= 8;
+        //low byte
+        adress += read(pointer);
+        return adress;
+    }
+
+    template<bool cached>
+    std::uint16_t indirect_x(){
+        std::uint8_t pointer = operandByte<cached>() + regX;
+        //high byte, the pointer wraps around the zero page
+        std::uint16_t adress = read((std::uint8_t)(pointer + 1));
+        adress <<= 8;
+        //low byte
+        adress += read(pointer);
+        regPC += 2;
+        return adress;
+    }
+
+    template<bool cached, bool page_penalty>
+    std::uint16_t indirect_y(){
+        std::uint8_t pointer = operandByte<cached>();
+        //high byte, the pointer wraps around the zero page
+        std::uint16_t base = read((std::uint8_t)(pointer + 1));
+        base <<= 8;
+        //low byte
+        base += read(pointer);
+        std::uint16_t adress = base + regY;
+        if(page_penalty){
+            cycles += (base ^ adress) >> 8 != 0;
+        }
+        regPC += 2;
+        return adress;
+    }
+
+    template<bool cached>
+    std::uint16_t relative(){
+        std::uint16_t adress = 2 + regPC + (std::int8_t)operandByte<cached>();
+        regPC += 2;
+        return adress;
+    }
+
+    //handlers that pair one addressing mode with one operation
+    //they are instantiated at compile time, so every table entry is a single call
+    template<std::uint16_t (CPU::*addressing)(), void (CPU::*operation)(std::uint16_t)>
+    static void execute(CPU& cpu){
+        (cpu.*operation)((cpu.*addressing)());
+    }
+
+    //operations on the value at the adress
+    template<std::uint16_t (CPU::*addressing)(), void (CPU::*operation)(std::uint8_t)>
+    static void execute_read(CPU& cpu){
+        (cpu.*operation)(cpu.read((cpu.*addressing)()));
+    }
+
+    //the same operations on the operand byte itself, from the block cache when cached
+    template<bool cached, void (CPU::*operation)(std::uint8_t)>
+    static void execute_immediate(CPU& cpu){
+        (cpu.*operation)(cpu.immediate<cached>());
+    }
+
+    //read-modify-write operations on memory
+    template<std::uint16_t (CPU::*addressing)(), std::uint8_t (CPU::*operation)(std::uint8_t)>
+    static void modify(CPU& cpu){
+        std::uint16_t adress = (cpu.*addressing)();
+        cpu.write(adress, (cpu.*operation)(cpu.read(adress)));
+    }
+
+    //read-modify-write operations on the accumulator
+    template<std::uint8_t (CPU::*operation)(std::uint8_t)>
+    static void modify_accumulator(CPU& cpu){
+        cpu.regPC++;
+        cpu.regA = (cpu.*operation)(cpu.regA);
+    }
+
+    template<void (CPU::*operation)()>
+    static void execute_implied(CPU& cpu){
+        cpu.regPC++;
+        (cpu.*operation)();
+    }
+
+    //unknown op codes jam the cpu, regPC is left pointing at the bad op code
+    static void illegal(CPU& cpu){
+        cpu.jammed = true;
+    }
+
+    //base cycles for every opcode, page crossing and taken branches are added by the handlers
+    static constexpr std::uint8_t cycle_table[256] = {
+    //  0  1  2  3  4  5  6  7  8  9  a  b  c  d  e  f
+        7, 6, 2, 8, 3, 3, 5, 5, 3, 2, 2, 2, 4, 4, 6, 6, //0
+        2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7, //1
+        6, 6, 2, 8, 3, 3, 5, 5, 4, 2, 2, 2, 4, 4, 6, 6, //2
+        2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7, //3
+        6, 6, 2, 8, 3, 3, 5, 5, 3, 2, 2, 2, 3, 4, 6, 6, //4
+        2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7, //5
+        6, 6, 2, 8, 3, 3, 5, 5, 4, 2, 2, 2, 5, 4, 6, 6, //6
+        2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7, //7
+        2, 6, 2, 6, 3, 3, 3, 3, 2, 2, 2, 2, 4, 4, 4, 4, //8
+        2, 6, 2, 6, 4, 4, 4, 4, 2, 5, 2, 5, 5, 5, 5, 5, //9
+        2, 6, 2, 6, 3, 3, 3, 3, 2, 2, 2, 2, 4, 4, 4, 4, //a
+        2, 5, 2, 5, 4, 4, 4, 4, 2, 4, 2, 4, 4, 4, 4, 4, //b
+        2, 6, 2, 8, 3, 3, 5, 5, 2, 2, 2, 2, 4, 4, 6, 6, //c
+        2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7, //d
+        2, 6, 2, 8, 3, 3, 5, 5, 2, 2, 2, 2, 4, 4, 6, 6, //e
+        2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7  //f
+    };
+
+    //bytes each instruction takes, op code included
+    static constexpr std::uint8_t length_table[256] = {
+    //  0  1  2  3  4  5  6  7  8  9  a  b  c  d  e  f
+        1, 2, 1, 1, 2, 2, 2, 1, 1, 2, 1, 1, 3, 3, 3, 1, //0
+        2, 2, 1, 1, 2, 2, 2, 1, 1, 3, 1, 1, 3, 3, 3, 1, //1
+        3, 2, 1, 1, 2, 2, 2, 1, 1, 2, 1, 1, 3, 3, 3, 1, //2
+        2, 2, 1, 1, 2, 2, 2, 1, 1, 3, 1, 1, 3, 3, 3, 1, //3
+        1, 2, 1, 1, 2, 2, 2, 1, 1, 2, 1, 1, 3, 3, 3, 1, //4
+        2, 2, 1, 1, 2, 2, 2, 1, 1, 3, 1, 1, 3, 3, 3, 1, //5
+        1, 2, 1, 1, 2, 2, 2, 1, 1, 2, 1, 1, 3, 3, 3, 1, //6
+        2, 2, 1, 1, 2, 2, 2, 1, 1, 3, 1, 1, 3, 3, 3, 1, //7
+        2, 2, 1, 1, 2, 2, 2, 1, 1, 2, 1, 1, 3, 3, 3, 1, //8
+        2, 2, 1, 1, 2, 2, 2, 1, 1, 3, 1, 1, 3, 3, 3, 1, //9
+        2, 2, 2, 1, 2, 2, 2, 1, 1, 2, 1, 1, 3, 3, 3, 1, //a
+        2, 2, 1, 1, 2, 2, 2, 1, 1, 3, 1, 1, 3, 3, 3, 1, //b
+        2, 2, 1, 1, 2, 2, 2, 1, 1, 2, 1, 1, 3, 3, 3, 1, //c
+        2, 2, 1, 1, 2, 2, 2, 1, 1, 3, 1, 1, 3, 3, 3, 1, //d
+        2, 2, 1, 1, 2, 2, 2, 1, 1, 2, 1, 1, 3, 3, 3, 1, //e
+        2, 2, 1, 1, 2, 2, 2, 1, 1, 3, 1, 1, 3, 3, 3, 1  //f
+    };
+
+    typedef void (*Handler)(CPU&);
+    static const std::array<Handler, 256> dispatch_table;
+    static const std::array<Handler, 256> block_table;     //same handlers taking their operands from the block cache
+
+    template<bool cached>
+    static constexpr std::array<Handler, 256> make_dispatch_table(){
+        std::array<Handler, 256> table{};
+        for(Handler& handler : table){
+            handler = &CPU::illegal;
+        }
+
+        //ADC (ADD with Carry)
+        table[0x69] = &CPU::execute_immediate<cached, &CPU::ADC>;
+        table[0x65] = &CPU::execute_read<&CPU::zero_page<cached>, &CPU::ADC>;
+        table[0x75] = &CPU::execute_read<&CPU::zero_page_x<cached>, &CPU::ADC>;
+        table[0x6d] = &CPU::execute_read<&CPU::absolute<cached>, &CPU::ADC>;
+        table[0x7d] = &CPU::execute_read<&CPU::absolute_x<cached, true>, &CPU::ADC>;
+        table[0x79] = &CPU::execute_read<&CPU::absolute_y<cached, true>, &CPU::ADC>;
+        table[0x61] = &CPU::execute_read<&CPU::indirect_x<cached>, &CPU::ADC>;
+        table[0x71] = &CPU::execute_read<&CPU::indirect_y<cached, true>, &CPU::ADC>;
+
+        //AND (Bitwise and with Accumulator)
+        table[0x29] = &CPU::execute_immediate<cached, &CPU::AND>;
+        table[0x25] = &CPU::execute_read<&CPU::zero_page<cached>, &CPU::AND>;
+        table[0x35] = &CPU::execute_read<&CPU::zero_page_x<cached>, &CPU::AND>;
+        table[0x2d] = &CPU::execute_read<&CPU::absolute<cached>, &CPU::AND>;
+        table[0x3d] = &CPU::execute_read<&CPU::absolute_x<cached, true>, &CPU::AND>;
+        table[0x39] = &CPU::execute_read<&CPU::absolute_y<cached, true>, &CPU::AND>;
+        table[0x21] = &CPU::execute_read<&CPU::indirect_x<cached>, &CPU::AND>;
+        table[0x31] = &CPU::execute_read<&CPU::indirect_y<cached, true>, &CPU::AND>;
+
+        //ASL (Arithmetic Shift Left)
+        table[0x0a] = &CPU::modify_accumulator<&CPU::ASL>;
+        table[0x06] = &CPU::modify<&CPU::zero_page<cached>, &CPU::ASL>;
+        table[0x16] = &CPU::modify<&CPU::zero_page_x<cached>, &CPU::ASL>;
+        table[0x0e] = &CPU::modify<&CPU::absolute<cached>, &CPU::ASL>;
+        table[0x1e] = &CPU::modify<&CPU::absolute_x<cached, false>, &CPU::ASL>;
+
+        //BIT (test BITs)
+        table[0x24] = &CPU::execute<&CPU::zero_page<cached>, &CPU::BIT>;
+        table[0x2c] = &CPU::execute<&CPU::absolute<cached>, &CPU::BIT>;
+
+        //BRANCH instructions
+        table[0x10] = &CPU::execute<&CPU::relative<cached>, &CPU::BPL>;
+        table[0x30] = &CPU::execute<&CPU::relative<cached>, &CPU::BMI>;
+        table[0x50] = &CPU::execute<&CPU::relative<cached>, &CPU::BVC>;
+        table[0x70] = &CPU::execute<&CPU::relative<cached>, &CPU::BVS>;
+        table[0x90] = &CPU::execute<&CPU::relative<cached>, &CPU::BCC>;
+        table[0xb0] = &CPU::execute<&CPU::relative<cached>, &CPU::BCS>;
+        table[0xd0] = &CPU::execute<&CPU::relative<cached>, &CPU::BNE>;
+        table[0xf0] = &CPU::execute<&CPU::relative<cached>, &CPU::BEQ>;
+
+        //BRK (Break)
+        table[0x00] = &CPU::execute_implied<&CPU::BRK>;
+
+        //CMP (Compare accumulator)
+        table[0xc9] = &CPU::execute_immediate<cached, &CPU::CMP>;
+        table[0xc5] = &CPU::execute_read<&CPU::zero_page<cached>, &CPU::CMP>;
+        table[0xd5] = &CPU::execute_read<&CPU::zero_page_x<cached>, &CPU::CMP>;
+        table[0xcd] = &CPU::execute_read<&CPU::absolute<cached>, &CPU::CMP>;
+        table[0xdd] = &CPU::execute_read<&CPU::absolute_x<cached, true>, &CPU::CMP>;
+        table[0xd9] = &CPU::execute_read<&CPU::absolute_y<cached, true>, &CPU::CMP>;
+        table[0xc1] = &CPU::execute_read<&CPU::indirect_x<cached>, &CPU::CMP>;
+        table[0xd1] = &CPU::execute_read<&CPU::indirect_y<cached, true>, &CPU::CMP>;
+
+        //CPX (Compare X Register)
+        table[0xe0] = &CPU::execute_immediate<cached, &CPU::CPX>;
+        table[0xe4] = &CPU::execute_read<&CPU::zero_page<cached>, &CPU::CPX>;
+        table[0xec] = &CPU::execute_read<&CPU::absolute<cached>, &CPU::CPX>;
+
+        //CPY (Compare Y Register)
+        table[0xc0] = &CPU::execute_immediate<cached, &CPU::CPY>;
+        table[0xc4] = &CPU::execute_read<&CPU::zero_page<cached>, &CPU::CPY>;
+        table[0xcc] = &CPU::execute_read<&CPU::absolute<cached>, &CPU::CPY>;
+
+        //DEC (Decrement memory)
+        table[0xc6] = &CPU::modify<&CPU::zero_page<cached>, &CPU::DEC>;
+        table[0xd6] = &CPU::modify<&CPU::zero_page_x<cached>, &CPU::DEC>;
+        table[0xce] = &CPU::modify<&CPU::absolute<cached>, &CPU::DEC>;
+        table[0xde] = &CPU::modify<&CPU::absolute_x<cached, false>, &CPU::DEC>;
+
+        //EOR (bitwise Exclusive OR)
+        table[0x49] = &CPU::execute_immediate<cached, &CPU::EOR>;
+        table[0x45] = &CPU::execute_read<&CPU::zero_page<cached>, &CPU::EOR>;
+        table[0x55] = &CPU::execute_read<&CPU::zero_page_x<cached>, &CPU::EOR>;
+        table[0x4d] = &CPU::execute_read<&CPU::absolute<cached>, &CPU::EOR>;
+        table[0x5d] = &CPU::execute_read<&CPU::absolute_x<cached, true>, &CPU::EOR>;
+        table[0x59] = &CPU::execute_read<&CPU::absolute_y<cached, true>, &CPU::EOR>;
+        table[0x41] = &CPU::execute_read<&CPU::indirect_x<cached>, &CPU::EOR>;
+        table[0x51] = &CPU::execute_read<&CPU::indirect_y<cached, true>, &CPU::EOR>;
+
+        //FLAG Instructions
+        table[0x18] = &CPU::execute_implied<&CPU::CLC>;
+        table[0x38] = &CPU::execute_implied<&CPU::SEC>;
+        table[0x58] = &CPU::execute_implied<&CPU::CLI>;
+        table[0x78] = &CPU::execute_implied<&CPU::SEI>;
+        table[0xb8] = &CPU::execute_implied<&CPU::CLV>;
+        table[0xd8] = &CPU::execute_implied<&CPU::CLD>;
+        table[0xf8] = &CPU::execute_implied<&CPU::SED>;
+
+        //INC (Increment Memory)
+        table[0xe6] = &CPU::modify<&CPU::zero_page<cached>, &CPU::INC>;
+        table[0xf6] = &CPU::modify<&CPU::zero_page_x<cached>, &CPU::INC>;
+        table[0xee] = &CPU::modify<&CPU::absolute<cached>, &CPU::INC>;
+        table[0xfe] = &CPU::modify<&CPU::absolute_x<cached, false>, &CPU::INC>;
+
+        //JMP (Jump)
+        table[0x4c] = &CPU::execute<&CPU::absolute<cached>, &CPU::JMP>;
+        table[0x6c] = &CPU::execute<&CPU::indirect<cached>, &CPU::JMP>;
+
+        //JSR (Jump To Subroutine)
+        table[0x20] = &CPU::execute<&CPU::absolute<cached>, &CPU::JSR>;
+
+        //LDA (Load Accumulator)
+        table[0xa9] = &CPU::execute_immediate<cached, &CPU::LDA>;
+        table[0xa5] = &CPU::execute_read<&CPU::zero_page<cached>, &CPU::LDA>;
+        table[0xb5] = &CPU::execute_read<&CPU::zero_page_x<cached>, &CPU::LDA>;
+        table[0xad] = &CPU::execute_read<&CPU::absolute<cached>, &CPU::LDA>;
+        table[0xbd] = &CPU::execute_read<&CPU::absolute_x<cached, true>, &CPU::LDA>;
+        table[0xb9] = &CPU::execute_read<&CPU::absolute_y<cached, true>, &CPU::LDA>;
+        table[0xa1] = &CPU::execute_read<&CPU::indirect_x<cached>, &CPU::LDA>;
+        table[0xb1] = &CPU::execute_read<&CPU::indirect_y<cached, true>, &CPU::LDA>;
+
+        //LDX (Load X Register)
+        table[0xa2] = &CPU::execute_immediate<cached, &CPU::LDX>;
+        table[0xa6] = &CPU::execute_read<&CPU::zero_page<cached>, &CPU::LDX>;
+        table[0xb6] = &CPU::execute_read<&CPU::zero_page_y<cached>, &CPU::LDX>;
+        table[0xae] = &CPU::execute_read<&CPU::absolute<cached>, &CPU::LDX>;
+        table[0xbe] = &CPU::execute_read<&CPU::absolute_y<cached, true>, &CPU::LDX>;
+
+        //LDY (Load Y Register)
+        table[0xa0] = &CPU::execute_immediate<cached, &CPU::LDY>;
+        table[0xa4] = &CPU::execute_read<&CPU::zero_page<cached>, &CPU::LDY>;
+        table[0xb4] = &CPU::execute_read<&CPU::zero_page_x<cached>, &CPU::LDY>;
+        table[0xac] = &CPU::execute_read<&CPU::absolute<cached>, &CPU::LDY>;
+        table[0xbc] = &CPU::execute_read<&CPU::absolute_x<cached, true>, &CPU::LDY>;
+
+        //LSR (Logical Shift Right)
+        table[0x4a] = &CPU::modify_accumulator<&CPU::LSR>;
+        table[0x46] = &CPU::modify<&CPU::zero_page<cached>, &CPU::LSR>;
+        table[0x56] = &CPU::modify<&CPU::zero_page_x<cached>, &CPU::LSR>;
+        table[0x4e] = &CPU::modify<&CPU::absolute<cached>, &CPU::LSR>;
+        table[0x5e] = &CPU::modify<&CPU::absolute_x<cached, false>, &CPU::LSR>;
+
+        //NOP (No Operation)
+        table[0xea] = &CPU::execute_implied<&CPU::NOP>;
+
+        //ORA (Bitwise Or With Accumulator)
+        table[0x09] = &CPU::execute_immediate<cached, &CPU::ORA>;
+        table[0x05] = &CPU::execute_read<&CPU::zero_page<cached>, &CPU::ORA>;
+        table[0x15] = &CPU::execute_read<&CPU::zero_page_x<cached>, &CPU::ORA>;
+        table[0x0d] = &CPU::execute_read<&CPU::absolute<cached>, &CPU::ORA>;
+        table[0x1d] = &CPU::execute_read<&CPU::absolute_x<cached, true>, &CPU::ORA>;
+        table[0x19] = &CPU::execute_read<&CPU::absolute_y<cached, true>, &CPU::ORA>;
+        table[0x01] = &CPU::execute_read<&CPU::indirect_x<cached>, &CPU::ORA>;
+        table[0x11] = &CPU::execute_read<&CPU::indirect_y<cached, true>, &CPU::ORA>;
+
+        //Register instructions
+        table[0xaa] = &CPU::execute_implied<&CPU::TAX>;
+        table[0x8a] = &CPU::execute_implied<&CPU::TXA>;
+        table[0xca] = &CPU::execute_implied<&CPU::DEX>;
+        table[0xe8] = &CPU::execute_implied<&CPU::INX>;
+        table[0xa8] = &CPU::execute_implied<&CPU::TAY>;
+        table[0x98] = &CPU::execute_implied<&CPU::TYA>;
+        table[0x88] = &CPU::execute_implied<&CPU::DEY>;
+        table[0xc8] = &CPU::execute_implied<&CPU::INY>;
+
+        //ROL (Rotate Left)
+        table[0x2a] = &CPU::modify_accumulator<&CPU::ROL>;
+        table[0x26] = &CPU::modify<&CPU::zero_page<cached>, &CPU::ROL>;
+        table[0x36] = &CPU::modify<&CPU::zero_page_x<cached>, &CPU::ROL>;
+        table[0x2e] = &CPU::modify<&CPU::absolute<cached>, &CPU::ROL>;
+        table[0x3e] = &CPU::modify<&CPU::absolute_x<cached, false>, &CPU::ROL>;
+
+        //ROR (Rotate Right)
+        table[0x6a] = &CPU::modify_accumulator<&CPU::ROR>;
+        table[0x66] = &CPU::modify<&CPU::zero_page<cached>, &CPU::ROR>;
+        table[0x76] = &CPU::modify<&CPU::zero_page_x<cached>, &CPU::ROR>;
+        table[0x6e] = &CPU::modify<&CPU::absolute<cached>, &CPU::ROR>;
+        table[0x7e] = &CPU::modify<&CPU::absolute_x<cached, false>, &CPU::ROR>;
+
+        //RTI (Return from Intertupt)
+        table[0x40] = &CPU::execute_implied<&CPU::RTI>;
+        //RTS (Return from Subroutine)
+        table[0x60] = &CPU::execute_implied<&CPU::RTS>;
+
+        //SBC (Subtract with Carry)
+        table[0xe9] = &CPU::execute_immediate<cached, &CPU::SBC>;
+        table[0xe5] = &CPU::execute_read<&CPU::zero_page<cached>, &CPU::SBC>;
+        table[0xf5] = &CPU::execute_read<&CPU::zero_page_x<cached>, &CPU::SBC>;
+        table[0xed] = &CPU::execute_read<&CPU::absolute<cached>, &CPU::SBC>;
+        table[0xfd] = &CPU::execute_read<&CPU::absolute_x<cached, true>, &CPU::SBC>;
+        table[0xf9] = &CPU::execute_read<&CPU::absolute_y<cached, true>, &CPU::SBC>;
+        table[0xe1] = &CPU::execute_read<&CPU::indirect_x<cached>, &CPU::SBC>;
+        table[0xf1] = &CPU::execute_read<&CPU::indirect_y<cached, true>, &CPU::SBC>;
+
+        //STA (Store Accumulator)
+        table[0x85] = &CPU::execute<&CPU::zero_page<cached>, &CPU::STA>;
+        table[0x95] = &CPU::execute<&CPU::zero_page_x<cached>, &CPU::STA>;
+        table[0x8d] = &CPU::execute<&CPU::absolute<cached>, &CPU::STA>;
+        table[0x9d] = &CPU::execute<&CPU::absolute_x<cached, false>, &CPU::STA>;
+        table[0x99] = &CPU::execute<&CPU::absolute_y<cached, false>, &CPU::STA>;
+        table[0x81] = &CPU::execute<&CPU::indirect_x<cached>, &CPU::STA>;
+        table[0x91] = &CPU::execute<&CPU::indirect_y<cached, false>, &CPU::STA>;
+
+        //Stack INstructions
+        table[0x9a] = &CPU::execute_implied<&CPU::TXS>;
+        table[0xba] = &CPU::execute_implied<&CPU::TSX>;
+        table[0x48] = &CPU::execute_implied<&CPU::PHA>;
+        table[0x68] = &CPU::execute_implied<&CPU::PLA>;
+        table[0x08] = &CPU::execute_implied<&CPU::PHP>;
+        table[0x28] = &CPU::execute_implied<&CPU::PLP>;
+
+        //STX (Store X Register)
+        table[0x86] = &CPU::execute<&CPU::zero_page<cached>, &CPU::STX>;
+        table[0x96] = &CPU::execute<&CPU::zero_page_y<cached>, &CPU::STX>;
+        table[0x8e] = &CPU::execute<&CPU::absolute<cached>, &CPU::STX>;
+
+        //STY (Store Y Register)
+        table[0x84] = &CPU::execute<&CPU::zero_page<cached>, &CPU::STY>;
+        table[0x94] = &CPU::execute<&CPU::zero_page_x<cached>, &CPU::STY>;
+        table[0x8c] = &CPU::execute<&CPU::absolute<cached>, &CPU::STY>;
+
+        return table;
+    }
+
+    //where straight line code stops, for the block cache and lockstep lanes
+    static constexpr bool endsBlock(std::uint8_t op_code){
+        //branches, JSR, RTI, RTS, JMP and BRK
+        return (op_code & 0x1f) == 0x10 || op_code == 0x20 || op_code == 0x40 || op_code == 0x60
+            || op_code == 0x4c || op_code == 0x6c || op_code == 0x00;
+    }
+
+#ifndef CPU_NO_BLOCK_CACHE
+    //block cache
+    //straight runs of code up to a branch, jump or return are decoded once into handlers with their
+    //operands, so hot loops skip fetching and decoding op codes. a block is tied to the memory it
+    //was decoded from through that page's write counter on the bus, which moves on self modifying
+    //code and when a bank switch remaps the page. build with CPU_NO_BLOCK_CACHE to fetch and
+    //decode every instruction
+    struct CachedOp {
+        Handler handler;
+        std::uint32_t pc;           //0x10000 marks the end of a block, it never matches regPC
+        std::uint16_t operand;
+        std::uint8_t cycles;
+    };
+
+#ifdef CPU_JIT
+    //compiled block, takes the cpu and an instruction budget and returns the instructions it ran
+    typedef std::uint64_t (*JitFunction)(CPU*, std::uint64_t);
+#endif
+
+    struct Block {
+        const std::uint32_t* version;   //write counter of the page the code came from, null for an empty slot
+        std::uint32_t seen;             //its value when the block was decoded
+        std::uint16_t pc;
+#ifdef CPU_JIT
+        std::uint32_t hits;             //entries so far, compiled once it reaches JIT_HOT_BLOCK
+        JitFunction code;               //null until compiled
+#endif
+        CachedOp ops[BLOCK_LENGTH + 1];
+    };
+
+    std::unique_ptr<Block[]> blocks;
+    const CachedOp* next_op;            //next op of the block being run
+    const std::uint32_t* block_version; //copies of the running block's check, kept close
+    std::uint32_t block_seen;
+
+    static constexpr CachedOp no_block = {nullptr, 0x10000, 0, 0};
+
+    //decodes the code at regPC into a block, false when the code is not plain memory
+    __attribute__((noinline)) bool decodeBlock(Block& block){
+        std::uint8_t page = regPC >> 8;
+        const std::uint8_t* memory = bus.getPageMemory(page);
+        if(!memory){
+            return false;
+        }
+        const std::uint32_t* version = bus.getPageVersion(page);
+
+        block.version = version;
+        block.seen = *version;
+        block.pc = regPC;
+#ifdef CPU_JIT
+        block.hits = 0;
+        block.code = nullptr;
+#endif
+        //blocks stay inside their page, an instruction hanging over the end runs uncached
+        int count = 0;
+        unsigned offset = regPC & 0xff;
+        while(count < BLOCK_LENGTH){
+            std::uint8_t op_code = memory[offset];
+            unsigned length = length_table[op_code];
+            if(offset + length > PAGE_SIZE){
                 break;
-            //absolute
-            case 0x8e:
-                //6502 is little endian
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                STX(adress_16bit + 0x4020);
-                regPC += 3;
+            }
+            CachedOp& op = block.ops[count++];
+            op.handler = block_table[op_code];
+            op.pc = (regPC & 0xff00) | offset;
+            op.operand = 0;
+            if(length > 1){
+                op.operand = memory[offset + 1];
+            }
+            if(length > 2){
+                op.operand = op.operand | (memory[offset + 2] << 8);
+            }
+            op.cycles = cycle_table[op_code];
+            offset += length;
+            if(endsBlock(op_code) || dispatch_table[op_code] == &CPU::illegal){
                 break;
+            }
+        }
+        block.ops[count] = no_block;
+        if(count == 0){
+            block.version = nullptr;
+            return false;
+        }
+        return true;
+    }
 
-            //STY (Store Y Register)
-            //zero page
-            case 0x84:
-                adress_8bit = memory[regPC + 1];
-                STY(adress_8bit);
-                regPC += 2;
-                break;
-            //zero page, x
-            case 0x94:
-                adress_8bit = memory[regPC + 1] + regX;
-                STY(adress_8bit);
-                regPC += 2;
+    //drops every block, needed when memory is swapped under the same adresses (a new rom)
+    void flushBlocks(){
+        for(int i = 0; i < BLOCK_CACHE_SIZE; i++){
+            blocks[i].version = nullptr;
+        }
+        next_op = &no_block;
+        block_version = &block_seen;
+        block_seen = 0;
+    }
+
+#ifdef CPU_JIT
+    //recompiler
+    //hot blocks become x86-64 functions that keep the cpu in rbx. most instructions are a call to
+    //the same handler the block cache uses, register only ones are written out inline. after each
+    //instruction the code leaves when the budget is gone, when cycles reach jit_deadline (the next
+    //scheduled event, so no device has to be run in between), when the block's page was written to
+    //or when an interrupt is waiting. the caller then runs the ppu and apu and goes on from regPC,
+    //through the interpreter if the next block is cold or could not be compiled
+    std::unique_ptr<JitBuffer> jit; //created the first time the recompiler is turned on
+    bool jit_enabled;
+    std::uint64_t jit_deadline;     //compiled code stops once cycles gets here, 0 stops it right away
+
+    std::int32_t field(const void* member) const{
+        return static_cast<const char*>(member) - reinterpret_cast<const char*>(this);
+    }
+
+    //sets N and Z from eax, which holds the result zero extended
+    void emitNZ(){
+#ifdef CPU_LAZY_FLAGS
+        jit->storeAx(field(&nz_result));
+#else
+        jit->lookupCl(NZ_TABLE.data());
+        jit->andByte(field(&regP), 0b01111101);
+        jit->orByteCl(field(&regP));
+#endif
+    }
+
+    //writes the op out without a call when it only moves registers, false when it needs its handler
+    bool emitInline(std::uint8_t op_code, std::uint16_t operand){
+        std::uint8_t* from = nullptr;
+        std::uint8_t* to = nullptr;
+        switch(op_code){
+            case 0xaa: from = &regA; to = &regX; break;    //TAX
+            case 0xa8: from = &regA; to = &regY; break;    //TAY
+            case 0x8a: from = &regX; to = &regA; break;    //TXA
+            case 0x98: from = &regY; to = &regA; break;    //TYA
+            case 0xba: from = &regSP; to = &regX; break;   //TSX
+            case 0xe8: from = &regX; to = &regX; break;    //INX
+            case 0xc8: from = &regY; to = &regY; break;    //INY
+            case 0xca: from = &regX; to = &regX; break;    //DEX
+            case 0x88: from = &regY; to = &regY; break;    //DEY
+            case 0xa9: to = &regA; break;                  //LDA immediate
+            case 0xa2: to = &regX; break;                  //LDX immediate
+            case 0xa0: to = &regY; break;                  //LDY immediate
+            case 0x9a:                                      //TXS, no flags
+                jit->loadAl(field(&regX));
+                jit->storeAl(field(&regSP));
+                return true;
+            case 0x18:                                      //CLC
+#ifdef CPU_LAZY_FLAGS
+                jit->movByte(field(&carry), 0);
+#else
+                jit->andByte(field(&regP), 0b11111110);
+#endif
+                return true;
+            case 0x38:                                      //SEC
+#ifdef CPU_LAZY_FLAGS
+                jit->movByte(field(&carry), 1);
+#else
+                jit->orByte(field(&regP), 0b00000001);
+#endif
+                return true;
+            case 0xea:                                      //NOP
+                return true;
+            default:
+                return false;
+        }
+        if(from){
+            jit->loadAl(field(from));
+        }else{
+            jit->movEax(operand & 0xff);
+        }
+        if(op_code == 0xe8 || op_code == 0xc8){
+            jit->incAl();
+        }else if(op_code == 0xca || op_code == 0x88){
+            jit->decAl();
+        }
+        jit->storeAl(field(to));
+        emitNZ();
+        return true;
+    }
+
+    //writes a decoded block into the buffer, false when it does not fit even into an empty one
+    bool emitBlock(Block& block){
+        const std::uint8_t* memory = bus.getPageMemory(block.pc >> 8);
+        for(int attempt = 0; attempt < 2; attempt++){
+            std::size_t start = jit->position();
+            jit->prologue();
+            for(const CachedOp* op = block.ops; op->handler; op++){
+                std::uint8_t op_code = memory[op->pc & 0xff];
+                bool last = !op[1].handler;
+                jit->addQword(field(&cycles), op->cycles);
+                bool called = false;
+                if(!last && emitInline(op_code, op->operand)){
+                    jit->movWord(field(&regPC), op[1].pc);
+                }else{
+                    jit->movWord(field(&operand), op->operand);
+                    jit->callCpu(reinterpret_cast<const void*>(op->handler));
+                    called = true;
+                }
+                jit->decBudget();
+                if(last){
+                    break;
+                }
+                jit->exitIf(JitBuffer::EQUAL);
+                jit->cmpQwords(field(&cycles), field(&jit_deadline));
+                jit->exitIf(JitBuffer::ABOVE_EQUAL);
+                if(called){
+                    //a write into this page changes the code after this op, a bank switch the whole page
+                    jit->cmpDwordAt(block.version, block.seen);
+                    jit->exitIf(JitBuffer::NOT_EQUAL);
+                    jit->cmpByteAt(bus.getNmiLine(), 0);
+                    jit->exitIf(JitBuffer::NOT_EQUAL);
+                    jit->cmpByteAt(bus.getIrqLines(), 0);
+                    std::size_t no_irq = jit->skipIfEqual();
+                    jit->testByte(field(&regP), 0b00000100);
+                    jit->exitIf(JitBuffer::EQUAL);
+                    jit->skipTo(no_irq);
+                }
+            }
+            jit->epilogue();
+            if(jit->fits()){
+                block.code = reinterpret_cast<JitFunction>(const_cast<std::uint8_t*>(jit->at(start)));
+                return true;
+            }
+            //buffer full, start over with every block uncompiled
+            jit->clear();
+            for(int i = 0; i < BLOCK_CACHE_SIZE; i++){
+                blocks[i].code = nullptr;
+            }
+        }
+        return false;
+    }
+
+    //compiles a decoded block, the buffer is only writable in here and never while code in it runs
+    bool compileBlock(Block& block){
+        if(!jit->beginWrite()){
+            return false;
+        }
+        bool compiled = emitBlock(block);
+        if(!jit->endWrite()){
+            //nothing in the buffer can run any more, the interpreter takes over for good
+            jit_enabled = false;
+            for(int i = 0; i < BLOCK_CACHE_SIZE; i++){
+                blocks[i].code = nullptr;
+            }
+            return false;
+        }
+        return compiled;
+    }
+
+    //runs the block at regPC as compiled code, returns the instructions it ran or 0 when the
+    //interpreter has to take the next one
+    std::uint64_t runJit(std::uint64_t budget){
+        Block& found = blocks[regPC & (BLOCK_CACHE_SIZE - 1)];
+        if(found.pc != regPC || !found.version || *found.version != found.seen){
+            if(!decodeBlock(found)){
+                return 0;
+            }
+        }
+        if(!found.code){
+            if(++found.hits < JIT_HOT_BLOCK || !compileBlock(found)){
+                return 0;
+            }
+        }
+        next_op = &no_block;
+        return found.code(this, budget);
+    }
+#endif
+#endif
+
+    //runs the instruction at regPC, from the block cache when possible
+    void execute(){
+#ifndef CPU_NO_TRACE
+        if(trace){
+            traceInstruction();
+        }
+#endif
+#ifdef CPU_PROFILE
+        //the profiler sits in do_operation, so nothing runs from the block cache while it is on
+        if(profiler){
+            do_operation(read(regPC));
+            return;
+        }
+#endif
+#ifndef CPU_NO_BLOCK_CACHE
+        const CachedOp* op = next_op;
+        if(op->pc != regPC || *block_version != block_seen){
+            //a remap bumps the old page's counter too, so pc and counter are all a block needs to match
+            Block& found = blocks[regPC & (BLOCK_CACHE_SIZE - 1)];
+            if(found.pc != regPC || !found.version || *found.version != found.seen){
+                if(!decodeBlock(found)){
+                    next_op = &no_block;
+                    do_operation(read(regPC));
+                    return;
+                }
+            }
+            op = found.ops;
+            block_version = found.version;
+            block_seen = found.seen;
+        }
+        next_op = op + 1;
+        operand = op->operand;
+        cycles += op->cycles;
+        op->handler(*this);
+#else
+        do_operation(read(regPC));
+#endif
+    }
+
+public:
+    void do_operation(std::uint8_t op_code){
+#ifdef CPU_PROFILE
+        if(profiler){
+            profileOperation(op_code);
+            return;
+        }
+#endif
+        cycles += cycle_table[op_code];
+        dispatch_table[op_code](*this);
+    }
+
+    //executes the instruction at regPC and returns how many cycles it took
+    std::uint32_t step(){
+        std::uint64_t start = cycles;
+        if(bus.interruptPending()){
+            pollInterrupts();
+        }
+        execute();
+        runEvents();
+        return cycles - start;
+    }
+
+    //lockstep lanes, see Lanes.hpp
+    //a lane's registers and cycle count live in the lane group's arrays while it runs. the group
+    //hands them in for whatever it cannot do on all lanes at once (i/o, events, interrupts)
+    //and takes them back after, so every instruction still runs on the same handlers as here
+    struct LaneOp {
+        Handler handler;
+        std::uint16_t pc;
+        std::uint16_t operand;
+        std::uint8_t op_code;
+        std::uint8_t length;
+        std::uint8_t cycles;
+    };
+
+    //decodes straight line code at pc from the page memory it sits in, stopping where a block
+    //would. returns how many ops, 0 when the first one already hangs over the end of the page
+    static int decodeLane(const std::uint8_t* memory, std::uint16_t pc, LaneOp* ops){
+        int count = 0;
+        unsigned offset = pc & 0xff;
+        while(count < BLOCK_LENGTH){
+            std::uint8_t op_code = memory[offset];
+            unsigned length = length_table[op_code];
+            if(offset + length > PAGE_SIZE){
                 break;
-            //absolute
-            case 0x8c:
-                //6502 is little endian
-                adress_16bit = memory[regPC + 2];
-                adress_16bit <<= 8;
-                adress_16bit += memory[regPC + 1];
-                STY(adress_16bit + 0x4020);
-                regPC += 3;
+            }
+            LaneOp& op = ops[count++];
+            op.handler = block_table[op_code];
+            op.pc = (pc & 0xff00) | offset;
+            op.operand = length > 2 ? memory[offset + 1] | (memory[offset + 2] << 8) : length > 1 ? memory[offset + 1] : 0;
+            op.op_code = op_code;
+            op.length = length;
+            op.cycles = cycle_table[op_code];
+            offset += length;
+            if(endsBlock(op_code) || dispatch_table[op_code] == &CPU::illegal){
                 break;
-            
-            default:
-                std::cout<<"Error: Op Code not supported!"<<std::endl;
-                std::exit(1);
-            
+            }
         }
+        return count;
+    }
+
+    void setLane(const Registers& registers, std::uint64_t lane_cycles){
+        regA = registers.a;
+        regX = registers.x;
+        regY = registers.y;
+        setStatus(registers.p);
+        regSP = registers.sp;
+        regPC = registers.pc;
+        cycles = lane_cycles;
+    }
+
+    //one decoded op with regPC at it, then the devices when they are due, as runUntil would
+    void runLaneOp(const LaneOp& op){
+        operand = op.operand;
+        cycles += op.cycles;
+        op.handler(*this);
+        if(cycles >= scheduler.nextCycle()){
+            runEvents();
+        }
+    }
+
+    //for the cycles a lane ran without the cpu
+    void runLaneEvents(){
+        if(cycles >= scheduler.nextCycle()){
+            runEvents();
+        }
+    }
+
+    void takeInterrupts(){
+        if(bus.interruptPending()){
+            pollInterrupts();
+        }
+    }
+
+    //runs as runUntil would up to the end of the block at regPC, for a lane no other lane can
+    //share its code with. stops early at either limit or when the cpu jams, returns the instructions run
+    int runLaneBlock(std::uint64_t cycle_limit, std::uint64_t frame_limit){
+        for(int i = 0; i < BLOCK_LENGTH; i++){
+            takeInterrupts();
+            const std::uint8_t* memory = bus.getPageMemory(regPC >> 8);
+            bool last = !memory || endsBlock(memory[regPC & 0xff]);
+            execute();
+            runLaneEvents();
+            if(last || jammed || cycles >= cycle_limit || ppu.getFrame() >= frame_limit){
+                return i + 1;
+            }
+        }
+        return BLOCK_LENGTH;
+    }
+
+    //the next cycle a device has to be run at
+    std::uint64_t getDeadline() const{
+        return scheduler.nextCycle();
+    }
+
+    //records every instruction into buffer from now on, and every read and write when memory is
+    //set. null turns it off, the recompiler stays out of the way while it is on. false when
+    //tracing was built out with CPU_NO_TRACE
+    bool setTrace(TraceBuffer* buffer, [[maybe_unused]] bool memory = false){
+#ifndef CPU_NO_TRACE
+        trace = buffer;
+        trace_memory = buffer && memory;
+        return true;
+#else
+        return !buffer;
+#endif
+    }
+
+    bool isTracing() const{
+#ifndef CPU_NO_TRACE
+        return trace;
+#else
+        return false;
+#endif
+    }
+
+    static constexpr bool traceAvailable(){
+#ifndef CPU_NO_TRACE
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    //counts every instruction into profiler from now on, null turns it off. the block cache and
+    //the recompiler stay out of the way while it is on. false when the cpu was built without
+    //CPU_PROFILE, which is the default so that profiling costs nothing when it is not wanted
+    bool setProfiler(Profiler* counts){
+#ifdef CPU_PROFILE
+        profiler = counts;
+        if(profiler){
+            profiler->reserveRom(getRom().getPrgRom().size());
+        }
+        return true;
+#else
+        return !counts;
+#endif
+    }
+
+    bool isProfiling() const{
+#ifdef CPU_PROFILE
+        return profiler;
+#else
+        return false;
+#endif
+    }
+
+    bool isJammed() const{
+        return jammed;
+    }
+
+    std::uint16_t getPC() const{
+        return regPC;
+    }
+
+    //carries on from somewhere else, like nestest's automated mode starting at 0xc000
+    void setPC(std::uint16_t adress){
+        regPC = adress;
+    }
+
+    Registers getRegisters() const{
+        return {regA, regX, regY, getStatus(), regSP, regPC};
+    }
+
+    //turns the recompiler on or off for runHeadless and runFrames, false when it is not
+    //available on this host (built without it or no executable memory)
+    bool setJit(bool enabled){
+#ifdef CPU_JIT
+        if(enabled && !jit){
+            jit = std::make_unique<JitBuffer>();
+        }
+        jit_enabled = enabled && jit->usable();
+        next_op = &no_block;
+        return jit_enabled == enabled;
+#else
+        return !enabled;
+#endif
+    }
+
+    bool isJitEnabled() const{
+#ifdef CPU_JIT
+        return jit_enabled;
+#else
+        return false;
+#endif
+    }
+
+    static constexpr bool jitAvailable(){
+#ifdef CPU_JIT
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    //buttons held on port 0 or 1, BUTTON_* bits. games see them at their next strobe
+    void setButtons(int port, std::uint8_t buttons){
+        controllers[port & 1].buttons = buttons;
+    }
+
+    std::uint8_t getButtons(int port) const{
+        return controllers[port & 1].buttons;
+    }
+
+    //cpu cycles since power on, every other part of the console is scheduled against this
+    std::uint64_t getCycles() const{
+        return cycles;
+    }
+
+    //copies a raw program into memory and points regPC at it
+    void loadProgram(const std::uint8_t* program, std::size_t size, std::uint16_t start){
+        for(std::size_t i = 0; i < size && start + i <= 0xffff; i++){
+            write(start + i, program[i]);
+        }
+        regPC = start;
     }
 
     void run(){
-        //beggining of the program
-        regPC = 0x4020;
         std::uint8_t op_code = 0;
         while(true){
-            op_code = memory[regPC];
+            if(bus.interruptPending()){
+                pollInterrupts();
+            }
+            op_code = read(regPC);
             std::cout<<std::endl<<"OP_CODE: "<<std::hex<<std::setw(2)<<std::setfill('0')<<(int)op_code<<std::endl;
             std::cout<<"regPC: "<<std::hex<<std::setw(4)<<std::setfill('0')<<(int)regPC<<std::endl;
             do_operation(op_code);
-            printMemory(0x041f,0x0425);
+            runEvents();
+            if(jammed){
+                std::cout<<"Error: Op Code not supported!"<<std::endl;
+                std::exit(1);
+            }
+            printMemory(0x0000,0x000f);
             std::cout<<std::endl;
             std::this_thread::sleep_for(std::chrono::milliseconds(750));
         }
     }
 
+    //runs from the current regPC as fast as the host allows, without any i/o,
+    //until either budget is used up or the cpu jams
+    RunSummary runHeadless(std::uint64_t max_cycles = UINT64_MAX, std::uint64_t max_instructions = UINT64_MAX){
+        std::uint64_t cycle_limit = max_cycles > UINT64_MAX - cycles ? UINT64_MAX : cycles + max_cycles;
+        return runUntil(cycle_limit, max_instructions, UINT64_MAX);
+    }
+
+    //runs headless until the ppu has finished the given number of frames
+    RunSummary runFrames(std::uint64_t frames){
+        return runUntil(UINT64_MAX, UINT64_MAX, ppu.getFrame() + frames);
+    }
+
     void printMemory(std::uint16_t first, std::uint16_t last){
         //printing status register
         std::uint8_t mask = 1;
-        std::uint8_t statusReg = regP;
+        std::uint8_t statusReg = getStatus();
         std::cout<<"Status register:"<<std::endl;
         std::cout<<"C Z I D B - V N"<<std::endl;
         for(int i = 0 ; i < 8 ; i++){
@@ -2025,7 +2051,7 @@ public:
         int row_counter = 0;
         std::cout<<std::hex;
         for( ; first <= last ; first++){
-            std::cout<<std::setfill('0')<<std::setw(2)<<(unsigned int)memory[first]<<" ";
+            std::cout<<std::setfill('0')<<std::setw(2)<<(unsigned int)read(first)<<" ";
             row_counter++;
             if(row_counter % 16 == 0){
                 std::cout<<std::endl;
@@ -2035,4 +2061,7 @@ public:
     }
 };
 
+inline const std::array<CPU::Handler, 256> CPU::dispatch_table = CPU::make_dispatch_table<false>();
+inline const std::array<CPU::Handler, 256> CPU::block_table = CPU::make_dispatch_table<true>();
+
 #endif // CPU_HPP_INCLUDED
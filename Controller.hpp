@@ -0,0 +1,41 @@
+#ifndef CONTROLLER_HPP_INCLUDED
+#define CONTROLLER_HPP_INCLUDED
+
+#include<cstdint>
+
+//button bits, in the order the controller shifts them out
+#define BUTTON_A 0b00000001
+#define BUTTON_B 0b00000010
+#define BUTTON_SELECT 0b00000100
+#define BUTTON_START 0b00001000
+#define BUTTON_UP 0b00010000
+#define BUTTON_DOWN 0b00100000
+#define BUTTON_LEFT 0b01000000
+#define BUTTON_RIGHT 0b10000000
+
+//standard controller on 0x4016/0x4017
+//writing 1 then 0 to 0x4016 latches the buttons, every read then shifts one out, A first
+struct Controller {
+    std::uint8_t buttons;       //what is held right now, BUTTON_* bits
+    std::uint8_t shift;         //latched buttons not read yet
+    bool strobe;                //while set the latch keeps reloading, reads all see A
+
+    void write(std::uint8_t value){
+        strobe = value & 1;
+        if(strobe){
+            shift = buttons;
+        }
+    }
+
+    std::uint8_t read(){
+        if(strobe){
+            return buttons & 1;
+        }
+        std::uint8_t bit = shift & 1;
+        //official controllers return 1 once all eight are out
+        shift = (shift >> 1) | 0b10000000;
+        return bit;
+    }
+};
+
+#endif // CONTROLLER_HPP_INCLUDED
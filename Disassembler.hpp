@@ -0,0 +1,290 @@
+#ifndef DISASSEMBLER_HPP_INCLUDED
+#define DISASSEMBLER_HPP_INCLUDED
+
+#include<array>
+#include<cstdint>
+#include<cstddef>
+#include<cstdio>
+#include<ostream>
+#include<string>
+#include<vector>
+#include"Trace.hpp"
+
+enum class AddressingMode : std::uint8_t {
+    Implied,
+    Accumulator,
+    Immediate,
+    ZeroPage,
+    ZeroPageX,
+    ZeroPageY,
+    Absolute,
+    AbsoluteX,
+    AbsoluteY,
+    Indirect,
+    IndirectX,
+    IndirectY,
+    Relative
+};
+
+struct OpInfo {
+    const char* mnemonic;       //"???" for op codes the cpu does not run
+    AddressingMode mode;
+};
+
+constexpr std::array<OpInfo, 256> makeOpTable(){
+    typedef AddressingMode M;
+    std::array<OpInfo, 256> table{};
+    for(OpInfo& info : table){
+        info = {"???", M::Implied};
+    }
+    struct Entry {
+        std::uint8_t op_code;
+        OpInfo info;
+    };
+    const Entry entries[] = {
+        {0x69, {"ADC", M::Immediate}}, {0x65, {"ADC", M::ZeroPage}}, {0x75, {"ADC", M::ZeroPageX}}, {0x6d, {"ADC", M::Absolute}},
+        {0x7d, {"ADC", M::AbsoluteX}}, {0x79, {"ADC", M::AbsoluteY}}, {0x61, {"ADC", M::IndirectX}}, {0x71, {"ADC", M::IndirectY}},
+        {0x29, {"AND", M::Immediate}}, {0x25, {"AND", M::ZeroPage}}, {0x35, {"AND", M::ZeroPageX}}, {0x2d, {"AND", M::Absolute}},
+        {0x3d, {"AND", M::AbsoluteX}}, {0x39, {"AND", M::AbsoluteY}}, {0x21, {"AND", M::IndirectX}}, {0x31, {"AND", M::IndirectY}},
+        {0x0a, {"ASL", M::Accumulator}}, {0x06, {"ASL", M::ZeroPage}}, {0x16, {"ASL", M::ZeroPageX}}, {0x0e, {"ASL", M::Absolute}},
+        {0x1e, {"ASL", M::AbsoluteX}},
+        {0x90, {"BCC", M::Relative}}, {0xb0, {"BCS", M::Relative}}, {0xf0, {"BEQ", M::Relative}}, {0x30, {"BMI", M::Relative}},
+        {0xd0, {"BNE", M::Relative}}, {0x10, {"BPL", M::Relative}}, {0x50, {"BVC", M::Relative}}, {0x70, {"BVS", M::Relative}},
+        {0x24, {"BIT", M::ZeroPage}}, {0x2c, {"BIT", M::Absolute}},
+        {0x00, {"BRK", M::Implied}},
+        {0x18, {"CLC", M::Implied}}, {0xd8, {"CLD", M::Implied}}, {0x58, {"CLI", M::Implied}}, {0xb8, {"CLV", M::Implied}},
+        {0xc9, {"CMP", M::Immediate}}, {0xc5, {"CMP", M::ZeroPage}}, {0xd5, {"CMP", M::ZeroPageX}}, {0xcd, {"CMP", M::Absolute}},
+        {0xdd, {"CMP", M::AbsoluteX}}, {0xd9, {"CMP", M::AbsoluteY}}, {0xc1, {"CMP", M::IndirectX}}, {0xd1, {"CMP", M::IndirectY}},
+        {0xe0, {"CPX", M::Immediate}}, {0xe4, {"CPX", M::ZeroPage}}, {0xec, {"CPX", M::Absolute}},
+        {0xc0, {"CPY", M::Immediate}}, {0xc4, {"CPY", M::ZeroPage}}, {0xcc, {"CPY", M::Absolute}},
+        {0xc6, {"DEC", M::ZeroPage}}, {0xd6, {"DEC", M::ZeroPageX}}, {0xce, {"DEC", M::Absolute}}, {0xde, {"DEC", M::AbsoluteX}},
+        {0xca, {"DEX", M::Implied}}, {0x88, {"DEY", M::Implied}},
+        {0x49, {"EOR", M::Immediate}}, {0x45, {"EOR", M::ZeroPage}}, {0x55, {"EOR", M::ZeroPageX}}, {0x4d, {"EOR", M::Absolute}},
+        {0x5d, {"EOR", M::AbsoluteX}}, {0x59, {"EOR", M::AbsoluteY}}, {0x41, {"EOR", M::IndirectX}}, {0x51, {"EOR", M::IndirectY}},
+        {0xe6, {"INC", M::ZeroPage}}, {0xf6, {"INC", M::ZeroPageX}}, {0xee, {"INC", M::Absolute}}, {0xfe, {"INC", M::AbsoluteX}},
+        {0xe8, {"INX", M::Implied}}, {0xc8, {"INY", M::Implied}},
+        {0x4c, {"JMP", M::Absolute}}, {0x6c, {"JMP", M::Indirect}},
+        {0x20, {"JSR", M::Absolute}},
+        {0xa9, {"LDA", M::Immediate}}, {0xa5, {"LDA", M::ZeroPage}}, {0xb5, {"LDA", M::ZeroPageX}}, {0xad, {"LDA", M::Absolute}},
+        {0xbd, {"LDA", M::AbsoluteX}}, {0xb9, {"LDA", M::AbsoluteY}}, {0xa1, {"LDA", M::IndirectX}}, {0xb1, {"LDA", M::IndirectY}},
+        {0xa2, {"LDX", M::Immediate}}, {0xa6, {"LDX", M::ZeroPage}}, {0xb6, {"LDX", M::ZeroPageY}}, {0xae, {"LDX", M::Absolute}},
+        {0xbe, {"LDX", M::AbsoluteY}},
+        {0xa0, {"LDY", M::Immediate}}, {0xa4, {"LDY", M::ZeroPage}}, {0xb4, {"LDY", M::ZeroPageX}}, {0xac, {"LDY", M::Absolute}},
+        {0xbc, {"LDY", M::AbsoluteX}},
+        {0x4a, {"LSR", M::Accumulator}}, {0x46, {"LSR", M::ZeroPage}}, {0x56, {"LSR", M::ZeroPageX}}, {0x4e, {"LSR", M::Absolute}},
+        {0x5e, {"LSR", M::AbsoluteX}},
+        {0xea, {"NOP", M::Implied}},
+        {0x09, {"ORA", M::Immediate}}, {0x05, {"ORA", M::ZeroPage}}, {0x15, {"ORA", M::ZeroPageX}}, {0x0d, {"ORA", M::Absolute}},
+        {0x1d, {"ORA", M::AbsoluteX}}, {0x19, {"ORA", M::AbsoluteY}}, {0x01, {"ORA", M::IndirectX}}, {0x11, {"ORA", M::IndirectY}},
+        {0x48, {"PHA", M::Implied}}, {0x08, {"PHP", M::Implied}}, {0x68, {"PLA", M::Implied}}, {0x28, {"PLP", M::Implied}},
+        {0x2a, {"ROL", M::Accumulator}}, {0x26, {"ROL", M::ZeroPage}}, {0x36, {"ROL", M::ZeroPageX}}, {0x2e, {"ROL", M::Absolute}},
+        {0x3e, {"ROL", M::AbsoluteX}},
+        {0x6a, {"ROR", M::Accumulator}}, {0x66, {"ROR", M::ZeroPage}}, {0x76, {"ROR", M::ZeroPageX}}, {0x6e, {"ROR", M::Absolute}},
+        {0x7e, {"ROR", M::AbsoluteX}},
+        {0x40, {"RTI", M::Implied}}, {0x60, {"RTS", M::Implied}},
+        {0xe9, {"SBC", M::Immediate}}, {0xe5, {"SBC", M::ZeroPage}}, {0xf5, {"SBC", M::ZeroPageX}}, {0xed, {"SBC", M::Absolute}},
+        {0xfd, {"SBC", M::AbsoluteX}}, {0xf9, {"SBC", M::AbsoluteY}}, {0xe1, {"SBC", M::IndirectX}}, {0xf1, {"SBC", M::IndirectY}},
+        {0x38, {"SEC", M::Implied}}, {0xf8, {"SED", M::Implied}}, {0x78, {"SEI", M::Implied}},
+        {0x85, {"STA", M::ZeroPage}}, {0x95, {"STA", M::ZeroPageX}}, {0x8d, {"STA", M::Absolute}}, {0x9d, {"STA", M::AbsoluteX}},
+        {0x99, {"STA", M::AbsoluteY}}, {0x81, {"STA", M::IndirectX}}, {0x91, {"STA", M::IndirectY}},
+        {0x86, {"STX", M::ZeroPage}}, {0x96, {"STX", M::ZeroPageY}}, {0x8e, {"STX", M::Absolute}},
+        {0x84, {"STY", M::ZeroPage}}, {0x94, {"STY", M::ZeroPageX}}, {0x8c, {"STY", M::Absolute}},
+        {0xaa, {"TAX", M::Implied}}, {0xa8, {"TAY", M::Implied}}, {0xba, {"TSX", M::Implied}}, {0x8a, {"TXA", M::Implied}},
+        {0x9a, {"TXS", M::Implied}}, {0x98, {"TYA", M::Implied}}
+    };
+    for(const Entry& entry : entries){
+        table[entry.op_code] = entry.info;
+    }
+    return table;
+}
+
+inline constexpr std::array<OpInfo, 256> OP_TABLE = makeOpTable();
+
+//bytes an instruction takes in the given mode, op code included
+constexpr int instructionLength(AddressingMode mode){
+    switch(mode){
+        case AddressingMode::Implied:
+        case AddressingMode::Accumulator:
+            return 1;
+        case AddressingMode::Absolute:
+        case AddressingMode::AbsoluteX:
+        case AddressingMode::AbsoluteY:
+        case AddressingMode::Indirect:
+            return 3;
+        default:
+            return 2;
+    }
+}
+
+//turns a trace into the text of nestest.log, one line per instruction:
+//  C000  4C F5 C5  JMP $C5F5                       A:00 X:00 Y:00 P:24 SP:FD PPU:  0, 21 CYC:7
+//the memory values nestest.log shows come from the read and write records that follow each
+//instruction, so a trace taken without memory records leaves them out. the ppu position is worked
+//out from the cycle count, three dots per cycle and no odd frame skip, like nestest runs
+class NestestWriter {
+private:
+    const std::vector<TraceRecord>& records;
+    std::size_t first;      //memory records of the instruction being written
+    std::size_t last;
+
+    //value at adress before the instruction touched it, -1 when the trace does not say
+    int memory(std::uint16_t adress) const{
+        for(std::size_t i = first; i < last; i++){
+            const TraceRecord& record = records[i];
+            if(record.adress == adress){
+                if(record.kind == TRACE_READ){
+                    return record.bytes[0];
+                }
+                if(record.kind == TRACE_WRITE){
+                    return record.bytes[1];
+                }
+            }
+        }
+        return -1;
+    }
+
+    //a little endian pointer out of two memory values, -1 when either is missing
+    int pointer(std::uint16_t low, std::uint16_t high) const{
+        int low_byte = memory(low);
+        int high_byte = memory(high);
+        return low_byte < 0 || high_byte < 0 ? -1 : low_byte | (high_byte << 8);
+    }
+
+    void append(std::string& text, const char* format, int value) const{
+        char buffer[16];
+        std::snprintf(buffer, sizeof(buffer), format, value);
+        text += buffer;
+    }
+
+    //" = XX" with the value at adress, or nothing
+    void appendValue(std::string& text, int adress) const{
+        int value = adress < 0 ? -1 : memory(adress);
+        if(value >= 0){
+            append(text, " = %02X", value);
+        }
+    }
+
+    std::string disassemble(const TraceRecord& record) const{
+        const OpInfo& info = OP_TABLE[record.bytes[0]];
+        std::uint8_t low = record.bytes[1];
+        std::uint16_t word = record.bytes[1] | (record.bytes[2] << 8);
+        std::string text = info.mnemonic;
+        bool jump = record.bytes[0] == 0x4c || record.bytes[0] == 0x20;
+        switch(info.mode){
+            case AddressingMode::Implied:
+                break;
+            case AddressingMode::Accumulator:
+                text += " A";
+                break;
+            case AddressingMode::Immediate:
+                append(text, " #$%02X", low);
+                break;
+            case AddressingMode::ZeroPage:
+                append(text, " $%02X", low);
+                appendValue(text, low);
+                break;
+            case AddressingMode::ZeroPageX:
+            case AddressingMode::ZeroPageY:{
+                std::uint8_t index = info.mode == AddressingMode::ZeroPageX ? record.x : record.y;
+                std::uint8_t adress = low + index;
+                append(text, " $%02X", low);
+                text += info.mode == AddressingMode::ZeroPageX ? ",X" : ",Y";
+                append(text, " @ %02X", adress);
+                appendValue(text, adress);
+                break;
+            }
+            case AddressingMode::Absolute:
+                append(text, " $%04X", word);
+                if(!jump){
+                    appendValue(text, word);
+                }
+                break;
+            case AddressingMode::AbsoluteX:
+            case AddressingMode::AbsoluteY:{
+                std::uint8_t index = info.mode == AddressingMode::AbsoluteX ? record.x : record.y;
+                std::uint16_t adress = word + index;
+                append(text, " $%04X", word);
+                text += info.mode == AddressingMode::AbsoluteX ? ",X" : ",Y";
+                append(text, " @ %04X", adress);
+                appendValue(text, adress);
+                break;
+            }
+            case AddressingMode::Indirect:{
+                //the high byte comes from the same page, like the cpu does it
+                int target = pointer(word, (word & 0xff00) | ((word + 1) & 0x00ff));
+                append(text, " ($%04X)", word);
+                if(target >= 0){
+                    append(text, " = %04X", target);
+                }
+                break;
+            }
+            case AddressingMode::IndirectX:{
+                std::uint8_t zero_page = low + record.x;
+                int adress = pointer(zero_page, (std::uint8_t)(zero_page + 1));
+                append(text, " ($%02X,X)", low);
+                append(text, " @ %02X", zero_page);
+                if(adress >= 0){
+                    append(text, " = %04X", adress);
+                }
+                appendValue(text, adress);
+                break;
+            }
+            case AddressingMode::IndirectY:{
+                int base = pointer(low, (std::uint8_t)(low + 1));
+                append(text, " ($%02X),Y", low);
+                if(base >= 0){
+                    std::uint16_t adress = base + record.y;
+                    append(text, " = %04X", base);
+                    append(text, " @ %04X", adress);
+                    appendValue(text, adress);
+                }
+                break;
+            }
+            case AddressingMode::Relative:
+                append(text, " $%04X", (std::uint16_t)(record.adress + 2 + (std::int8_t)low));
+                break;
+        }
+        return text;
+    }
+
+public:
+    explicit NestestWriter(const std::vector<TraceRecord>& records) : records(records){
+        first = 0;
+        last = 0;
+    }
+
+    //the line for the instruction record at index, without the newline
+    std::string format(std::size_t index){
+        const TraceRecord& record = records[index];
+        first = index + 1;
+        last = first;
+        while(last < records.size() && records[last].kind != TRACE_INSTRUCTION){
+            last++;
+        }
+
+        int length = instructionLength(OP_TABLE[record.bytes[0]].mode);
+        char bytes[16];
+        std::snprintf(bytes, sizeof(bytes), length == 1 ? "%02X" : length == 2 ? "%02X %02X" : "%02X %02X %02X",
+                      record.bytes[0], record.bytes[1], record.bytes[2]);
+        std::uint64_t dots = record.cycle * 3;
+        char line[128];
+        std::snprintf(line, sizeof(line), "%04X  %-8s  %-32sA:%02X X:%02X Y:%02X P:%02X SP:%02X PPU:%3d,%3d CYC:%llu",
+                      record.adress, bytes, disassemble(record).c_str(), record.a, record.x, record.y, record.p,
+                      record.sp, (int)(dots / 341 % 262), (int)(dots % 341), (unsigned long long)record.cycle);
+        return line;
+    }
+
+    //writes every instruction record, returns how many
+    std::size_t write(std::ostream& out){
+        std::size_t lines = 0;
+        for(std::size_t i = 0; i < records.size(); i++){
+            if(records[i].kind == TRACE_INSTRUCTION){
+                out<<format(i)<<'\n';
+                lines++;
+            }
+        }
+        return lines;
+    }
+};
+
+#endif // DISASSEMBLER_HPP_INCLUDED
@@ -0,0 +1,265 @@
+#ifndef JIT_HPP_INCLUDED
+#define JIT_HPP_INCLUDED
+
+#include<cstdint>
+#include<cstddef>
+#include<cstring>
+#include<vector>
+
+#if defined(__x86_64__) && defined(__unix__)
+#include<sys/mman.h>
+#define JIT_AVAILABLE 1
+#endif
+
+#ifdef JIT_AVAILABLE
+
+#define JIT_BUFFER_SIZE (1024 * 1024)
+
+//executable memory plus just enough of an x86-64 assembler for the cpu's block compiler
+//every memory operand is [rbx + disp32], rbx holds the CPU the code runs on
+//the memory is never writable and executable at once: it is read only and executable, and only
+//writable between beginWrite and endWrite while a block is emitted
+class JitBuffer {
+private:
+    std::uint8_t* code;
+    std::size_t size;
+    std::size_t used;
+    std::vector<std::size_t> exits;     //rel32 fields still waiting for the exit label
+
+    void emit8(std::uint8_t value){
+        if(used < size){
+            code[used] = value;
+        }
+        used++;
+    }
+
+    void emit16(std::uint16_t value){
+        emit8(value & 0xff);
+        emit8(value >> 8);
+    }
+
+    void emit32(std::uint32_t value){
+        emit16(value & 0xffff);
+        emit16(value >> 16);
+    }
+
+    void emit64(std::uint64_t value){
+        emit32(value & 0xffffffff);
+        emit32(value >> 32);
+    }
+
+    //modrm for [rbx + disp32] with reg as the register or op code extension
+    void rbx32(int reg, std::int32_t disp){
+        emit8(0b10000011 | (reg << 3));
+        emit32(disp);
+    }
+
+public:
+    JitBuffer(){
+        size = JIT_BUFFER_SIZE;
+        used = 0;
+        void* memory = mmap(nullptr, size, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        code = memory == MAP_FAILED ? nullptr : static_cast<std::uint8_t*>(memory);
+    }
+
+    ~JitBuffer(){
+        if(code){
+            munmap(code, size);
+        }
+    }
+
+    JitBuffer(const JitBuffer&) = delete;
+    JitBuffer& operator=(const JitBuffer&) = delete;
+
+    //false when the system refused executable memory
+    bool usable() const{
+        return code != nullptr;
+    }
+
+    //makes the buffer writable and not executable, nothing in it may run until endWrite.
+    //false when the system refused
+    bool beginWrite(){
+        return code && mprotect(code, size, PROT_READ | PROT_WRITE) == 0;
+    }
+
+    //makes the buffer executable and read only again, false when the system refused
+    bool endWrite(){
+        return code && mprotect(code, size, PROT_READ | PROT_EXEC) == 0;
+    }
+
+    //drops everything compiled so far
+    void clear(){
+        used = 0;
+        exits.clear();
+    }
+
+    //start of the next function, also used to roll back one that did not fit
+    std::size_t position() const{
+        return used;
+    }
+
+    void rewind(std::size_t position){
+        used = position;
+        exits.clear();
+    }
+
+    //true when everything emitted since position fit into the buffer
+    bool fits() const{
+        return used <= size;
+    }
+
+    const std::uint8_t* at(std::size_t position) const{
+        return code + position;
+    }
+
+    //push rbx, r13, r14 and keep the cpu in rbx and the instruction budget in r13 and r14
+    //three pushes leave the stack 16 byte aligned for the calls
+    void prologue(){
+        emit8(0x53);
+        emit8(0x41); emit8(0x55);
+        emit8(0x41); emit8(0x56);
+        emit8(0x48); emit8(0x89); emit8(0xfb);     //mov rbx, rdi
+        emit8(0x49); emit8(0x89); emit8(0xf5);     //mov r13, rsi
+        emit8(0x49); emit8(0x89); emit8(0xf6);     //mov r14, rsi
+    }
+
+    //binds every pending exit jump here and returns the instructions run, r14 - r13
+    void epilogue(){
+        for(std::size_t field : exits){
+            std::uint32_t rel = used - (field + 4);
+            if(field + 4 <= size){
+                std::memcpy(code + field, &rel, 4);
+            }
+        }
+        exits.clear();
+        emit8(0x4c); emit8(0x89); emit8(0xf0);     //mov rax, r14
+        emit8(0x4c); emit8(0x29); emit8(0xe8);     //sub rax, r13
+        emit8(0x41); emit8(0x5e);
+        emit8(0x41); emit8(0x5d);
+        emit8(0x5b);
+        emit8(0xc3);
+    }
+
+    //conditional jump to the epilogue, condition is the low nibble of the 0x0f 0x8x op code
+    void exitIf(std::uint8_t condition){
+        emit8(0x0f);
+        emit8(0x80 | condition);
+        exits.push_back(used);
+        emit32(0);
+    }
+
+    static constexpr std::uint8_t EQUAL = 0x4;
+    static constexpr std::uint8_t NOT_EQUAL = 0x5;
+    static constexpr std::uint8_t ABOVE_EQUAL = 0x3;
+
+    //forward jump over a few bytes, returns the field to patch with skipTo
+    std::size_t skipIfEqual(){
+        emit8(0x74);
+        emit8(0);
+        return used - 1;
+    }
+
+    void skipTo(std::size_t field){
+        if(field < size){
+            code[field] = used - (field + 1);
+        }
+    }
+
+    void callCpu(const void* function){
+        emit8(0x48); emit8(0x89); emit8(0xdf);     //mov rdi, rbx
+        emit8(0x48); emit8(0xb8); emit64((std::uintptr_t)function);  //mov rax, function
+        emit8(0xff); emit8(0xd0);                   //call rax
+    }
+
+    void decBudget(){
+        emit8(0x49); emit8(0xff); emit8(0xcd);     //dec r13
+    }
+
+    void movWord(std::int32_t disp, std::uint16_t value){
+        emit8(0x66); emit8(0xc7); rbx32(0, disp); emit16(value);
+    }
+
+    void movByte(std::int32_t disp, std::uint8_t value){
+        emit8(0xc6); rbx32(0, disp); emit8(value);
+    }
+
+    void addQword(std::int32_t disp, std::int8_t value){
+        emit8(0x48); emit8(0x83); rbx32(0, disp); emit8(value);
+    }
+
+    void addWord(std::int32_t disp, std::int8_t value){
+        emit8(0x66); emit8(0x83); rbx32(0, disp); emit8(value);
+    }
+
+    //cmp qword [rbx + a], with rax loaded from [rbx + b] first, flags are a - b
+    void cmpQwords(std::int32_t a, std::int32_t b){
+        emit8(0x48); emit8(0x8b); rbx32(0, a);     //mov rax, [a]
+        emit8(0x48); emit8(0x3b); rbx32(0, b);     //cmp rax, [b]
+    }
+
+    void cmpWord(std::int32_t disp, std::uint16_t value){
+        emit8(0x66); emit8(0x81); rbx32(7, disp); emit16(value);
+    }
+
+    //cmp dword [pointer], value
+    void cmpDwordAt(const void* pointer, std::uint32_t value){
+        emit8(0x48); emit8(0xb8); emit64((std::uintptr_t)pointer);
+        emit8(0x81); emit8(0x38); emit32(value);
+    }
+
+    void cmpByteAt(const void* pointer, std::uint8_t value){
+        emit8(0x48); emit8(0xb8); emit64((std::uintptr_t)pointer);
+        emit8(0x80); emit8(0x38); emit8(value);
+    }
+
+    void testByte(std::int32_t disp, std::uint8_t mask){
+        emit8(0xf6); rbx32(0, disp); emit8(mask);
+    }
+
+    //al based helpers for the inlined register ops
+    void loadAl(std::int32_t disp){
+        emit8(0x0f); emit8(0xb6); rbx32(0, disp);  //movzx eax, byte [disp]
+    }
+
+    void storeAl(std::int32_t disp){
+        emit8(0x88); rbx32(0, disp);
+    }
+
+    void storeAx(std::int32_t disp){
+        emit8(0x66); emit8(0x89); rbx32(0, disp);
+    }
+
+    void movEax(std::uint8_t value){
+        emit8(0xb8); emit32(value);                 //mov eax, value
+    }
+
+    void incAl(){
+        emit8(0xfe); emit8(0xc0);
+    }
+
+    void decAl(){
+        emit8(0xfe); emit8(0xc8);
+    }
+
+    //cl = table[eax]
+    void lookupCl(const std::uint8_t* table){
+        emit8(0x48); emit8(0xb9); emit64((std::uintptr_t)table);    //mov rcx, table
+        emit8(0x0f); emit8(0xb6); emit8(0x0c); emit8(0x01);         //movzx ecx, byte [rcx + rax]
+    }
+
+    void andByte(std::int32_t disp, std::uint8_t mask){
+        emit8(0x80); rbx32(4, disp); emit8(mask);
+    }
+
+    void orByte(std::int32_t disp, std::uint8_t mask){
+        emit8(0x80); rbx32(1, disp); emit8(mask);
+    }
+
+    void orByteCl(std::int32_t disp){
+        emit8(0x08); rbx32(1, disp);
+    }
+};
+
+#endif
+
+#endif // JIT_HPP_INCLUDED
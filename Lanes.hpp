@@ -0,0 +1,817 @@
+#ifndef LANES_HPP_INCLUDED
+#define LANES_HPP_INCLUDED
+
+#include<algorithm>
+#include<chrono>
+#include<cstdint>
+#include<cstddef>
+#include<cstring>
+#include<memory>
+#include<vector>
+#include"CPU.hpp"
+
+#define LANE_WIDTH 16               //lanes side by side in one vector
+#define LANE_BLOCK_CACHE_SIZE 1024  //blocks shared by all lanes, direct mapped on the low bits of their start adress
+#define LANE_MIN_GROUP 2            //fewer lanes at the same code run through their own cpu
+
+//one register of LANE_WIDTH lanes, gcc and clang lower these to sse2 or neon. comparisons give
+//the signed types, all ones where true
+typedef std::uint8_t LaneBytes __attribute__((vector_size(LANE_WIDTH)));
+typedef std::int8_t LaneMask __attribute__((vector_size(LANE_WIDTH)));
+typedef std::uint16_t LaneWords __attribute__((vector_size(2 * LANE_WIDTH)));
+typedef std::int16_t LaneWordMask __attribute__((vector_size(2 * LANE_WIDTH)));
+
+//what LaneGroup ran
+struct LaneSummary {
+    std::uint64_t instructions;     //over all lanes
+    std::uint64_t grouped;          //of those, run from a block the lanes shared
+    std::uint64_t vector;           //of those, register only ops run on whole vectors of lanes at once
+    std::uint64_t direct;           //memory ops the group ran on the lanes' memory without their cpus
+    double seconds;
+    double mips;
+};
+
+//many consoles of the same program in lockstep, for running hundreds of copies of a game with
+//different inputs. A, X, Y, P, SP, PC and the cycle count of every lane live in one array per
+//register. each round the lanes at the same pc are grouped and run one block together: the block
+//is decoded once and shared, register only ops (transfers, immediates, flags, shifts of A and
+//branches) run on LANE_WIDTH lanes at a time with vector code, loads, stores and the stack go
+//lane by lane straight to each lane's memory and feed the same vector code, and whatever reaches
+//an i/o handler runs through the cpu's own handlers. pc and cycles only catch up when a lane has
+//to go through its cpu or could reach its next device event. a lane whose code does not match the shared
+//block (a different bank, code it rewrote) or that has nobody to share its pc with runs alone
+//through its own cpu. interrupts, device events and limits are still taken between instructions,
+//so every lane ends exactly where it would have running alone. lanes run without the recompiler,
+//a tracer or a profiler
+class LaneGroup {
+private:
+    struct LaneBlock {
+        std::uint16_t pc;
+        int count;                              //ops, 0 for an empty slot
+        std::uint32_t generation;               //new for every decode, so checks of an older one do not count
+        unsigned size;                          //bytes of code the ops came from
+        std::uint8_t code[3 * BLOCK_LENGTH];
+        CPU::LaneOp ops[BLOCK_LENGTH];
+    };
+
+    std::vector<std::unique_ptr<CPU>> lanes;
+    std::size_t padded;                         //lanes rounded up to LANE_WIDTH, the size of every array
+    //the cpus only hold the registers while running something for the group,
+    //runUntil takes them out at the start and puts them back at the end
+    std::vector<std::uint8_t> a;
+    std::vector<std::uint8_t> x;
+    std::vector<std::uint8_t> y;
+    std::vector<std::uint8_t> p;
+    std::vector<std::uint8_t> sp;
+    std::vector<std::uint16_t> pc;
+    std::vector<std::uint64_t> cycles;
+    std::vector<std::uint64_t> deadline;        //next device event or the cycle limit, whichever is first
+    std::vector<std::uint8_t> lines;            //1 for a waiting nmi, 2 for an irq line held low
+    std::vector<std::uint8_t> running;          //0xff until the lane reaches a limit or jams
+    std::vector<std::uint8_t> waiting;          //0xff for lanes that have not run this round
+    std::vector<std::uint8_t> group;            //0xff for lanes running the current block together
+    std::vector<std::uint32_t> members;         //the same lanes as a list, in order
+    std::vector<std::uint8_t> taken;            //0xff for members the branch that ends the block took
+    std::vector<Bus*> buses;
+    std::vector<std::uint16_t> adresses;        //of the memory op the group is on, per member
+    std::vector<std::uint8_t> fetched;          //what each member read there
+    std::vector<std::uint8_t> crossing;         //1 where an indexed adress crossed a page
+    //vector ops leave pc and cycles of the group alone and add up here, until a lane has to
+    //go through its cpu or the first member could reach its deadline
+    std::uint64_t pending_cycles;
+    std::uint16_t pending_pc;
+    bool pending;
+    std::uint64_t slack;                        //cycles until the first member's deadline
+    std::vector<std::uint64_t> cycle_limits;
+    std::vector<std::uint64_t> frame_limits;
+    std::unique_ptr<LaneBlock[]> blocks;
+    std::vector<std::uint64_t> checked;         //per slot and lane, generation and page version the code last matched at
+    std::uint32_t generations;
+    LaneSummary summary;
+
+    template<typename V, typename T>
+    static void load(V& out, const std::vector<T>& array, std::size_t first){
+        std::memcpy(&out, array.data() + first, sizeof(V));
+    }
+
+    template<typename V, typename T>
+    static void store(std::vector<T>& array, std::size_t first, const V& value){
+        std::memcpy(array.data() + first, &value, sizeof(V));
+    }
+
+    static bool any(const LaneBytes& mask){
+        std::uint64_t halves[LANE_WIDTH / 8];
+        std::memcpy(halves, &mask, sizeof(halves));
+        std::uint64_t bits = 0;
+        for(std::uint64_t half : halves){
+            bits |= half;
+        }
+        return bits;
+    }
+
+    static LaneBytes splat(std::uint8_t value){
+        LaneBytes zero = {};
+        return zero + value;
+    }
+
+    static LaneBytes blend(LaneBytes mask, LaneBytes chosen, LaneBytes other){
+        return (chosen & mask) | (other & ~mask);
+    }
+
+    //N and Z of every lane's value, the vector NZ_TABLE
+    static LaneBytes nz(LaneBytes value){
+        return (value & 0b10000000) | ((LaneBytes)(value == 0) & 0b00000010);
+    }
+
+    static LaneBytes setNZ(LaneBytes status, LaneBytes value){
+        return (status & 0b01111101) | nz(value);
+    }
+
+    static void add(LaneBytes& accumulator, LaneBytes& status, LaneBytes value){
+        LaneBytes sum = accumulator + value;
+        LaneBytes carry = (LaneBytes)(sum < accumulator) & 1;
+        LaneBytes result = sum + (status & 1);
+        carry |= (LaneBytes)(result < sum) & 1;
+        //overflow when both inputs have the same sign and the result has the other one
+        LaneBytes overflow = (~(accumulator ^ value) & (accumulator ^ result) & 0b10000000) >> 1;
+        status = (status & 0b00111100) | nz(result) | overflow | carry;
+        accumulator = result;
+    }
+
+    static LaneBytes compare(LaneBytes status, LaneBytes reg, LaneBytes value){
+        return (status & 0b01111100) | nz(reg - value) | ((LaneBytes)(reg >= value) & 1);
+    }
+
+    //ops that only move registers and flags, they run on vectors of lanes
+    static bool isVectorOp(std::uint8_t op_code){
+        switch(op_code){
+            case 0xaa: case 0xa8: case 0x8a: case 0x98: case 0xba: case 0x9a:  //transfers
+            case 0xe8: case 0xc8: case 0xca: case 0x88:                        //INX, INY, DEX, DEY
+            case 0x18: case 0x38: case 0x58: case 0x78: case 0xb8: case 0xd8: case 0xf8: case 0xea:
+            case 0xa9: case 0xa2: case 0xa0: case 0x29: case 0x09: case 0x49:  //immediates
+            case 0x69: case 0xe9: case 0xc9: case 0xe0: case 0xc0:
+            case 0x0a: case 0x4a: case 0x2a: case 0x6a:                        //shifts of A
+            case 0x10: case 0x30: case 0x50: case 0x70: case 0x90: case 0xb0: case 0xd0: case 0xf0:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    //memory ops the group runs itself while every lane's adress is plain memory, by adressing mode
+    enum LaneMode {
+        LANE_NONE, LANE_ZERO_PAGE, LANE_ZERO_PAGE_X, LANE_ZERO_PAGE_Y, LANE_ABSOLUTE, LANE_ABSOLUTE_X, LANE_ABSOLUTE_Y,
+        LANE_INDIRECT_X, LANE_INDIRECT_Y,
+        LANE_STACK      //pushes, pulls, JSR and RTS
+    };
+
+    static LaneMode memoryMode(std::uint8_t op_code){
+        switch(op_code){
+            case 0xa5: case 0xa6: case 0xa4: case 0x25: case 0x05: case 0x45: case 0x65: case 0xe5:
+            case 0xc5: case 0xe4: case 0xc4: case 0x24: case 0x85: case 0x86: case 0x84: case 0xe6: case 0xc6:
+                return LANE_ZERO_PAGE;
+            case 0xb5: case 0xb4: case 0x35: case 0x15: case 0x55: case 0x75: case 0xf5: case 0xd5:
+            case 0x95: case 0x94: case 0xf6: case 0xd6:
+                return LANE_ZERO_PAGE_X;
+            case 0xb6: case 0x96:
+                return LANE_ZERO_PAGE_Y;
+            case 0xad: case 0xae: case 0xac: case 0x2d: case 0x0d: case 0x4d: case 0x6d: case 0xed:
+            case 0xcd: case 0xec: case 0xcc: case 0x2c: case 0x8d: case 0x8e: case 0x8c: case 0xee: case 0xce:
+                return LANE_ABSOLUTE;
+            case 0xbd: case 0xbc: case 0x3d: case 0x1d: case 0x5d: case 0x7d: case 0xfd: case 0xdd:
+            case 0x9d: case 0xfe: case 0xde:
+                return LANE_ABSOLUTE_X;
+            case 0xb9: case 0xbe: case 0x39: case 0x19: case 0x59: case 0x79: case 0xf9: case 0xd9:
+            case 0x99:
+                return LANE_ABSOLUTE_Y;
+            case 0xa1: case 0x21: case 0x01: case 0x41: case 0x61: case 0xe1: case 0xc1: case 0x81:
+                return LANE_INDIRECT_X;
+            case 0xb1: case 0x31: case 0x11: case 0x51: case 0x71: case 0xf1: case 0xd1: case 0x91:
+                return LANE_INDIRECT_Y;
+            case 0x48: case 0x08: case 0x68: case 0x28: case 0x20: case 0x60:
+                return LANE_STACK;
+            default:
+                return LANE_NONE;
+        }
+    }
+
+    //stores and increments, the rest read a value and then do what their immediate form does
+    static bool isWrite(std::uint8_t op_code){
+        std::uint8_t group = op_code & 0b11100011;
+        return group == 0b10000001 || group == 0b10000010 || group == 0b10000000 || group == 0b11100010 || group == 0b11000010;
+    }
+
+    //the immediate form of a memory read, BIT has none and keeps its own
+    static std::uint8_t immediateOf(std::uint8_t op_code){
+        switch(op_code & 0b11100011){
+            case 0b10100010: return 0xa2;  //LDX
+            case 0b10100000: return 0xa0;  //LDY
+            case 0b11100000: return 0xe0;  //CPX
+            case 0b11000000: return 0xc0;  //CPY
+            case 0b00100000: return 0x24;  //BIT
+            default: return (op_code & 0b11100000) | 0b00001001;
+        }
+    }
+
+    //hands lane i's registers to its cpu
+    CPU& enter(std::size_t i){
+        CPU& cpu = *lanes[i];
+        cpu.setLane({a[i], x[i], y[i], p[i], sp[i], pc[i]}, cycles[i]);
+        return cpu;
+    }
+
+    //takes them back, with whatever else the cpu changed behind the group's back
+    void leave(std::size_t i){
+        CPU& cpu = *lanes[i];
+        Registers registers = cpu.getRegisters();
+        a[i] = registers.a;
+        x[i] = registers.x;
+        y[i] = registers.y;
+        p[i] = registers.p;
+        sp[i] = registers.sp;
+        pc[i] = registers.pc;
+        cycles[i] = cpu.getCycles();
+        deadline[i] = std::min(cpu.getDeadline(), cycle_limits[i]);
+        Bus& bus = cpu.getBus();
+        lines[i] = (*bus.getNmiLine() ? 1 : 0) | (*bus.getIrqLines() ? 2 : 0);
+    }
+
+    //after an instruction, the same checks runUntil makes before the next one
+    void checkLimits(std::size_t i){
+        CPU& cpu = *lanes[i];
+        if(cpu.isJammed() || cycles[i] >= cycle_limits[i] || cpu.getPPU().getFrame() >= frame_limits[i]){
+            running[i] = 0;
+        }
+    }
+
+    void runAlone(std::size_t i){
+        CPU& cpu = enter(i);
+        summary.instructions += cpu.runLaneBlock(cycle_limits[i], frame_limits[i]);
+        leave(i);
+        checkLimits(i);
+    }
+
+    //lanes that have to take an interrupt before their next instruction
+    LaneBytes interruptMask(std::size_t first) const{
+        LaneBytes status, held;
+        load(status, p, first);
+        load(held, lines, first);
+        //an irq waits while I is set, an nmi does not
+        LaneBytes taken = (held & 1) | (held & ~(status >> 1) & 2);
+        return (LaneBytes)(taken != 0);
+    }
+
+    void takeInterrupts(){
+        for(std::size_t first = 0; first < padded; first += LANE_WIDTH){
+            LaneBytes active;
+            load(active, running, first);
+            LaneBytes taken = interruptMask(first) & active;
+            if(!any(taken)){
+                continue;
+            }
+            for(std::size_t i = first; i < first + LANE_WIDTH; i++){
+                if(taken[i - first]){
+                    enter(i).takeInterrupts();
+                    leave(i);
+                }
+            }
+        }
+    }
+
+    //puts what vector ops deferred into the members' pc and cycles
+    void flush(){
+        if(!pending){
+            return;
+        }
+        for(std::uint32_t i : members){
+            cycles[i] += pending_cycles;
+            pc[i] = pending_pc;
+        }
+        slack = slack > pending_cycles ? slack - pending_cycles : 0;
+        pending_cycles = 0;
+        pending = false;
+    }
+
+    //runs the devices of members the last op took to their deadline, true when there were any
+    bool runDue(){
+        bool due = false;
+        slack = UINT64_MAX;
+        for(std::uint32_t i : members){
+            if(cycles[i] >= deadline[i]){
+                enter(i).runLaneEvents();
+                leave(i);
+                checkLimits(i);
+                due = true;
+            }
+            if(cycles[i] < deadline[i]){
+                slack = std::min(slack, deadline[i] - cycles[i]);
+            }
+        }
+        return due;
+    }
+
+    //drops lanes that stopped, have an interrupt coming or no longer have the block's code (they
+    //rewrote it or switched banks) from the group, false when none are left
+    bool trimGroup(std::size_t slot){
+        flush();
+        members.clear();
+        slack = UINT64_MAX;
+        for(std::size_t first = 0; first < padded; first += LANE_WIDTH){
+            LaneBytes together, active;
+            load(together, group, first);
+            if(!any(together)){
+                continue;
+            }
+            load(active, running, first);
+            together = together & active & ~interruptMask(first);
+            for(std::size_t i = 0; i < LANE_WIDTH; i++){
+                if(together[i] && !matches(first + i, slot)){
+                    together[i] = 0;
+                }else if(together[i]){
+                    members.push_back(first + i);
+                    //members are short of their deadline, a lane past it ran its devices or stopped
+                    slack = std::min(slack, deadline[first + i] - cycles[first + i]);
+                }
+            }
+            store(group, first, together);
+        }
+        return !members.empty();
+    }
+
+    //true when the lane's code at the block's pc is the code the block was decoded from. the
+    //lane's own page version says whether that can have changed since it was last compared
+    bool matches(std::size_t i, std::size_t slot){
+        const LaneBlock& block = blocks[slot];
+        Bus& bus = *buses[i];
+        std::uint8_t page = block.pc >> 8;
+        const std::uint8_t* memory = bus.getPageMemory(page);
+        if(!memory){
+            return false;
+        }
+        std::uint64_t key = (std::uint64_t)block.generation << 32 | *bus.getPageVersion(page);
+        std::uint64_t& seen = checked[slot * lanes.size() + i];
+        if(seen == key){
+            return true;
+        }
+        if(std::memcmp(memory + (block.pc & 0xff), block.code, block.size) != 0){
+            return false;
+        }
+        seen = key;
+        return true;
+    }
+
+    //the block at the leader's pc, decoded from the leader's code when the slot holds something
+    //else. null when that code is not plain memory
+    const LaneBlock* findBlock(std::size_t leader, std::size_t& slot){
+        std::uint16_t start = pc[leader];
+        slot = start & (LANE_BLOCK_CACHE_SIZE - 1);
+        LaneBlock& block = blocks[slot];
+        if(block.count > 0 && block.pc == start && matches(leader, slot)){
+            return &block;
+        }
+        const std::uint8_t* memory = buses[leader]->getPageMemory(start >> 8);
+        block.count = memory ? CPU::decodeLane(memory, start, block.ops) : 0;
+        if(block.count == 0){
+            return nullptr;
+        }
+        const CPU::LaneOp& last = block.ops[block.count - 1];
+        block.pc = start;
+        block.generation = ++generations;
+        block.size = last.pc + last.length - start;
+        std::memcpy(block.code, memory + (start & 0xff), block.size);
+        //records the leader's page version, its code is what was just decoded
+        matches(leader, slot);
+        return &block;
+    }
+
+    //one register only op on every lane of the group, then the devices of the lanes it took past
+    //their deadline. true when any lane went through its cpu for that. memory reads come here as
+    //their immediate form kind, with the value every lane read in fetched
+    bool runVector(const CPU::LaneOp& op, std::uint8_t kind, bool read){
+        std::uint16_t next = op.pc + op.length;
+        std::uint16_t target = next + (std::int8_t)op.operand;
+        std::uint64_t penalty = 1 + ((next ^ target) >> 8 != 0);
+        static const std::uint8_t branch_flags[4] = {0b10000000, 0b01000000, 0b00000001, 0b00000010};
+
+        for(std::size_t first = members.front() / LANE_WIDTH * LANE_WIDTH; first <= members.back(); first += LANE_WIDTH){
+            LaneBytes mask;
+            load(mask, group, first);
+            if(!any(mask)){
+                continue;
+            }
+            LaneBytes va, vx, vy, vp, vs, value;
+            if(read){
+                load(value, fetched, first);
+            }else{
+                value = splat(op.operand);
+            }
+            load(va, a, first);
+            load(vx, x, first);
+            load(vy, y, first);
+            load(vp, p, first);
+            load(vs, sp, first);
+            LaneBytes na = va, nx = vx, ny = vy, np = vp, ns = vs;
+            LaneBytes jumped = {};
+            switch(kind){
+                case 0xaa: nx = va; np = setNZ(vp, nx); break;     //TAX
+                case 0xa8: ny = va; np = setNZ(vp, ny); break;     //TAY
+                case 0x8a: na = vx; np = setNZ(vp, na); break;     //TXA
+                case 0x98: na = vy; np = setNZ(vp, na); break;     //TYA
+                case 0xba: nx = vs; np = setNZ(vp, nx); break;     //TSX
+                case 0x9a: ns = vx; break;                         //TXS
+                case 0xe8: nx = vx + 1; np = setNZ(vp, nx); break; //INX
+                case 0xc8: ny = vy + 1; np = setNZ(vp, ny); break; //INY
+                case 0xca: nx = vx - 1; np = setNZ(vp, nx); break; //DEX
+                case 0x88: ny = vy - 1; np = setNZ(vp, ny); break; //DEY
+                case 0x18: np = vp & 0b11111110; break;            //CLC
+                case 0x38: np = vp | 0b00000001; break;            //SEC
+                case 0x58: np = vp & 0b11111011; break;            //CLI
+                case 0x78: np = vp | 0b00000100; break;            //SEI
+                case 0xb8: np = vp & 0b10111111; break;            //CLV
+                case 0xd8: np = vp & 0b11110111; break;            //CLD
+                case 0xf8: np = vp | 0b00001000; break;            //SED
+                case 0xa9: na = value;    np = setNZ(vp, na); break;        //LDA #
+                case 0xa2: nx = value;    np = setNZ(vp, nx); break;        //LDX #
+                case 0xa0: ny = value;    np = setNZ(vp, ny); break;        //LDY #
+                case 0x29: na = va & value; np = setNZ(vp, na); break;         //AND #
+                case 0x09: na = va | value; np = setNZ(vp, na); break;         //ORA #
+                case 0x49: na = va ^ value; np = setNZ(vp, na); break;         //EOR #
+                case 0x69: add(na, np, value); break;                          //ADC #
+                case 0xe9: add(na, np, ~value); break;                         //SBC #
+                case 0xc9: np = compare(vp, va, value); break;                 //CMP #
+                case 0xe0: np = compare(vp, vx, value); break;                 //CPX #
+                case 0xc0: np = compare(vp, vy, value); break;                 //CPY #
+                case 0x0a:                                                     //ASL A
+                    na = va << 1;
+                    np = (vp & 0b01111100) | nz(na) | (va >> 7);
+                    break;
+                case 0x4a:                                                     //LSR A
+                    na = va >> 1;
+                    np = (vp & 0b01111100) | nz(na) | (va & 1);
+                    break;
+                case 0x2a:                                                     //ROL A
+                    na = (va << 1) | (vp & 1);
+                    np = (vp & 0b01111100) | nz(na) | (va >> 7);
+                    break;
+                case 0x6a:                                                     //ROR A
+                    na = (va >> 1) | (vp << 7);
+                    np = (vp & 0b01111100) | nz(na) | (va & 1);
+                    break;
+                case 0x24:                                                     //BIT
+                    np = (vp & 0b00111101) | (value & 0b11000000) | ((LaneBytes)((va & value) == 0) & 0b00000010);
+                    break;
+                case 0xea:                                                     //NOP
+                    break;
+                default:{
+                    //branches, bits 6-7 pick the flag and bit 5 whether it has to be set
+                    LaneBytes set = (LaneBytes)((vp & branch_flags[kind >> 6]) != 0);
+                    jumped = (kind & 0b00100000 ? set : ~set) & mask;
+                    break;
+                }
+            }
+            store(a, first, blend(mask, na, va));
+            store(x, first, blend(mask, nx, vx));
+            store(y, first, blend(mask, ny, vy));
+            store(p, first, blend(mask, np, vp));
+            store(sp, first, blend(mask, ns, vs));
+            store(taken, first, jumped);
+        }
+
+        if((kind & 0b00011111) != 0b00010000){
+            return advance(op, next);
+        }
+        //a branch ends the block, every member gets its own pc and cycles back
+        for(std::uint32_t i : members){
+            cycles[i] += pending_cycles + op.cycles + (taken[i] ? penalty : 0);
+            pc[i] = taken[i] ? target : next;
+        }
+        pending_cycles = 0;
+        pending = false;
+        return runDue();
+    }
+
+    //moves the group past an op that does not branch to next, true when that took a lane to its deadline
+    bool advance(const CPU::LaneOp& op, std::uint16_t next){
+        pending_cycles += op.cycles;
+        pending_pc = next;
+        pending = true;
+        if(pending_cycles < slack){
+            return false;
+        }
+        flush();
+        return runDue();
+    }
+
+    //every member's adress for a memory op, false when any of them is not plain memory. the
+    //pointers of the indirect modes are read here, reading plain memory changes nothing
+    bool findAdresses(const CPU::LaneOp& op, LaneMode mode){
+        bool write = mode == LANE_STACK ? op.op_code == 0x48 || op.op_code == 0x08 || op.op_code == 0x20 : isWrite(op.op_code);
+        for(std::uint32_t i : members){
+            Bus& bus = *buses[i];
+            std::uint16_t base = op.operand;
+            std::uint16_t adress;
+            switch(mode){
+                case LANE_ZERO_PAGE_X: adress = (std::uint8_t)(base + x[i]); break;
+                case LANE_ZERO_PAGE_Y: adress = (std::uint8_t)(base + y[i]); break;
+                case LANE_ABSOLUTE_X: adress = base + x[i]; break;
+                case LANE_ABSOLUTE_Y: adress = base + y[i]; break;
+                case LANE_INDIRECT_X:
+                case LANE_INDIRECT_Y:{
+                    if(!bus.getPageMemory(0)){
+                        return false;
+                    }
+                    //the pointer wraps around the zero page
+                    std::uint8_t pointer = mode == LANE_INDIRECT_X ? base + x[i] : base;
+                    base = bus.read(pointer) | (bus.read((std::uint8_t)(pointer + 1)) << 8);
+                    adress = mode == LANE_INDIRECT_X ? base : base + y[i];
+                    break;
+                }
+                case LANE_STACK: adress = 0x100 | sp[i]; break;
+                default: adress = base; break;
+            }
+            if(!bus.getPageMemory(adress >> 8) || (write && !bus.isPageWritable(adress >> 8))){
+                return false;
+            }
+            adresses[i] = adress;
+            crossing[i] = (base ^ adress) >> 8 != 0;
+        }
+        return true;
+    }
+
+    //true when lane i's write to adress can have changed the code of the block in slot, mirrors
+    //of the block's page share its version
+    bool rewrites(std::size_t i, std::uint16_t adress, std::size_t slot) const{
+        const Bus& bus = *buses[i];
+        return bus.getPageVersion(adress >> 8) == bus.getPageVersion(blocks[slot].pc >> 8);
+    }
+
+    //a memory op on the adresses findAdresses found, straight on each lane's bus. true when a lane
+    //went through its cpu or wrote to the page the block is on
+    bool runMemory(const CPU::LaneOp& op, LaneMode mode, std::size_t slot){
+        if(mode == LANE_STACK){
+            return runStack(op, slot);
+        }
+        if(!isWrite(op.op_code)){
+            bool crossed = false;
+            for(std::uint32_t i : members){
+                fetched[i] = buses[i]->read(adresses[i]);
+                //indexed reads pay for crossing a page, like the cpu's absolute_x, absolute_y and indirect_y
+                if(crossing[i] && (mode == LANE_ABSOLUTE_X || mode == LANE_ABSOLUTE_Y || mode == LANE_INDIRECT_Y)){
+                    cycles[i]++;
+                    crossed = true;
+                }
+            }
+            if(crossed){
+                //the slack is only a bound, the next runDue finds the real one
+                slack = slack > 0 ? slack - 1 : 0;
+            }
+            return runVector(op, immediateOf(op.op_code), true);
+        }
+
+        bool rewrote = false;
+        for(std::uint32_t i : members){
+            Bus& bus = *buses[i];
+            std::uint16_t adress = adresses[i];
+            std::uint8_t value;
+            switch(op.op_code & 0b11100011){
+                case 0b10000001: value = a[i]; break;                   //STA
+                case 0b10000010: value = x[i]; break;                   //STX
+                case 0b10000000: value = y[i]; break;                   //STY
+                default:                                                //INC, DEC
+                    value = bus.read(adress) + (op.op_code & 0b00100000 ? 1 : -1);
+                    p[i] = (p[i] & 0b01111101) | (value & 0b10000000) | (value ? 0 : 0b00000010);
+                    break;
+            }
+            bus.write(adress, value);
+            rewrote = rewrote || rewrites(i, adress, slot);
+        }
+        return advance(op, op.pc + op.length) || rewrote;
+    }
+
+    //pushes and pulls on each lane's stack page, like the cpu's PHA, PHP, PLA, PLP, JSR and RTS
+    bool runStack(const CPU::LaneOp& op, std::size_t slot){
+        bool rewrote = false;
+        if(op.op_code == 0x60){
+            //every lane returns to its own adress, so RTS ends the block like a branch
+            flush();
+            for(std::uint32_t i : members){
+                Bus& bus = *buses[i];
+                std::uint16_t adress = bus.read(0x100 | (std::uint8_t)(sp[i] + 1));
+                adress |= bus.read(0x100 | (std::uint8_t)(sp[i] + 2)) << 8;
+                sp[i] += 2;
+                pc[i] = adress + 1;
+                cycles[i] += op.cycles;
+            }
+            return runDue();
+        }
+        for(std::uint32_t i : members){
+            Bus& bus = *buses[i];
+            switch(op.op_code){
+                case 0x48:                                              //PHA
+                    bus.write(adresses[i], a[i]);
+                    rewrote = rewrote || rewrites(i, adresses[i], slot);
+                    sp[i]--;
+                    break;
+                case 0x08:                                              //PHP
+                    bus.write(adresses[i], p[i] | 0b00110000);
+                    rewrote = rewrote || rewrites(i, adresses[i], slot);
+                    sp[i]--;
+                    break;
+                case 0x68:                                              //PLA
+                    a[i] = bus.read(0x100 | ++sp[i]);
+                    p[i] = (p[i] & 0b01111101) | (a[i] & 0b10000000) | (a[i] ? 0 : 0b00000010);
+                    break;
+                case 0x28:                                              //PLP
+                    p[i] = (bus.read(0x100 | ++sp[i]) & 0b11001111) | 0b00100000;
+                    break;
+                default:{                                               //JSR
+                    //the adress of JSR's last byte, high byte first
+                    std::uint16_t back = op.pc + 2;
+                    bus.write(0x100 | sp[i]--, back >> 8);
+                    bus.write(0x100 | sp[i]--, back & 0xff);
+                    rewrote = rewrote || rewrites(i, 0x100, slot);
+                    break;
+                }
+            }
+        }
+        return advance(op, op.op_code == 0x20 ? op.operand : op.pc + op.length) || rewrote;
+    }
+
+    //the lanes still waiting at the leader's pc run one block together
+    void runGroup(std::size_t leader){
+        std::uint16_t start = pc[leader];
+        members.clear();
+        for(std::size_t first = leader / LANE_WIDTH * LANE_WIDTH; first < padded; first += LANE_WIDTH){
+            LaneBytes left;
+            LaneWords at;
+            load(left, waiting, first);
+            load(at, pc, first);
+            LaneBytes together = left & (LaneBytes)__builtin_convertvector(at == start, LaneMask);
+            store(group, first, together);
+            store(waiting, first, left & ~together);
+            for(std::size_t i = 0; i < LANE_WIDTH; i++){
+                if(together[i]){
+                    members.push_back(first + i);
+                }
+            }
+        }
+
+        std::size_t slot = 0;
+        const LaneBlock* block = members.size() >= LANE_MIN_GROUP ? findBlock(leader, slot) : nullptr;
+        if(block){
+            //the members took their interrupts when the round started and nothing ran them since,
+            //only their code can split them off here
+            std::size_t kept = 0;
+            slack = UINT64_MAX;
+            for(std::uint32_t i : members){
+                if(matches(i, slot)){
+                    members[kept++] = i;
+                    slack = std::min(slack, deadline[i] - cycles[i]);
+                }else{
+                    group[i] = 0;
+                    runAlone(i);
+                }
+            }
+            members.resize(kept);
+        }
+        if(!block || members.size() < LANE_MIN_GROUP){
+            for(std::uint32_t i : members){
+                group[i] = 0;
+                runAlone(i);
+            }
+            return;
+        }
+
+        //only lanes that went through their cpu can have anything that splits them off
+        bool touched = false;
+        for(int k = 0; k < block->count; k++){
+            const CPU::LaneOp& op = block->ops[k];
+            if(touched && !trimGroup(slot)){
+                return;
+            }
+            summary.instructions += members.size();
+            summary.grouped += members.size();
+            LaneMode mode = memoryMode(op.op_code);
+            if(isVectorOp(op.op_code)){
+                summary.vector += members.size();
+                touched = runVector(op, op.op_code, false);
+            }else if(op.op_code == 0x4c){
+                //JMP takes every lane to the same adress
+                summary.vector += members.size();
+                touched = advance(op, op.operand);
+            }else if(mode != LANE_NONE && findAdresses(op, mode)){
+                summary.direct += members.size();
+                touched = runMemory(op, mode, slot);
+            }else{
+                flush();
+                for(std::uint32_t i : members){
+                    enter(i).runLaneOp(op);
+                    leave(i);
+                    checkLimits(i);
+                }
+                touched = true;
+            }
+        }
+        flush();
+        for(std::uint32_t i : members){
+            group[i] = 0;
+        }
+    }
+
+    LaneSummary runUntil(std::uint64_t max_cycles, std::uint64_t frames){
+        summary = {};
+        auto start = std::chrono::steady_clock::now();
+        bool left = false;
+        for(std::size_t i = 0; i < lanes.size(); i++){
+            CPU& cpu = *lanes[i];
+            std::uint64_t now = cpu.getCycles();
+            cycle_limits[i] = max_cycles > UINT64_MAX - now ? UINT64_MAX : now + max_cycles;
+            frame_limits[i] = frames > UINT64_MAX - cpu.getPPU().getFrame() ? UINT64_MAX : cpu.getPPU().getFrame() + frames;
+            leave(i);
+            running[i] = 0xff;
+            checkLimits(i);
+            left = left || running[i];
+        }
+
+        while(left){
+            takeInterrupts();
+            waiting = running;
+            for(std::size_t leader = 0; leader < lanes.size(); leader++){
+                if(waiting[leader]){
+                    runGroup(leader);
+                }
+            }
+            left = std::find(running.begin(), running.end(), 0xff) != running.end();
+        }
+
+        for(std::size_t i = 0; i < lanes.size(); i++){
+            enter(i);
+        }
+        summary.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        summary.mips = summary.seconds > 0 ? summary.instructions / summary.seconds / 1e6 : 0;
+        return summary;
+    }
+
+public:
+    //count powered off consoles, give them a program through getLane or load
+    explicit LaneGroup(std::size_t count){
+        padded = (count + LANE_WIDTH - 1) / LANE_WIDTH * LANE_WIDTH;
+        for(std::size_t i = 0; i < count; i++){
+            lanes.push_back(std::make_unique<CPU>());
+        }
+        for(std::vector<std::uint8_t>* array : {&a, &x, &y, &p, &sp, &lines, &running, &waiting, &group, &taken, &fetched, &crossing}){
+            array->assign(padded, 0);
+        }
+        pc.assign(padded, 0);
+        adresses.assign(padded, 0);
+        for(std::unique_ptr<CPU>& lane : lanes){
+            buses.push_back(&lane->getBus());
+        }
+        for(std::vector<std::uint64_t>* array : {&cycles, &deadline, &cycle_limits, &frame_limits}){
+            array->assign(padded, 0);
+        }
+        blocks = std::make_unique<LaneBlock[]>(LANE_BLOCK_CACHE_SIZE);
+        for(int i = 0; i < LANE_BLOCK_CACHE_SIZE; i++){
+            blocks[i].count = 0;
+        }
+        checked.assign(LANE_BLOCK_CACHE_SIZE * count, 0);
+        generations = 0;
+        pending_cycles = 0;
+        pending_pc = 0;
+        pending = false;
+        slack = 0;
+        summary = {};
+    }
+
+    //loads the same image into every lane, it is shared and not copied
+    RomError load(const std::shared_ptr<const Rom>& rom){
+        for(std::unique_ptr<CPU>& lane : lanes){
+            RomError error = lane->load(rom);
+            if(error != RomError::None){
+                return error;
+            }
+        }
+        return RomError::None;
+    }
+
+    std::size_t size() const{
+        return lanes.size();
+    }
+
+    //the console behind a lane, up to date whenever the group is not running
+    CPU& getLane(std::size_t lane){
+        return *lanes[lane];
+    }
+
+    //runs every lane like CPU::runHeadless would
+    LaneSummary runHeadless(std::uint64_t max_cycles){
+        return runUntil(max_cycles, UINT64_MAX);
+    }
+
+    //runs every lane like CPU::runFrames would
+    LaneSummary runFrames(std::uint64_t frames){
+        return runUntil(UINT64_MAX, frames);
+    }
+};
+
+#endif // LANES_HPP_INCLUDED
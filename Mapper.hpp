@@ -0,0 +1,549 @@
+#ifndef MAPPER_HPP_INCLUDED
+#define MAPPER_HPP_INCLUDED
+
+#include<cstdint>
+#include<cstddef>
+#include<memory>
+#include<span>
+#include<vector>
+#include"Bus.hpp"
+#include"Rom.hpp"
+#include"SaveState.hpp"
+
+#define CHR_PAGE_SIZE 1024
+#define CHR_PAGE_COUNT 8
+
+//cartridge board logic
+//PRG banks are switched by pointing bus pages at a different part of the rom,
+//CHR banks by pointing the eight 1KB pattern table pages the ppu reads from, nothing is ever copied
+class Mapper {
+protected:
+    const Rom& rom;
+    Bus& bus;
+    std::vector<std::uint8_t> prg_ram;
+    std::vector<std::uint8_t> chr_ram;      //used when the board has no CHR_ROM
+    std::uint8_t* chr_pages[CHR_PAGE_COUNT];
+    Mirroring mirroring;
+    std::uint32_t chr_version;              //bumped every time a CHR page is repointed
+
+    static void writeRegisterHandler(void* context, std::uint16_t adress, std::uint8_t value){
+        static_cast<Mapper*>(context)->writeRegister(adress, value);
+    }
+
+    //maps a PRG bank of bank_size bytes to the cpu adress, negative banks count from the end
+    void mapPrg(std::uint16_t adress, std::size_t bank_size, int bank){
+        int count = rom.getPrgRom().size() / bank_size;
+        if(count == 0){
+            count = 1;
+        }
+        bank %= count;
+        if(bank < 0){
+            bank += count;
+        }
+        std::span<const std::uint8_t> memory = rom.prgBank(bank, bank_size);
+        std::uint8_t first = adress >> 8;
+        std::uint8_t last = (adress + bank_size - 1) >> 8;
+        bus.mapMemory(first, last, memory.data(), memory.size(), writeRegisterHandler, this);
+    }
+
+    //maps a CHR bank of bank_size bytes to the ppu adress, negative banks count from the end
+    void mapChr(std::uint16_t adress, std::size_t bank_size, int bank){
+        std::uint8_t* memory;
+        std::size_t size;
+        if(chr_ram.empty()){
+            memory = const_cast<std::uint8_t*>(rom.getChrRom().data());
+            size = rom.getChrRom().size();
+        }else{
+            memory = chr_ram.data();
+            size = chr_ram.size();
+        }
+        int count = size / bank_size;
+        if(count == 0){
+            count = 1;
+        }
+        bank %= count;
+        if(bank < 0){
+            bank += count;
+        }
+        std::size_t offset = (std::size_t)bank * bank_size;
+        bool changed = false;
+        for(std::size_t i = 0; i < bank_size / CHR_PAGE_SIZE; i++){
+            std::uint8_t*& page = chr_pages[(adress / CHR_PAGE_SIZE + i) % CHR_PAGE_COUNT];
+            std::uint8_t* target = memory + (offset + i * CHR_PAGE_SIZE) % size;
+            changed = changed || page != target;
+            page = target;
+        }
+        if(changed){
+            chr_version++;
+        }
+    }
+
+    //enables or disables cartridge ram at 0x6000-0x7fff
+    void mapPrgRam(bool enabled, bool writable){
+        if(prg_ram.empty() || !enabled){
+            bus.unmap(0x60, 0x7f);
+        }else if(writable){
+            bus.mapMemory(0x60, 0x7f, prg_ram.data(), prg_ram.size(), true);
+        }else{
+            bus.mapMemory(0x60, 0x7f, (const std::uint8_t*)prg_ram.data(), prg_ram.size());
+        }
+    }
+
+    //board registers for save states, loadRegisters maps the banks they select
+    virtual void saveRegisters(StateWriter&) const{
+    }
+
+    virtual void loadRegisters(StateReader&){
+    }
+
+public:
+    Mapper(const Rom& rom, Bus& bus) : rom(rom), bus(bus){
+        const RomHeader& header = rom.getHeader();
+
+        std::size_t prg_ram_size = header.prg_ram_size + header.prg_nvram_size;
+        //boards that need ram almost always have 8KB, even when the header does not say so
+        if(prg_ram_size < 8 * 1024){
+            prg_ram_size = 8 * 1024;
+        }
+        //ram and nvram together can leave a part of a page, the bus maps whole ones
+        prg_ram_size = (prg_ram_size + 8 * 1024 - 1) / (8 * 1024) * (8 * 1024);
+        prg_ram.assign(prg_ram_size, 0);
+
+        //the trainer sits at 0x7000 in cartridge ram
+        std::span<const std::uint8_t> trainer = rom.getTrainer();
+        for(std::size_t i = 0; i < trainer.size(); i++){
+            prg_ram[0x1000 + i] = trainer[i];
+        }
+
+        if(rom.getChrRom().empty()){
+            std::size_t chr_ram_size = header.chr_ram_size + header.chr_nvram_size;
+            chr_ram_size = (chr_ram_size + 1024 - 1) / 1024 * 1024;
+            chr_ram.assign(chr_ram_size < 8 * 1024 ? 8 * 1024 : chr_ram_size, 0);
+        }
+
+        mirroring = header.mirroring;
+        chr_version = 0;
+        for(int i = 0; i < CHR_PAGE_COUNT; i++){
+            chr_pages[i] = nullptr;
+        }
+    }
+
+    virtual ~Mapper(){
+    }
+
+    Mapper(const Mapper&) = delete;
+    Mapper& operator=(const Mapper&) = delete;
+
+    //puts the board in its power on state and maps the initial banks
+    virtual void reset() = 0;
+
+    //cpu writes to 0x8000-0xffff
+    virtual void writeRegister(std::uint16_t adress, std::uint8_t value) = 0;
+
+    //cartridge ram, mirroring and the board registers
+    //the first 8KB of PRG_RAM is what the bus shows at 0x6000, the rest only changes through a state
+    void saveState(StateWriter& state) const{
+        std::size_t window = prg_ram.size() < 8 * 1024 ? prg_ram.size() : 8 * 1024;
+        state.put(mirroring);
+        state.tracked(prg_ram.data(), window, 0x60);
+        state.bytes(prg_ram.data() + window, prg_ram.size() - window);
+        state.bytes(chr_ram.data(), chr_ram.size());
+        saveRegisters(state);
+    }
+
+    void loadState(StateReader& state){
+        std::size_t window = prg_ram.size() < 8 * 1024 ? prg_ram.size() : 8 * 1024;
+        state.get(mirroring);
+        state.align();
+        bool changed = state.update(prg_ram.data(), window);
+        changed = state.update(prg_ram.data() + window, prg_ram.size() - window) || changed;
+        if(changed){
+            bus.touch(0x60, 0x7f);
+        }
+        if(state.update(chr_ram.data(), chr_ram.size())){
+            chr_version++;
+        }
+        loadRegisters(state);
+    }
+
+    //called by the ppu once per rendered scanline, boards with scanline counters override it
+    virtual void scanline(){
+    }
+
+    //true when scanline drives something the cpu can see, the ppu then has to be run every line
+    virtual bool countsScanlines() const{
+        return false;
+    }
+
+    std::uint8_t readChr(std::uint16_t adress) const{
+        return chr_pages[(adress >> 10) & 0b111][adress & 0x3ff];
+    }
+
+    void writeChr(std::uint16_t adress, std::uint8_t value){
+        if(!chr_ram.empty()){
+            chr_pages[(adress >> 10) & 0b111][adress & 0x3ff] = value;
+            chr_version++;
+        }
+    }
+
+    //1KB pattern table page, for the ppu to decode whole tile rows at once
+    const std::uint8_t* getChrPage(int page) const{
+        return chr_pages[page & 0b111];
+    }
+
+    std::uint32_t getChrVersion() const{
+        return chr_version;
+    }
+
+    Mirroring getMirroring() const{
+        return mirroring;
+    }
+
+    std::vector<std::uint8_t>& getPrgRam(){
+        return prg_ram;
+    }
+
+    std::vector<std::uint8_t>& getChrRam(){
+        return chr_ram;
+    }
+};
+
+//mapper 0, no bank switching
+class NROM : public Mapper {
+public:
+    NROM(const Rom& rom, Bus& bus) : Mapper(rom, bus){
+    }
+
+    void reset() override{
+        //a 16KB PRG_ROM is mirrored into both halves of 0x8000-0xffff
+        mapPrg(0x8000, 16 * 1024, 0);
+        mapPrg(0xc000, 16 * 1024, -1);
+        mapChr(0x0000, 8 * 1024, 0);
+        mapPrgRam(true, true);
+    }
+
+    void writeRegister(std::uint16_t, std::uint8_t) override{
+    }
+};
+
+//mapper 1, serial shift register with switchable PRG modes, CHR modes and mirroring
+class MMC1 : public Mapper {
+private:
+    std::uint8_t shift;
+    std::uint8_t shift_count;
+    std::uint8_t control;
+    std::uint8_t chr_bank0;
+    std::uint8_t chr_bank1;
+    std::uint8_t prg_bank;
+
+    void update(){
+        switch(control & 0b11){
+            case 0: mirroring = Mirroring::SingleScreenLower; break;
+            case 1: mirroring = Mirroring::SingleScreenUpper; break;
+            case 2: mirroring = Mirroring::Vertical; break;
+            case 3: mirroring = Mirroring::Horizontal; break;
+        }
+
+        //512KB boards use bit 4 of the CHR bank register as the 256KB PRG outer bank
+        int outer = rom.getPrgRom().size() > 256 * 1024 ? (chr_bank0 & 0b10000) : 0;
+        int bank = prg_bank & 0b1111;
+        switch((control >> 2) & 0b11){
+            case 0:
+            case 1:
+                mapPrg(0x8000, 32 * 1024, (outer | bank) >> 1);
+                break;
+            case 2:
+                mapPrg(0x8000, 16 * 1024, outer);
+                mapPrg(0xc000, 16 * 1024, outer | bank);
+                break;
+            case 3:
+                mapPrg(0x8000, 16 * 1024, outer | bank);
+                mapPrg(0xc000, 16 * 1024, outer | 0b1111);
+                break;
+        }
+
+        if(control & 0b10000){
+            mapChr(0x0000, 4 * 1024, chr_bank0);
+            mapChr(0x1000, 4 * 1024, chr_bank1);
+        }else{
+            mapChr(0x0000, 8 * 1024, chr_bank0 >> 1);
+        }
+
+        mapPrgRam(!(prg_bank & 0b10000), true);
+    }
+
+    void saveRegisters(StateWriter& state) const override{
+        state.put(shift);
+        state.put(shift_count);
+        state.put(control);
+        state.put(chr_bank0);
+        state.put(chr_bank1);
+        state.put(prg_bank);
+    }
+
+    void loadRegisters(StateReader& state) override{
+        state.get(shift);
+        state.get(shift_count);
+        state.get(control);
+        state.get(chr_bank0);
+        state.get(chr_bank1);
+        state.get(prg_bank);
+        update();
+    }
+
+public:
+    MMC1(const Rom& rom, Bus& bus) : Mapper(rom, bus){
+    }
+
+    void reset() override{
+        shift = 0;
+        shift_count = 0;
+        control = 0x0c;
+        chr_bank0 = 0;
+        chr_bank1 = 0;
+        prg_bank = 0;
+        update();
+    }
+
+    void writeRegister(std::uint16_t adress, std::uint8_t value) override{
+        //writing a value with bit 7 set clears the shift register
+        if(value & 0b10000000){
+            shift = 0;
+            shift_count = 0;
+            control = control | 0x0c;
+            update();
+            return;
+        }
+
+        shift = shift | ((value & 1) << shift_count);
+        shift_count++;
+        if(shift_count < 5){
+            return;
+        }
+
+        //the fifth write picks the register with adress bits 13 and 14
+        switch((adress >> 13) & 0b11){
+            case 0: control = shift; break;
+            case 1: chr_bank0 = shift; break;
+            case 2: chr_bank1 = shift; break;
+            case 3: prg_bank = shift; break;
+        }
+        shift = 0;
+        shift_count = 0;
+        update();
+    }
+};
+
+//mapper 2, switchable 16KB bank at 0x8000, last bank fixed at 0xc000
+class UxROM : public Mapper {
+private:
+    std::uint8_t bank;
+
+    void saveRegisters(StateWriter& state) const override{
+        state.put(bank);
+    }
+
+    void loadRegisters(StateReader& state) override{
+        state.get(bank);
+        mapPrg(0x8000, 16 * 1024, bank);
+    }
+
+public:
+    UxROM(const Rom& rom, Bus& bus) : Mapper(rom, bus){
+    }
+
+    void reset() override{
+        bank = 0;
+        mapPrg(0x8000, 16 * 1024, 0);
+        mapPrg(0xc000, 16 * 1024, -1);
+        mapChr(0x0000, 8 * 1024, 0);
+        mapPrgRam(true, true);
+    }
+
+    void writeRegister(std::uint16_t, std::uint8_t value) override{
+        bank = value;
+        mapPrg(0x8000, 16 * 1024, value);
+    }
+};
+
+//mapper 3, fixed PRG with a switchable 8KB CHR bank
+class CNROM : public Mapper {
+private:
+    std::uint8_t bank;
+
+    void saveRegisters(StateWriter& state) const override{
+        state.put(bank);
+    }
+
+    void loadRegisters(StateReader& state) override{
+        state.get(bank);
+        mapChr(0x0000, 8 * 1024, bank);
+    }
+
+public:
+    CNROM(const Rom& rom, Bus& bus) : Mapper(rom, bus){
+    }
+
+    void reset() override{
+        bank = 0;
+        mapPrg(0x8000, 16 * 1024, 0);
+        mapPrg(0xc000, 16 * 1024, -1);
+        mapChr(0x0000, 8 * 1024, 0);
+        mapPrgRam(true, true);
+    }
+
+    void writeRegister(std::uint16_t, std::uint8_t value) override{
+        bank = value;
+        mapChr(0x0000, 8 * 1024, value);
+    }
+};
+
+//mapper 4, 8KB PRG banks, 1KB/2KB CHR banks and a scanline counter that raises an irq
+class MMC3 : public Mapper {
+private:
+    std::uint8_t bank_select;
+    std::uint8_t registers[8];
+    std::uint8_t prg_ram_control;   //last write to 0xa001
+    std::uint8_t irq_latch;
+    std::uint8_t irq_counter;
+    bool irq_reload;
+    bool irq_enabled;
+
+    void update(){
+        //bit 6 swaps which of 0x8000 and 0xc000 is switchable
+        if(bank_select & 0b01000000){
+            mapPrg(0x8000, 8 * 1024, -2);
+            mapPrg(0xc000, 8 * 1024, registers[6]);
+        }else{
+            mapPrg(0x8000, 8 * 1024, registers[6]);
+            mapPrg(0xc000, 8 * 1024, -2);
+        }
+        mapPrg(0xa000, 8 * 1024, registers[7]);
+        mapPrg(0xe000, 8 * 1024, -1);
+
+        //bit 7 swaps the 2KB and 1KB halves of the pattern tables
+        std::uint16_t big = bank_select & 0b10000000 ? 0x1000 : 0x0000;
+        std::uint16_t small = big ^ 0x1000;
+        mapChr(big + 0x0000, 2 * 1024, registers[0] >> 1);
+        mapChr(big + 0x0800, 2 * 1024, registers[1] >> 1);
+        mapChr(small + 0x0000, 1024, registers[2]);
+        mapChr(small + 0x0400, 1024, registers[3]);
+        mapChr(small + 0x0800, 1024, registers[4]);
+        mapChr(small + 0x0c00, 1024, registers[5]);
+    }
+
+    void updatePrgRam(){
+        mapPrgRam(prg_ram_control & 0b10000000, !(prg_ram_control & 0b01000000));
+    }
+
+    void saveRegisters(StateWriter& state) const override{
+        state.put(bank_select);
+        state.put(registers);
+        state.put(prg_ram_control);
+        state.put(irq_latch);
+        state.put(irq_counter);
+        state.put(irq_reload);
+        state.put(irq_enabled);
+    }
+
+    void loadRegisters(StateReader& state) override{
+        state.get(bank_select);
+        state.get(registers);
+        state.get(prg_ram_control);
+        state.get(irq_latch);
+        state.get(irq_counter);
+        state.get(irq_reload);
+        state.get(irq_enabled);
+        updatePrgRam();
+        update();
+    }
+
+public:
+    MMC3(const Rom& rom, Bus& bus) : Mapper(rom, bus){
+    }
+
+    void reset() override{
+        bank_select = 0;
+        for(int i = 0; i < 8; i++){
+            registers[i] = 0;
+        }
+        registers[7] = 1;
+        prg_ram_control = 0b10000000;
+        irq_latch = 0;
+        irq_counter = 0;
+        irq_reload = false;
+        irq_enabled = false;
+        bus.setIrq(IRQ_MAPPER, false);
+        updatePrgRam();
+        update();
+    }
+
+    void writeRegister(std::uint16_t adress, std::uint8_t value) override{
+        bool odd = adress & 1;
+        switch(adress & 0xe000){
+            case 0x8000:
+                if(odd){
+                    registers[bank_select & 0b111] = value;
+                }else{
+                    bank_select = value;
+                }
+                update();
+                break;
+            case 0xa000:
+                if(odd){
+                    prg_ram_control = value;
+                    updatePrgRam();
+                }else if(mirroring != Mirroring::FourScreen){
+                    mirroring = value & 1 ? Mirroring::Horizontal : Mirroring::Vertical;
+                }
+                break;
+            case 0xc000:
+                if(odd){
+                    irq_counter = 0;
+                    irq_reload = true;
+                }else{
+                    irq_latch = value;
+                }
+                break;
+            case 0xe000:
+                if(odd){
+                    irq_enabled = true;
+                }else{
+                    irq_enabled = false;
+                    bus.setIrq(IRQ_MAPPER, false);
+                }
+                break;
+        }
+    }
+
+    bool countsScanlines() const override{
+        return true;
+    }
+
+    void scanline() override{
+        if(irq_counter == 0 || irq_reload){
+            irq_counter = irq_latch;
+            irq_reload = false;
+        }else{
+            irq_counter--;
+        }
+
+        if(irq_counter == 0 && irq_enabled){
+            bus.setIrq(IRQ_MAPPER, true);
+        }
+    }
+};
+
+//returns null when the board is not supported
+inline std::unique_ptr<Mapper> createMapper(const Rom& rom, Bus& bus){
+    switch(rom.getHeader().mapper){
+        case 0: return std::make_unique<NROM>(rom, bus);
+        case 1: return std::make_unique<MMC1>(rom, bus);
+        case 2: return std::make_unique<UxROM>(rom, bus);
+        case 3: return std::make_unique<CNROM>(rom, bus);
+        case 4: return std::make_unique<MMC3>(rom, bus);
+    }
+    return nullptr;
+}
+
+#endif // MAPPER_HPP_INCLUDED
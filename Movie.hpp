@@ -0,0 +1,70 @@
+#ifndef MOVIE_HPP_INCLUDED
+#define MOVIE_HPP_INCLUDED
+
+#include<array>
+#include<cstdint>
+#include<cstddef>
+#include<fstream>
+#include<string>
+#include<vector>
+#include"Controller.hpp"
+
+//buttons for both ports, one entry per frame
+//loads the input lines of an fceux .fm2 movie, "|commands|RLDUTSBA|RLDUTSBA|...", and ignores the
+//header and the commands. anything but '.' or ' ' in a button column means it is held
+class Movie {
+private:
+    std::vector<std::array<std::uint8_t, 2>> frames;
+
+    //the eight columns are written right to left, the first one is bit 7
+    static std::uint8_t parseButtons(const std::string& line, std::size_t first, std::size_t last){
+        std::uint8_t buttons = 0;
+        for(std::size_t i = first; i < last && i - first < 8; i++){
+            if(line[i] != '.' && line[i] != ' '){
+                buttons |= 0b10000000 >> (i - first);
+            }
+        }
+        return buttons;
+    }
+
+public:
+    //false when the file could not be read, a file without input lines is an empty movie
+    bool load(const std::string& file_name){
+        std::ifstream file(file_name);
+        if(!file){
+            return false;
+        }
+        frames.clear();
+        std::string line;
+        while(std::getline(file, line)){
+            if(line.empty() || line[0] != '|'){
+                continue;
+            }
+            std::array<std::uint8_t, 2> input = {0, 0};
+            //skip the commands field, then one field per port
+            std::size_t field = line.find('|', 1);
+            for(int port = 0; port < 2 && field != std::string::npos; port++){
+                std::size_t end = line.find('|', field + 1);
+                input[port] = parseButtons(line, field + 1, end == std::string::npos ? line.size() : end);
+                field = end;
+            }
+            frames.push_back(input);
+        }
+        return true;
+    }
+
+    void push(std::uint8_t port0, std::uint8_t port1 = 0){
+        frames.push_back({port0, port1});
+    }
+
+    //what the port holds during the frame, nothing past the end
+    std::uint8_t getButtons(std::uint64_t frame, int port) const{
+        return frame < frames.size() ? frames[frame][port & 1] : 0;
+    }
+
+    std::size_t size() const{
+        return frames.size();
+    }
+};
+
+#endif // MOVIE_HPP_INCLUDED
@@ -0,0 +1,720 @@
+#ifndef PPU_HPP_INCLUDED
+#define PPU_HPP_INCLUDED
+
+#include<array>
+#include<cstdint>
+#include<cstring>
+#include"Bus.hpp"
+#include"Mapper.hpp"
+#include"SaveState.hpp"
+
+#define SCREEN_WIDTH 256
+#define SCREEN_HEIGHT 240
+#define DOTS_PER_SCANLINE 341
+#define SCANLINES_PER_FRAME 262
+
+//2C02 colors as 0x00RRGGBB
+static constexpr std::uint32_t NES_PALETTE[64] = {
+    0x666666, 0x002a88, 0x1412a7, 0x3b00a4, 0x5c007e, 0x6e0040, 0x6c0600, 0x561d00,
+    0x333500, 0x0b4800, 0x005200, 0x004f08, 0x00404d, 0x000000, 0x000000, 0x000000,
+    0xadadad, 0x155fd9, 0x4240ff, 0x7527fe, 0xa01acc, 0xb71e7b, 0xb53120, 0x994e00,
+    0x6b6d00, 0x388700, 0x0c9300, 0x008f32, 0x007c8d, 0x000000, 0x000000, 0x000000,
+    0xfffeff, 0x64b0ff, 0x9290ff, 0xc676ff, 0xf36aff, 0xfe6ecc, 0xfe8170, 0xea9e22,
+    0xbcbe00, 0x88d800, 0x5ce430, 0x45e082, 0x48cdde, 0x4f4f4f, 0x000000, 0x000000,
+    0xfffeff, 0xc0dfff, 0xd3d2ff, 0xe8c8ff, 0xfbc2ff, 0xfec4ea, 0xfeccc5, 0xf7d8a5,
+    0xe4e594, 0xcfef96, 0xbdf4ab, 0xb3f3cc, 0xb5ebf2, 0xb8b8b8, 0x000000, 0x000000
+};
+
+//8 pixels of a tile row packed one per byte, leftmost pixel in the lowest byte
+//a row is spread[low plane] | spread[high plane] << 1, rows are stored with memcpy so this assumes a little endian host
+constexpr std::array<std::uint64_t, 256> makePixelSpread(){
+    std::array<std::uint64_t, 256> table{};
+    for(int value = 0; value < 256; value++){
+        std::uint64_t pixels = 0;
+        for(int column = 0; column < 8; column++){
+            if(value & (0b10000000 >> column)){
+                pixels = pixels | ((std::uint64_t)1 << (column * 8));
+            }
+        }
+        table[value] = pixels;
+    }
+    return table;
+}
+
+inline constexpr std::array<std::uint64_t, 256> PIXEL_SPREAD = makePixelSpread();
+
+//picture processing unit
+//runs 3 dots per cpu cycle but only does work at the few dots where something happens,
+//every visible scanline is drawn in one go when the beam reaches dot 256
+class PPU {
+private:
+    Bus& bus;
+    Mapper* mapper;
+
+    //memory
+    std::uint8_t nametables[4 * 1024];      //2KB on the console, four screen boards add the other 2KB
+    std::uint8_t palette[32];
+    std::uint32_t palette_rgb[32];          //palette already turned into colors, follows greyscale
+    std::uint8_t oam[256];                  //64 sprites, 4 bytes each
+
+    //registers
+    std::uint8_t ctrl;          //0x2000
+    std::uint8_t mask;          //0x2001
+    std::uint8_t status;        //0x2002
+    std::uint8_t oam_adress;    //0x2003
+    std::uint8_t read_buffer;   //0x2007 reads are delayed by one
+    std::uint8_t latch;         //last value written to any register
+
+    //scrolling, see "loopy" registers on the nesdev wiki
+    std::uint16_t v;            //current vram adress
+    std::uint16_t t;            //temporary vram adress
+    std::uint8_t fine_x;
+    bool w;                     //first or second write toggle
+
+    //timing
+    std::uint64_t line_clock;   //ppu clock at dot 0 of the current scanline
+    int scanline;               //0-239 visible, 240 post-render, 241-260 vblank, 261 pre-render
+    int next_dot;               //next dot on this scanline that has something to do
+    std::uint64_t frame;
+
+    std::uint32_t framebuffer[SCREEN_WIDTH * SCREEN_HEIGHT];
+
+    bool renderingEnabled() const{
+        return mask & 0b00011000;
+    }
+
+    std::uint16_t nametableIndex(std::uint16_t adress) const{
+        std::uint16_t table = (adress >> 10) & 0b11;
+        switch(mapper ? mapper->getMirroring() : Mirroring::Horizontal){
+            case Mirroring::Vertical: table = table & 1; break;
+            case Mirroring::Horizontal: table = table >> 1; break;
+            case Mirroring::SingleScreenLower: table = 0; break;
+            case Mirroring::SingleScreenUpper: table = 1; break;
+            case Mirroring::FourScreen: break;
+        }
+        return (table << 10) | (adress & 0x3ff);
+    }
+
+    static std::uint8_t paletteIndex(std::uint16_t adress){
+        std::uint8_t index = adress & 0x1f;
+        //sprite palette entry 0 mirrors the background one
+        if((index & 0b10011) == 0b10000){
+            index = index & 0x0f;
+        }
+        return index;
+    }
+
+    void updatePaletteColors(){
+        std::uint8_t grey = mask & 1 ? 0x30 : 0x3f;
+        for(int i = 0; i < 32; i++){
+            palette_rgb[i] = NES_PALETTE[palette[paletteIndex(i)] & grey];
+        }
+    }
+
+    std::uint8_t ppuRead(std::uint16_t adress){
+        adress = adress & 0x3fff;
+        if(adress < 0x2000){
+            return mapper ? mapper->readChr(adress) : 0;
+        }
+        if(adress < 0x3f00){
+            return nametables[nametableIndex(adress)];
+        }
+        return palette[paletteIndex(adress)];
+    }
+
+    void ppuWrite(std::uint16_t adress, std::uint8_t value){
+        adress = adress & 0x3fff;
+        if(adress < 0x2000){
+            if(mapper){
+                mapper->writeChr(adress, value);
+            }
+        }else if(adress < 0x3f00){
+            nametables[nametableIndex(adress)] = value;
+        }else{
+            palette[paletteIndex(adress)] = value & 0x3f;
+            updatePaletteColors();
+        }
+    }
+
+    void incrementY(){
+        if((v & 0x7000) != 0x7000){
+            v += 0x1000;
+            return;
+        }
+        v = v & ~0x7000;
+        std::uint16_t coarse_y = (v & 0x03e0) >> 5;
+        if(coarse_y == 29){
+            coarse_y = 0;
+            v = v ^ 0x0800;
+        }else if(coarse_y == 31){
+            coarse_y = 0;
+        }else{
+            coarse_y++;
+        }
+        v = (v & ~0x03e0) | (coarse_y << 5);
+    }
+
+#ifdef PPU_NAIVE_FETCH
+    //reference version that decodes the bit planes one pixel at a time, kept for benchmarking
+    //fills line with background colors, 0 where the pattern is transparent
+    void renderBackground(std::uint8_t* line){
+        std::uint16_t adress = v;
+        int x = -fine_x;
+        for(int tile = 0; tile < 33; tile++){
+            std::uint8_t tile_index = nametables[nametableIndex(0x2000 | (adress & 0x0fff))];
+            std::uint16_t attribute_adress = 0x23c0 | (adress & 0x0c00) | ((adress >> 4) & 0x38) | ((adress >> 2) & 0x07);
+            std::uint8_t attribute = nametables[nametableIndex(attribute_adress)];
+            std::uint8_t shift = ((adress >> 4) & 4) | (adress & 2);
+            std::uint8_t palette_bits = ((attribute >> shift) & 0b11) << 2;
+
+            std::uint16_t pattern = ((ctrl & 0b00010000) << 8) | (tile_index << 4) | ((adress >> 12) & 0b111);
+            std::uint8_t low = mapper->readChr(pattern);
+            std::uint8_t high = mapper->readChr(pattern + 8);
+
+            for(int bit = 7; bit >= 0; bit--, x++){
+                if(x >= 0 && x < SCREEN_WIDTH){
+                    std::uint8_t pixel = ((low >> bit) & 1) | (((high >> bit) & 1) << 1);
+                    line[x] = pixel ? palette_bits | pixel : 0;
+                }
+            }
+
+            //next tile, wrapping into the horizontal neighbour nametable
+            if((adress & 0x001f) == 31){
+                adress = (adress & ~0x001f) ^ 0x0400;
+            }else{
+                adress++;
+            }
+        }
+    }
+
+    //fills line with sprite colors (0x10-0x1f), behind and zero mark priority and sprite 0
+    void renderSprites(std::uint8_t* line, bool* behind, bool* zero){
+        int height = ctrl & 0b00100000 ? 16 : 8;
+        int found = 0;
+        for(int i = 0; i < 64; i++){
+            const std::uint8_t* sprite = oam + i * 4;
+            //oam y is one less than the first line the sprite shows up on
+            int row = scanline - sprite[0] - 1;
+            if(row < 0 || row >= height){
+                continue;
+            }
+            if(found == 8){
+                status = status | 0b00100000;
+                break;
+            }
+            found++;
+
+            std::uint8_t attributes = sprite[2];
+            if(attributes & 0b10000000){
+                row = height - 1 - row;
+            }
+            std::uint16_t pattern;
+            if(height == 16){
+                pattern = ((sprite[1] & 1) << 12) | ((sprite[1] & 0xfe) << 4);
+                if(row >= 8){
+                    pattern += 16;
+                    row -= 8;
+                }
+            }else{
+                pattern = ((ctrl & 0b00001000) << 9) | (sprite[1] << 4);
+            }
+            pattern += row;
+            std::uint8_t low = mapper->readChr(pattern);
+            std::uint8_t high = mapper->readChr(pattern + 8);
+
+            for(int column = 0; column < 8; column++){
+                int x = sprite[3] + column;
+                if(x >= SCREEN_WIDTH){
+                    break;
+                }
+                int bit = attributes & 0b01000000 ? column : 7 - column;
+                std::uint8_t pixel = ((low >> bit) & 1) | (((high >> bit) & 1) << 1);
+                //lower oam index wins, so only fill empty spots
+                if(pixel && !line[x]){
+                    line[x] = 0x10 | ((attributes & 0b11) << 2) | pixel;
+                    behind[x] = attributes & 0b00100000;
+                    zero[x] = i == 0;
+                }
+            }
+        }
+    }
+
+    void validateTileCache(){
+    }
+#else
+    //decoded rows of every tile in the eight 1KB CHR pages, decoded on first use
+    //and thrown away when the mapper switches a bank or CHR_RAM is written
+    std::uint64_t tile_rows[CHR_PAGE_COUNT * 64 * 8];
+    bool tile_decoded[CHR_PAGE_COUNT * 64];
+    std::uint32_t tile_version;
+
+    void validateTileCache(){
+        if(mapper->getChrVersion() != tile_version){
+            for(int i = 0; i < CHR_PAGE_COUNT * 64; i++){
+                tile_decoded[i] = false;
+            }
+            tile_version = mapper->getChrVersion();
+        }
+    }
+
+    //pattern is the CHR adress of the row in the low bit plane
+    std::uint64_t tileRow(std::uint16_t pattern){
+        int tile = (pattern >> 4) & 0x1ff;
+        if(!tile_decoded[tile]){
+            const std::uint8_t* planes = mapper->getChrPage(tile >> 6) + ((tile & 63) << 4);
+            for(int row = 0; row < 8; row++){
+                tile_rows[tile * 8 + row] = PIXEL_SPREAD[planes[row]] | (PIXEL_SPREAD[planes[row + 8]] << 1);
+            }
+            tile_decoded[tile] = true;
+        }
+        return tile_rows[tile * 8 + (pattern & 0b111)];
+    }
+
+    static std::uint64_t mirrorRow(std::uint64_t pixels){
+        return __builtin_bswap64(pixels);
+    }
+
+    //fills line with background colors, 0 where the pattern is transparent
+    //whole tile rows are written 8 pixels at a time
+    void renderBackground(std::uint8_t* line){
+        std::uint8_t row[SCREEN_WIDTH + 16];
+        std::uint16_t adress = v;
+        for(int tile = 0; tile < 33; tile++){
+            std::uint8_t tile_index = nametables[nametableIndex(0x2000 | (adress & 0x0fff))];
+            std::uint16_t attribute_adress = 0x23c0 | (adress & 0x0c00) | ((adress >> 4) & 0x38) | ((adress >> 2) & 0x07);
+            std::uint8_t attribute = nametables[nametableIndex(attribute_adress)];
+            std::uint8_t shift = ((adress >> 4) & 4) | (adress & 2);
+            std::uint64_t palette_bits = ((attribute >> shift) & 0b11) << 2;
+
+            std::uint16_t pattern = ((ctrl & 0b00010000) << 8) | (tile_index << 4) | ((adress >> 12) & 0b111);
+            std::uint64_t pixels = tileRow(pattern);
+            //only opaque pixels get the palette bits
+            std::uint64_t opaque = (pixels | (pixels >> 1)) & 0x0101010101010101;
+            pixels = pixels | (opaque * palette_bits);
+            std::memcpy(row + tile * 8, &pixels, 8);
+
+            //next tile, wrapping into the horizontal neighbour nametable
+            if((adress & 0x001f) == 31){
+                adress = (adress & ~0x001f) ^ 0x0400;
+            }else{
+                adress++;
+            }
+        }
+        std::memcpy(line, row + fine_x, SCREEN_WIDTH);
+    }
+
+    //fills line with sprite colors (0x10-0x1f), behind and zero mark priority and sprite 0
+    void renderSprites(std::uint8_t* line, bool* behind, bool* zero){
+        int height = ctrl & 0b00100000 ? 16 : 8;
+        int found = 0;
+        for(int i = 0; i < 64; i++){
+            const std::uint8_t* sprite = oam + i * 4;
+            //oam y is one less than the first line the sprite shows up on
+            int row = scanline - sprite[0] - 1;
+            if(row < 0 || row >= height){
+                continue;
+            }
+            if(found == 8){
+                status = status | 0b00100000;
+                break;
+            }
+            found++;
+
+            std::uint8_t attributes = sprite[2];
+            if(attributes & 0b10000000){
+                row = height - 1 - row;
+            }
+            std::uint16_t pattern;
+            if(height == 16){
+                pattern = ((sprite[1] & 1) << 12) | ((sprite[1] & 0xfe) << 4);
+                if(row >= 8){
+                    pattern += 16;
+                    row -= 8;
+                }
+            }else{
+                pattern = ((ctrl & 0b00001000) << 9) | (sprite[1] << 4);
+            }
+            std::uint64_t pixels = tileRow(pattern + row);
+            if(!pixels){
+                continue;
+            }
+            if(attributes & 0b01000000){
+                pixels = mirrorRow(pixels);
+            }
+
+            std::uint8_t palette_bits = 0x10 | ((attributes & 0b11) << 2);
+            for(int column = 0; column < 8; column++, pixels >>= 8){
+                int x = sprite[3] + column;
+                if(x >= SCREEN_WIDTH){
+                    break;
+                }
+                std::uint8_t pixel = pixels & 0b11;
+                //lower oam index wins, so only fill empty spots
+                if(pixel && !line[x]){
+                    line[x] = palette_bits | pixel;
+                    behind[x] = attributes & 0b00100000;
+                    zero[x] = i == 0;
+                }
+            }
+        }
+    }
+#endif
+
+    void renderScanline(){
+        validateTileCache();
+
+        std::uint8_t background[SCREEN_WIDTH] = {};
+        std::uint8_t sprites[SCREEN_WIDTH] = {};
+        bool behind[SCREEN_WIDTH];
+        bool zero[SCREEN_WIDTH] = {};
+
+        if(mask & 0b00001000){
+            renderBackground(background);
+            if(!(mask & 0b00000010)){
+                for(int x = 0; x < 8; x++){
+                    background[x] = 0;
+                }
+            }
+        }
+        if(mask & 0b00010000){
+            renderSprites(sprites, behind, zero);
+            if(!(mask & 0b00000100)){
+                for(int x = 0; x < 8; x++){
+                    sprites[x] = 0;
+                }
+            }
+        }
+
+        std::uint32_t* pixels = framebuffer + scanline * SCREEN_WIDTH;
+        for(int x = 0; x < SCREEN_WIDTH; x++){
+            std::uint8_t color = background[x];
+            if(sprites[x]){
+                if(zero[x] && background[x] && x != 255){
+                    status = status | 0b01000000;
+                }
+                if(!behind[x] || !background[x]){
+                    color = sprites[x];
+                }
+            }
+            pixels[x] = palette_rgb[color];
+        }
+    }
+
+    //first dot after dot that has work on this scanline, 341 means the end of the line
+    int nextEvent(int dot) const{
+        if(scanline < 240 || scanline == 261){
+            if(scanline == 261 && dot < 1){
+                return 1;
+            }
+            if(dot < 256){
+                return 256;
+            }
+            if(dot < 257){
+                return 257;
+            }
+            if(dot < 260){
+                return 260;
+            }
+            if(scanline == 261 && dot < 280){
+                return 280;
+            }
+            return DOTS_PER_SCANLINE;
+        }
+        if(scanline == 241 && dot < 1){
+            return 1;
+        }
+        return DOTS_PER_SCANLINE;
+    }
+
+    void event(){
+        bool rendering = renderingEnabled();
+        switch(next_dot){
+            case 1:
+                if(scanline == 241){
+                    status = status | 0b10000000;
+                    if(ctrl & 0b10000000){
+                        bus.triggerNmi();
+                    }
+                }else{
+                    //pre-render line clears vblank, sprite 0 hit and overflow
+                    status = status & 0b00011111;
+                }
+                break;
+            case 256:
+                if(scanline < SCREEN_HEIGHT){
+                    if(rendering && mapper){
+                        renderScanline();
+                    }else{
+                        std::uint32_t* pixels = framebuffer + scanline * SCREEN_WIDTH;
+                        for(int x = 0; x < SCREEN_WIDTH; x++){
+                            pixels[x] = palette_rgb[0];
+                        }
+                    }
+                }
+                if(rendering){
+                    incrementY();
+                }
+                break;
+            case 257:
+                if(rendering){
+                    v = (v & ~0x041f) | (t & 0x041f);
+                }
+                break;
+            case 260:
+                if(rendering && mapper){
+                    mapper->scanline();
+                }
+                break;
+            case 280:
+                if(rendering){
+                    v = (v & ~0x7be0) | (t & 0x7be0);
+                }
+                break;
+            case DOTS_PER_SCANLINE:
+                //odd frames skip the last dot of the pre-render line when rendering
+                line_clock += DOTS_PER_SCANLINE;
+                if(scanline == 261 && (frame & 1) && rendering){
+                    line_clock--;
+                }
+                scanline++;
+                if(scanline == SCANLINES_PER_FRAME){
+                    scanline = 0;
+                }
+                if(scanline == 241){
+                    frame++;
+                }
+                next_dot = nextEvent(-1);
+                return;
+        }
+        next_dot = nextEvent(next_dot);
+    }
+
+    static std::uint8_t readRegisterHandler(void* context, std::uint16_t adress){
+        return static_cast<PPU*>(context)->readRegister(adress);
+    }
+
+    static void writeRegisterHandler(void* context, std::uint16_t adress, std::uint8_t value){
+        static_cast<PPU*>(context)->writeRegister(adress, value);
+    }
+
+public:
+    PPU(Bus& bus) : bus(bus){
+        mapper = nullptr;
+        for(int i = 0; i < 4 * 1024; i++){
+            nametables[i] = 0;
+        }
+        for(int i = 0; i < 32; i++){
+            palette[i] = 0;
+        }
+        for(int i = 0; i < 256; i++){
+            oam[i] = 0;
+        }
+        for(int i = 0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i++){
+            framebuffer[i] = 0;
+        }
+        reset(0);
+
+        //0x2000-0x2007 mirrored up to 0x3fff
+        bus.mapHandlers(0x20, 0x3f, readRegisterHandler, writeRegisterHandler, this);
+    }
+
+    PPU(const PPU&) = delete;
+    PPU& operator=(const PPU&) = delete;
+
+    void connect(Mapper* cartridge){
+        mapper = cartridge;
+#ifndef PPU_NAIVE_FETCH
+        for(int i = 0; i < CHR_PAGE_COUNT * 64; i++){
+            tile_decoded[i] = false;
+        }
+        tile_version = cartridge ? cartridge->getChrVersion() : 0;
+#endif
+    }
+
+    //the ppu starts counting from the given cpu cycle, a console that already ran keeps its clock
+    void reset(std::uint64_t cpu_cycle){
+        ctrl = 0;
+        mask = 0;
+        status = 0;
+        oam_adress = 0;
+        read_buffer = 0;
+        latch = 0;
+        v = 0;
+        t = 0;
+        fine_x = 0;
+        w = false;
+        line_clock = cpu_cycle * 3;
+        scanline = 0;
+        next_dot = nextEvent(-1);
+        frame = 0;
+        updatePaletteColors();
+    }
+
+    //brings the ppu up to the given cpu cycle
+    void run(std::uint64_t cpu_cycle){
+        std::uint64_t target = cpu_cycle * 3;
+        while(line_clock + next_dot <= target){
+            event();
+        }
+    }
+
+    //cpu cycle by which run has to be called so nothing the cpu can see happens late: the start of
+    //vblank (frame count, status and nmi) and dot 260 of rendered lines when the mapper counts them.
+    //everything else only shows through the registers, which are caught up on access
+    std::uint64_t nextSyncCycle() const{
+        bool lines = mapper && mapper->countsScanlines();
+        int line = scanline;
+        int dot = next_dot;
+        std::uint64_t clock = line_clock;
+        while(true){
+            if(lines && (line < 240 || line == 261) && dot <= 260){
+                clock += 260;
+                break;
+            }
+            if(line == 241 && dot <= 1){
+                clock += 1;
+                break;
+            }
+            //assume the odd frame skip, an early guess only costs an extra run
+            clock += line == 261 && (frame & 1) ? DOTS_PER_SCANLINE - 1 : DOTS_PER_SCANLINE;
+            line = line == SCANLINES_PER_FRAME - 1 ? 0 : line + 1;
+            dot = 0;
+        }
+        return (clock + 2) / 3;
+    }
+
+    std::uint8_t readRegister(std::uint16_t adress){
+        std::uint8_t value = latch;
+        switch(adress & 0b111){
+            case 2:
+                value = (status & 0b11100000) | (latch & 0b00011111);
+                status = status & 0b01111111;
+                w = false;
+                break;
+            case 4:
+                value = oam[oam_adress];
+                break;
+            case 7:
+                if((v & 0x3fff) < 0x3f00){
+                    value = read_buffer;
+                    read_buffer = ppuRead(v);
+                }else{
+                    //palette reads are not delayed, the buffer gets the nametable byte underneath
+                    value = ppuRead(v);
+                    read_buffer = ppuRead(v - 0x1000);
+                }
+                v += ctrl & 0b00000100 ? 32 : 1;
+                break;
+        }
+        latch = value;
+        return value;
+    }
+
+    void writeRegister(std::uint16_t adress, std::uint8_t value){
+        latch = value;
+        switch(adress & 0b111){
+            case 0:
+                //turning nmi on during vblank fires it right away
+                if(!(ctrl & 0b10000000) && (value & 0b10000000) && (status & 0b10000000)){
+                    bus.triggerNmi();
+                }
+                ctrl = value;
+                t = (t & 0xf3ff) | ((value & 0b11) << 10);
+                break;
+            case 1:
+                mask = value;
+                updatePaletteColors();
+                break;
+            case 3:
+                oam_adress = value;
+                break;
+            case 4:
+                oam[oam_adress++] = value;
+                break;
+            case 5:
+                if(!w){
+                    t = (t & 0xffe0) | (value >> 3);
+                    fine_x = value & 0b111;
+                }else{
+                    t = (t & 0x8c1f) | ((value & 0b111) << 12) | ((value & 0xf8) << 2);
+                }
+                w = !w;
+                break;
+            case 6:
+                if(!w){
+                    t = (t & 0x00ff) | ((value & 0x3f) << 8);
+                }else{
+                    t = (t & 0xff00) | value;
+                    v = t;
+                }
+                w = !w;
+                break;
+            case 7:
+                ppuWrite(v, value);
+                v += ctrl & 0b00000100 ? 32 : 1;
+                break;
+        }
+    }
+
+    //memory, registers and timing. the framebuffer is left out, it is output and the next frame redraws it
+    void saveState(StateWriter& state) const{
+        state.put(nametables);
+        state.put(palette);
+        state.put(oam);
+        state.put(ctrl);
+        state.put(mask);
+        state.put(status);
+        state.put(oam_adress);
+        state.put(read_buffer);
+        state.put(latch);
+        state.put(v);
+        state.put(t);
+        state.put(fine_x);
+        state.put(w);
+        state.put(line_clock);
+        state.put(scanline);
+        state.put(next_dot);
+        state.put(frame);
+    }
+
+    void loadState(StateReader& state){
+        state.get(nametables);
+        state.get(palette);
+        state.get(oam);
+        state.get(ctrl);
+        state.get(mask);
+        state.get(status);
+        state.get(oam_adress);
+        state.get(read_buffer);
+        state.get(latch);
+        state.get(v);
+        state.get(t);
+        state.get(fine_x);
+        state.get(w);
+        state.get(line_clock);
+        state.get(scanline);
+        state.get(next_dot);
+        state.get(frame);
+        updatePaletteColors();
+    }
+
+    //sprite dma from 0x4014, the cpu reads the page and hands it over one byte at a time
+    void writeOam(std::uint8_t value){
+        oam[oam_adress++] = value;
+    }
+
+    const std::uint32_t* getFramebuffer() const{
+        return framebuffer;
+    }
+
+    //completed frames, goes up when vblank starts
+    std::uint64_t getFrame() const{
+        return frame;
+    }
+
+    int getScanline() const{
+        return scanline;
+    }
+};
+
+#endif // PPU_HPP_INCLUDED
@@ -0,0 +1,97 @@
+#ifndef PERFCOUNTER_HPP_INCLUDED
+#define PERFCOUNTER_HPP_INCLUDED
+
+#include<cstdint>
+#include<cstring>
+#ifdef __linux__
+#include<linux/perf_event.h>
+#include<sys/ioctl.h>
+#include<sys/syscall.h>
+#include<unistd.h>
+#endif
+
+//what the host cpu counts
+enum class PerfEvent {
+    Instructions,
+    Cycles,
+    BranchMisses,
+    CacheMisses
+};
+
+//a hardware counter of the calling thread, user space only
+//on hosts without perf events (not linux, containers, perf_event_paranoid too high) it is
+//unavailable and every read gives 0, callers check available() before using the numbers
+class PerfCounter {
+private:
+    int fd;
+
+public:
+    explicit PerfCounter(PerfEvent event){
+        fd = -1;
+#ifdef __linux__
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        switch(event){
+            case PerfEvent::Instructions:
+                attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+                break;
+            case PerfEvent::Cycles:
+                attr.config = PERF_COUNT_HW_CPU_CYCLES;
+                break;
+            case PerfEvent::BranchMisses:
+                attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+                break;
+            case PerfEvent::CacheMisses:
+                attr.config = PERF_COUNT_HW_CACHE_MISSES;
+                break;
+        }
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+    }
+
+    ~PerfCounter(){
+#ifdef __linux__
+        if(fd >= 0){
+            close(fd);
+        }
+#endif
+    }
+
+    PerfCounter(const PerfCounter&) = delete;
+    PerfCounter& operator=(const PerfCounter&) = delete;
+
+    bool available() const{
+        return fd >= 0;
+    }
+
+    //zeroes the count and starts counting
+    void start(){
+#ifdef __linux__
+        if(fd >= 0){
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    //stops counting and returns what was counted since start
+    std::uint64_t stop(){
+        std::uint64_t count = 0;
+#ifdef __linux__
+        if(fd >= 0){
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            if(read(fd, &count, sizeof(count)) != sizeof(count)){
+                count = 0;
+            }
+        }
+#endif
+        return count;
+    }
+};
+
+#endif // PERFCOUNTER_HPP_INCLUDED
@@ -0,0 +1,256 @@
+#ifndef PROFILER_HPP_INCLUDED
+#define PROFILER_HPP_INCLUDED
+
+#include<algorithm>
+#include<cstdint>
+#include<cstddef>
+#include<cstdio>
+#include<ostream>
+#include<string>
+#include<unordered_map>
+#include<vector>
+#include"Disassembler.hpp"
+
+#define PROFILE_ROM 0x10000         //locations from here on are offsets into PRG_ROM, below it plain adresses
+#define PROFILE_BANK_SIZE 0x2000    //banks are named in 8KB units, the smallest any mapper switches
+
+//what a frame of the guest call stack was entered through
+#define PROFILE_CALL 0              //JSR
+#define PROFILE_NMI 1
+#define PROFILE_IRQ 2               //irq and BRK, they share the vector
+
+struct ProfileCounts {
+    std::uint64_t count;
+    std::uint64_t cycles;
+};
+
+//one instruction adress and what ran there
+struct ProfileHotSpot {
+    std::uint32_t location;
+    std::uint16_t pc;
+    std::uint8_t op_code;
+    ProfileCounts counts;
+};
+
+//counts instructions and their cycles per op code and per adress while the cpu runs, and follows
+//the guest's JSR/RTS and interrupt/RTI nesting so cycles can be put on call stacks.
+//adresses are bank aware: code in PRG_ROM is counted on its offset in the image, so two banks
+//that switch in at the same adress stay apart, ram and anything else on the adress.
+//frames are left when the stack pointer goes back above where they were entered, which also
+//covers RTS used as a jump and stacks thrown away with TXS.
+//CPU calls it only when built with CPU_PROFILE, see CPU::setProfiler
+class Profiler {
+private:
+    struct Node {
+        std::uint32_t parent;
+        std::uint32_t location;     //where the frame was entered
+        std::uint8_t kind;          //PROFILE_*
+        ProfileCounts counts;       //spent in the frame itself
+    };
+
+    struct Frame {
+        std::uint32_t node;
+        std::uint8_t sp;            //stack pointer before the return adress was pushed
+    };
+
+    std::vector<ProfileCounts> ops;
+    std::vector<ProfileCounts> locations;       //PROFILE_ROM plain adresses followed by the PRG_ROM offsets
+    std::vector<std::uint16_t> pcs;             //adress each location was last run at
+    std::vector<std::uint8_t> op_codes;         //op code each location last ran
+    std::vector<Node> nodes;                    //node 0 is the root, whatever runs outside any call
+    std::unordered_map<std::uint64_t, std::uint32_t> children;
+    std::vector<Frame> frames;
+    std::uint32_t current;
+
+    std::string frameName(const Node& node) const{
+        const char* prefix = node.kind == PROFILE_NMI ? "nmi_" : node.kind == PROFILE_IRQ ? "irq_" : "";
+        return prefix + locationName(node.location, pcs[node.location]);
+    }
+
+public:
+    //prg_rom_size is the size of the image the cpu runs, adresses in it get their own counts
+    explicit Profiler(std::size_t prg_rom_size = 0){
+        ops.resize(256);
+        locations.resize(PROFILE_ROM + prg_rom_size);
+        pcs.resize(locations.size());
+        op_codes.resize(locations.size());
+        clear();
+    }
+
+    //forgets everything counted, the size stays
+    void clear(){
+        std::fill(ops.begin(), ops.end(), ProfileCounts{});
+        std::fill(locations.begin(), locations.end(), ProfileCounts{});
+        nodes.assign(1, Node{0, 0, PROFILE_CALL, {}});
+        children.clear();
+        frames.clear();
+        current = 0;
+    }
+
+    //grows the counts for a bigger image, the cpu calls this when it is handed the profiler
+    void reserveRom(std::size_t prg_rom_size){
+        if(PROFILE_ROM + prg_rom_size > locations.size()){
+            locations.resize(PROFILE_ROM + prg_rom_size);
+            pcs.resize(locations.size());
+            op_codes.resize(locations.size());
+        }
+    }
+
+    std::size_t capacity() const{
+        return locations.size();
+    }
+
+    //an instruction that ran, on the frame it ran in
+    void record(std::uint8_t op_code, std::uint32_t location, std::uint16_t pc, std::uint64_t cycles){
+        ops[op_code].count++;
+        ops[op_code].cycles += cycles;
+        locations[location].count++;
+        locations[location].cycles += cycles;
+        pcs[location] = pc;
+        op_codes[location] = op_code;
+        nodes[current].counts.count++;
+        nodes[current].counts.cycles += cycles;
+    }
+
+    //enters a frame at location, sp is the stack pointer before anything was pushed for it
+    void call(std::uint32_t location, std::uint16_t pc, std::uint8_t sp, std::uint8_t kind){
+        unwind(sp);
+        std::uint64_t key = (std::uint64_t)current << 32 | (std::uint64_t)kind << 24 | location;
+        auto found = children.find(key);
+        if(found == children.end()){
+            nodes.push_back(Node{current, location, kind, {}});
+            found = children.emplace(key, (std::uint32_t)(nodes.size() - 1)).first;
+        }
+        pcs[location] = pc;
+        frames.push_back(Frame{found->second, sp});
+        current = found->second;
+    }
+
+    //leaves every frame the stack pointer has gone back above
+    void unwind(std::uint8_t sp){
+        while(!frames.empty() && frames.back().sp <= sp){
+            frames.pop_back();
+        }
+        current = frames.empty() ? 0 : frames.back().node;
+    }
+
+    //an interrupt's own cycles, counted on the frame it entered
+    void recordInterrupt(std::uint64_t cycles){
+        nodes[current].counts.cycles += cycles;
+    }
+
+    static std::string locationName(std::uint32_t location, std::uint16_t pc){
+        char name[16];
+        if(location >= PROFILE_ROM){
+            std::snprintf(name, sizeof(name), "%02X:%04X", (location - PROFILE_ROM) / PROFILE_BANK_SIZE, pc);
+        }else{
+            std::snprintf(name, sizeof(name), "%04X", pc);
+        }
+        return name;
+    }
+
+    const ProfileCounts& getOpCounts(std::uint8_t op_code) const{
+        return ops[op_code];
+    }
+
+    //op code counts summed by addressing mode
+    ProfileCounts getModeCounts(AddressingMode mode) const{
+        ProfileCounts counts = {};
+        for(int op_code = 0; op_code < 256; op_code++){
+            if(OP_TABLE[op_code].mode == mode){
+                counts.count += ops[op_code].count;
+                counts.cycles += ops[op_code].cycles;
+            }
+        }
+        return counts;
+    }
+
+    //the adresses that took the most cycles, most first
+    std::vector<ProfileHotSpot> getHotSpots(std::size_t count) const{
+        std::vector<ProfileHotSpot> spots;
+        for(std::uint32_t location = 0; location < locations.size(); location++){
+            if(locations[location].count > 0){
+                spots.push_back(ProfileHotSpot{location, pcs[location], op_codes[location], locations[location]});
+            }
+        }
+        count = std::min(count, spots.size());
+        std::partial_sort(spots.begin(), spots.begin() + count, spots.end(), [](const ProfileHotSpot& a, const ProfileHotSpot& b){
+            return a.counts.cycles > b.counts.cycles;
+        });
+        spots.resize(count);
+        return spots;
+    }
+
+    //op codes, addressing modes and the top adresses as plain text
+    void writeReport(std::ostream& out, std::size_t hot_spots = 20) const{
+        std::uint64_t total = 0;
+        for(const ProfileCounts& counts : ops){
+            total += counts.cycles;
+        }
+        auto percent = [total](std::uint64_t cycles){
+            return total > 0 ? 100.0 * cycles / total : 0.0;
+        };
+        char line[128];
+
+        out<<"op codes by cycles\n";
+        std::vector<int> order;
+        for(int op_code = 0; op_code < 256; op_code++){
+            if(ops[op_code].count > 0){
+                order.push_back(op_code);
+            }
+        }
+        std::sort(order.begin(), order.end(), [this](int a, int b){
+            return ops[a].cycles > ops[b].cycles;
+        });
+        for(int op_code : order){
+            std::snprintf(line, sizeof(line), "  %02X %s %-11s %12llu instructions %12llu cycles %6.2f%%\n", op_code,
+                          OP_TABLE[op_code].mnemonic, modeName(OP_TABLE[op_code].mode), (unsigned long long)ops[op_code].count,
+                          (unsigned long long)ops[op_code].cycles, percent(ops[op_code].cycles));
+            out<<line;
+        }
+
+        out<<"addressing modes by cycles\n";
+        for(int mode = 0; mode <= (int)AddressingMode::Relative; mode++){
+            ProfileCounts counts = getModeCounts((AddressingMode)mode);
+            if(counts.count > 0){
+                std::snprintf(line, sizeof(line), "  %-11s %12llu instructions %12llu cycles %6.2f%%\n", modeName((AddressingMode)mode),
+                              (unsigned long long)counts.count, (unsigned long long)counts.cycles, percent(counts.cycles));
+                out<<line;
+            }
+        }
+
+        out<<"hot spots by cycles\n";
+        for(const ProfileHotSpot& spot : getHotSpots(hot_spots)){
+            std::snprintf(line, sizeof(line), "  %-8s %s %12llu instructions %12llu cycles %6.2f%%\n",
+                          locationName(spot.location, spot.pc).c_str(), OP_TABLE[spot.op_code].mnemonic,
+                          (unsigned long long)spot.counts.count, (unsigned long long)spot.counts.cycles, percent(spot.counts.cycles));
+            out<<line;
+        }
+    }
+
+    //one line per call stack with the cycles spent in its innermost frame, the folded format
+    //flamegraph.pl and speedscope read:  main;C123;03:8456 1234
+    void writeFolded(std::ostream& out) const{
+        std::vector<std::string> names(nodes.size());
+        names[0] = "main";
+        //children are always added after their parent
+        for(std::size_t i = 1; i < nodes.size(); i++){
+            names[i] = names[nodes[i].parent] + ";" + frameName(nodes[i]);
+        }
+        for(std::size_t i = 0; i < nodes.size(); i++){
+            if(nodes[i].counts.cycles > 0){
+                out<<names[i]<<' '<<nodes[i].counts.cycles<<'\n';
+            }
+        }
+    }
+
+    static const char* modeName(AddressingMode mode){
+        static const char* const names[] = {
+            "implied", "accumulator", "immediate", "zeropage", "zeropage,x", "zeropage,y", "absolute",
+            "absolute,x", "absolute,y", "indirect", "(indirect,x)", "(indirect),y", "relative"
+        };
+        return names[(int)mode];
+    }
+};
+
+#endif // PROFILER_HPP_INCLUDED
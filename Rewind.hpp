@@ -0,0 +1,91 @@
+#ifndef REWIND_HPP_INCLUDED
+#define REWIND_HPP_INCLUDED
+
+#include<cstdint>
+#include<cstddef>
+#include<deque>
+#include"CPU.hpp"
+#include"Snapshot.hpp"
+
+#define REWIND_FRAME_RATE 60    //snapshots per second of history, one per ntsc frame
+
+//rewind history, a snapshot per frame each sharing its unchanged pages with the one before.
+//keeps at most the given seconds and bytes of pages, the oldest frames go first when either runs out
+class RewindBuffer {
+private:
+    struct Entry {
+        Snapshot snapshot;
+        std::size_t bytes;      //pages only this entry keeps alive, all of them for the oldest
+    };
+
+    std::deque<Entry> entries;
+    std::size_t max_entries;
+    std::size_t max_bytes;
+    std::size_t used;           //bytes of pages held, shared pages counted once
+
+    void dropOldest(){
+        used -= entries.front().bytes;
+        entries.pop_front();
+        if(!entries.empty()){
+            //the new oldest now holds the pages it shared with the dropped one by itself
+            Entry& oldest = entries.front();
+            std::size_t all = oldest.snapshot.getPageCount() * STATE_PAGE_SIZE;
+            used += all - oldest.bytes;
+            oldest.bytes = all;
+        }
+    }
+
+public:
+    RewindBuffer(double seconds, std::size_t max_bytes) : max_bytes(max_bytes){
+        max_entries = seconds * REWIND_FRAME_RATE;
+        if(max_entries < 1){
+            max_entries = 1;
+        }
+        used = 0;
+    }
+
+    //records the console as it is now, call once per frame
+    void push(CPU& cpu){
+        const Snapshot* parent = entries.empty() ? nullptr : &entries.back().snapshot;
+        Entry entry;
+        entry.snapshot = cpu.takeSnapshot(parent);
+        entry.bytes = (parent ? entry.snapshot.getFreshPages() : entry.snapshot.getPageCount()) * STATE_PAGE_SIZE;
+        used += entry.bytes;
+        entries.push_back(std::move(entry));
+        while(entries.size() > max_entries || (used > max_bytes && entries.size() > 1)){
+            dropOldest();
+        }
+    }
+
+    //puts the console back to the snapshot frames pushes ago, 0 being the last one, and forgets
+    //everything newer so history carries on from there. goes as far back as it has, false when empty
+    bool rewind(CPU& cpu, std::size_t frames){
+        if(entries.empty()){
+            return false;
+        }
+        if(frames >= entries.size()){
+            frames = entries.size() - 1;
+        }
+        for(std::size_t i = 0; i < frames; i++){
+            used -= entries.back().bytes;
+            entries.pop_back();
+        }
+        return cpu.restore(entries.back().snapshot) == StateError::None;
+    }
+
+    void clear(){
+        entries.clear();
+        used = 0;
+    }
+
+    //frames of history held
+    std::size_t size() const{
+        return entries.size();
+    }
+
+    std::size_t getMemoryUsed() const{
+        return used;
+    }
+};
+
+#endif // REWIND_HPP_INCLUDED
@@ -0,0 +1,69 @@
+#ifndef RINGBUFFER_HPP_INCLUDED
+#define RINGBUFFER_HPP_INCLUDED
+
+#include<atomic>
+#include<cstddef>
+
+//single producer, single consumer queue that never blocks either side
+//the emulation thread pushes, an audio callback or file writer pops
+//Capacity has to be a power of two, one slot is always kept free
+template<typename T, std::size_t Capacity>
+class RingBuffer {
+private:
+    static_assert((Capacity & (Capacity - 1)) == 0, "RingBuffer capacity must be a power of two");
+
+    T items[Capacity];
+    //each index is written by one side only, kept on separate cache lines so they do not bounce
+    alignas(64) std::atomic<std::size_t> head;  //next slot to write, owned by the producer
+    alignas(64) std::atomic<std::size_t> tail;  //next slot to read, owned by the consumer
+
+public:
+    RingBuffer() : head(0), tail(0){
+    }
+
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+
+    //producer side, returns false and drops the item when the consumer is too slow
+    bool push(const T& item){
+        std::size_t position = head.load(std::memory_order_relaxed);
+        std::size_t next = (position + 1) & (Capacity - 1);
+        if(next == tail.load(std::memory_order_acquire)){
+            return false;
+        }
+        items[position] = item;
+        head.store(next, std::memory_order_release);
+        return true;
+    }
+
+    //consumer side, copies up to count items out and returns how many there were
+    std::size_t pop(T* out, std::size_t count){
+        std::size_t position = tail.load(std::memory_order_relaxed);
+        std::size_t end = head.load(std::memory_order_acquire);
+        std::size_t available = (end - position) & (Capacity - 1);
+        if(count > available){
+            count = available;
+        }
+        for(std::size_t i = 0; i < count; i++){
+            out[i] = items[(position + i) & (Capacity - 1)];
+        }
+        tail.store((position + count) & (Capacity - 1), std::memory_order_release);
+        return count;
+    }
+
+    std::size_t size() const{
+        return (head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire)) & (Capacity - 1);
+    }
+
+    bool empty() const{
+        return size() == 0;
+    }
+
+    //only safe while neither side is running
+    void clear(){
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_relaxed);
+    }
+};
+
+#endif // RINGBUFFER_HPP_INCLUDED
@@ -0,0 +1,344 @@
+#ifndef ROM_HPP_INCLUDED
+#define ROM_HPP_INCLUDED
+
+#include<atomic>
+#include<cstdint>
+#include<cstddef>
+#include<memory>
+#include<span>
+#include<string>
+#include<vector>
+#include<fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include<fcntl.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<unistd.h>
+#define ROM_USE_MMAP 1
+#endif
+
+enum class RomError {
+    None,
+    CannotOpen,         //file missing or unreadable
+    CannotMap,          //mmap failed
+    TooSmall,           //shorter than the 16 byte header
+    BadMagic,           //does not start with "NES\x1a"
+    Truncated,          //header promises more data than the file has
+    NoPrgRom,           //header says there is no PRG_ROM
+    BadSize,            //PRG_ROM not in 8KB banks or CHR_ROM not in 1KB banks
+    UnsupportedMapper   //no Mapper implementation for this board
+};
+
+inline const char* romErrorString(RomError error){
+    switch(error){
+        case RomError::None: return "no error";
+        case RomError::CannotOpen: return "could not open file";
+        case RomError::CannotMap: return "could not map file";
+        case RomError::TooSmall: return "file is smaller than the iNES header";
+        case RomError::BadMagic: return "not an iNES file";
+        case RomError::Truncated: return "file is shorter than its header says";
+        case RomError::NoPrgRom: return "image has no PRG_ROM";
+        case RomError::BadSize: return "PRG_ROM or CHR_ROM size is not a whole number of banks";
+        case RomError::UnsupportedMapper: return "mapper is not supported";
+    }
+    return "unknown error";
+}
+
+enum class Mirroring {
+    Horizontal,
+    Vertical,
+    FourScreen,
+    SingleScreenLower,  //only used by mappers that switch mirroring at runtime
+    SingleScreenUpper
+};
+
+//everything the iNES / NES 2.0 header tells us, sizes are in bytes
+struct RomHeader {
+    bool nes2;
+    std::uint16_t mapper;
+    std::uint8_t submapper;
+    Mirroring mirroring;
+    bool battery;               //cartridge ram is kept when the console is off
+    bool trainer;               //512 bytes loaded to 0x7000 before PRG_ROM
+    std::size_t prg_rom_size;
+    std::size_t chr_rom_size;   //0 means the board has CHR_RAM instead
+    std::size_t prg_ram_size;
+    std::size_t prg_nvram_size;
+    std::size_t chr_ram_size;
+    std::size_t chr_nvram_size;
+    std::uint8_t timing;        //0 NTSC, 1 PAL, 2 multi region, 3 Dendy
+};
+
+//a .nes image mapped read only into memory
+//PRG and CHR are spans straight into the mapping, nothing is copied. once opened nothing
+//changes it, so one Rom behind a shared_ptr can back any number of consoles at the same time
+class Rom {
+private:
+    const std::uint8_t* data;
+    std::size_t size;
+    bool mapped;                    //data comes from mmap, otherwise from buffer
+    std::vector<std::uint8_t> buffer;
+
+    RomHeader header;
+    std::span<const std::uint8_t> trainer_data;
+    std::span<const std::uint8_t> prg_rom;
+    std::span<const std::uint8_t> chr_rom;
+    mutable std::atomic<std::uint64_t> checksum;   //see getChecksum, 0 until something asks for it
+
+    //NES 2.0 rom sizes either count banks, or use exponent-multiplier notation when the msb nibble is 0xf
+    static std::size_t romSize(std::uint8_t lsb, std::uint8_t msb, std::size_t unit){
+        if(msb == 0x0f){
+            std::size_t exponent = lsb >> 2;
+            std::size_t multiplier = (lsb & 0b11) * 2 + 1;
+            //anything past 2^40 can not be a real file anyway
+            return exponent > 40 ? SIZE_MAX : ((std::size_t)1 << exponent) * multiplier;
+        }
+        return ((std::size_t)msb << 8 | lsb) * unit;
+    }
+
+    //NES 2.0 ram sizes are stored as a shift count, 0 means none
+    static std::size_t ramSize(std::uint8_t shift){
+        return shift ? (std::size_t)64 << shift : 0;
+    }
+
+    void close(){
+#ifdef ROM_USE_MMAP
+        if(mapped && data){
+            munmap(const_cast<std::uint8_t*>(data), size);
+        }
+#endif
+        data = nullptr;
+        size = 0;
+        mapped = false;
+        buffer.clear();
+        header = RomHeader();
+        trainer_data = {};
+        prg_rom = {};
+        chr_rom = {};
+        checksum = 0;
+    }
+
+public:
+    Rom(){
+        data = nullptr;
+        size = 0;
+        mapped = false;
+        header = RomHeader();
+        checksum = 0;
+    }
+
+    ~Rom(){
+        close();
+    }
+
+    Rom(const Rom&) = delete;
+    Rom& operator=(const Rom&) = delete;
+
+    //maps the file and parses it, the file stays mapped until the rom is destroyed or reopened
+    RomError open(const std::string& file_name){
+        close();
+#ifdef ROM_USE_MMAP
+        int fd = ::open(file_name.c_str(), O_RDONLY);
+        if(fd < 0){
+            return RomError::CannotOpen;
+        }
+        struct stat info;
+        if(fstat(fd, &info) != 0){
+            ::close(fd);
+            return RomError::CannotOpen;
+        }
+        if((std::size_t)info.st_size < 16){
+            ::close(fd);
+            return RomError::TooSmall;
+        }
+        void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if(mapping == MAP_FAILED){
+            return RomError::CannotMap;
+        }
+        data = static_cast<const std::uint8_t*>(mapping);
+        size = info.st_size;
+        mapped = true;
+#else
+        std::ifstream file(file_name, std::ios_base::binary | std::ios_base::ate);
+        if(!file.is_open()){
+            return RomError::CannotOpen;
+        }
+        std::streamoff file_size = file.tellg();
+        if(file_size < 0){
+            return RomError::CannotOpen;
+        }
+        buffer.resize(file_size);
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(buffer.data()), buffer.size());
+        data = buffer.data();
+        size = buffer.size();
+#endif
+        RomError error = parse();
+        if(error != RomError::None){
+            close();
+        }
+        return error;
+    }
+
+    //parses an image that is already in memory, the caller keeps it alive
+    RomError open(const std::uint8_t* image, std::size_t image_size){
+        close();
+        data = image;
+        size = image_size;
+        RomError error = parse();
+        if(error != RomError::None){
+            close();
+        }
+        return error;
+    }
+
+    //opens a file once for every console that is going to run it, see CPU::load
+    static RomError openShared(const std::string& file_name, std::shared_ptr<const Rom>& out){
+        auto rom = std::make_shared<Rom>();
+        RomError error = rom->open(file_name);
+        if(error == RomError::None){
+            out = std::move(rom);
+        }
+        return error;
+    }
+
+    //same for an image in memory, the caller keeps it alive as long as any console uses it
+    static RomError openShared(const std::uint8_t* image, std::size_t image_size, std::shared_ptr<const Rom>& out){
+        auto rom = std::make_shared<Rom>();
+        RomError error = rom->open(image, image_size);
+        if(error == RomError::None){
+            out = std::move(rom);
+        }
+        return error;
+    }
+
+    RomError parse(){
+        if(size < 16){
+            return RomError::TooSmall;
+        }
+        if(data[0] != 'N' || data[1] != 'E' || data[2] != 'S' || data[3] != 0x1a){
+            return RomError::BadMagic;
+        }
+
+        std::uint8_t flag6 = data[6];
+        std::uint8_t flag7 = data[7];
+
+        header.nes2 = (flag7 & 0b00001100) == 0b00001000;
+        header.battery = flag6 & 0b00000010;
+        header.trainer = flag6 & 0b00000100;
+        if(flag6 & 0b00001000){
+            header.mirroring = Mirroring::FourScreen;
+        }else if(flag6 & 0b00000001){
+            header.mirroring = Mirroring::Vertical;
+        }else{
+            header.mirroring = Mirroring::Horizontal;
+        }
+
+        if(header.nes2){
+            header.mapper = (flag6 >> 4) | (flag7 & 0xf0) | ((data[8] & 0x0f) << 8);
+            header.submapper = data[8] >> 4;
+            header.prg_rom_size = romSize(data[4], data[9] & 0x0f, 16 * 1024);
+            header.chr_rom_size = romSize(data[5], data[9] >> 4, 8 * 1024);
+            header.prg_ram_size = ramSize(data[10] & 0x0f);
+            header.prg_nvram_size = ramSize(data[10] >> 4);
+            header.chr_ram_size = ramSize(data[11] & 0x0f);
+            header.chr_nvram_size = ramSize(data[11] >> 4);
+            header.timing = data[12] & 0b11;
+        }else{
+            //old dumping tools wrote garbage like "DiskDude!" into bytes 7-15, then only the low nibble is trusted
+            bool dirty = data[12] || data[13] || data[14] || data[15];
+            header.mapper = (flag6 >> 4) | (dirty ? 0 : (flag7 & 0xf0));
+            header.submapper = 0;
+            header.prg_rom_size = (std::size_t)data[4] * 16 * 1024;
+            header.chr_rom_size = (std::size_t)data[5] * 8 * 1024;
+            //iNES counts PRG_RAM in 8KB units and 0 still means 8KB
+            std::size_t prg_ram = (dirty || !data[8] ? 1 : data[8]) * 8 * 1024;
+            header.prg_ram_size = header.battery ? 0 : prg_ram;
+            header.prg_nvram_size = header.battery ? prg_ram : 0;
+            header.chr_ram_size = header.chr_rom_size ? 0 : 8 * 1024;
+            header.chr_nvram_size = 0;
+            header.timing = dirty ? 0 : data[9] & 0b1;
+        }
+
+        if(header.prg_rom_size == 0){
+            return RomError::NoPrgRom;
+        }
+        //mappers switch PRG in 8KB and CHR in 1KB units and the bus maps whole pages, exponent
+        //notation can describe sizes like 3 or 384 bytes that would be read past their end
+        if(header.prg_rom_size % (8 * 1024) != 0 || header.chr_rom_size % 1024 != 0){
+            return RomError::BadSize;
+        }
+
+        std::size_t offset = 16;
+        std::size_t trainer_size = header.trainer ? 512 : 0;
+        if(trainer_size > size - offset){
+            return RomError::Truncated;
+        }
+        trainer_data = std::span<const std::uint8_t>(data + offset, trainer_size);
+        offset += trainer_size;
+
+        if(header.prg_rom_size > size - offset){
+            return RomError::Truncated;
+        }
+        prg_rom = std::span<const std::uint8_t>(data + offset, header.prg_rom_size);
+        offset += header.prg_rom_size;
+
+        if(header.chr_rom_size > size - offset){
+            return RomError::Truncated;
+        }
+        chr_rom = std::span<const std::uint8_t>(data + offset, header.chr_rom_size);
+        return RomError::None;
+    }
+
+    const RomHeader& getHeader() const{
+        return header;
+    }
+
+    //fnv-1a over the whole image, tells save states which rom they belong to. it is worked out the
+    //first time it is asked for, so opening only reads the header and leaves the rest of a mapped
+    //file alone. consoles sharing the rom may race on it, they all store the same value
+    std::uint64_t getChecksum() const{
+        std::uint64_t value = checksum.load(std::memory_order_relaxed);
+        if(value == 0 && data){
+            value = 14695981039346656037ull;
+            for(std::size_t i = 0; i < size; i++){
+                value = (value ^ data[i]) * 1099511628211ull;
+            }
+            checksum.store(value, std::memory_order_relaxed);
+        }
+        return value;
+    }
+
+    std::span<const std::uint8_t> getTrainer() const{
+        return trainer_data;
+    }
+
+    std::span<const std::uint8_t> getPrgRom() const{
+        return prg_rom;
+    }
+
+    std::span<const std::uint8_t> getChrRom() const{
+        return chr_rom;
+    }
+
+    //bank number index of the given size, wrapping around like the address lines on a real board
+    std::span<const std::uint8_t> prgBank(std::size_t index, std::size_t bank_size) const{
+        std::size_t count = prg_rom.size() / bank_size;
+        if(count == 0){
+            return prg_rom;
+        }
+        return prg_rom.subspan((index % count) * bank_size, bank_size);
+    }
+
+    std::span<const std::uint8_t> chrBank(std::size_t index, std::size_t bank_size) const{
+        std::size_t count = chr_rom.size() / bank_size;
+        if(count == 0){
+            return chr_rom;
+        }
+        return chr_rom.subspan((index % count) * bank_size, bank_size);
+    }
+};
+
+#endif // ROM_HPP_INCLUDED
@@ -0,0 +1,157 @@
+#ifndef SAVESTATE_HPP_INCLUDED
+#define SAVESTATE_HPP_INCLUDED
+
+#include<cstdint>
+#include<cstddef>
+#include<cstring>
+#include<type_traits>
+#include<vector>
+
+#define STATE_MAGIC 0x5353454e      //"NESS" in a little endian dump
+#define STATE_VERSION 3             //bump whenever anything saved changes size or order
+#define STATE_PAGE_SIZE 256         //granularity of snapshots, memory behind bus pages is saved aligned to it
+
+enum class StateError {
+    None,
+    TooSmall,           //shorter than the header
+    BadMagic,           //not a save state
+    BadVersion,         //written by a different STATE_VERSION
+    WrongRom,           //saved with another cartridge, or without one
+    BadSize             //length does not match what this rom's state takes
+};
+
+inline const char* stateErrorString(StateError error){
+    switch(error){
+        case StateError::None: return "no error";
+        case StateError::TooSmall: return "state is smaller than its header";
+        case StateError::BadMagic: return "not a save state";
+        case StateError::BadVersion: return "save state is from another version";
+        case StateError::WrongRom: return "save state belongs to another rom";
+        case StateError::BadSize: return "save state has the wrong size";
+    }
+    return "unknown error";
+}
+
+//first bytes of every state, checked before anything is loaded
+struct StateHeader {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint64_t size;         //whole state, header included
+    std::uint64_t rom;          //Rom::getChecksum of the cartridge, 0 without one
+};
+
+//memory behind bus pages inside a state, lets a snapshot use the bus write counters
+//to find the pages that did not change instead of comparing them
+struct TrackedRegion {
+    std::size_t offset;         //in the state, a multiple of STATE_PAGE_SIZE
+    std::size_t size;
+    std::uint8_t first_page;    //bus page of the first byte
+};
+
+//states are the raw bytes of every field in a fixed order, copied with memcpy and no stream
+//in between. layouts follow the host, a state is meant for the same build on the same machine
+class StateWriter {
+private:
+    std::vector<std::uint8_t>& out;
+    std::size_t used;
+    std::vector<TrackedRegion>* regions;    //null when nobody asked for them
+
+public:
+    //out is overwritten, its old size is kept as room so writing into a reused vector never allocates
+    StateWriter(std::vector<std::uint8_t>& out, std::vector<TrackedRegion>* regions = nullptr) : out(out), regions(regions){
+        used = 0;
+        if(regions){
+            regions->clear();
+        }
+    }
+
+    void bytes(const void* data, std::size_t size){
+        if(used + size > out.size()){
+            out.resize(used + size > 2 * out.size() ? used + size : 2 * out.size());
+        }
+        std::memcpy(out.data() + used, data, size);
+        used += size;
+    }
+
+    template<typename T>
+    void put(const T& value){
+        static_assert(std::is_trivially_copyable_v<T>, "only plain data goes into a state");
+        bytes(&value, sizeof(T));
+    }
+
+    //pads with zeros up to the next page
+    void align(){
+        static const std::uint8_t zeros[STATE_PAGE_SIZE] = {};
+        bytes(zeros, (STATE_PAGE_SIZE - used % STATE_PAGE_SIZE) % STATE_PAGE_SIZE);
+    }
+
+    //writes memory that sits behind bus pages first_page and up, page aligned
+    void tracked(const void* data, std::size_t size, std::uint8_t first_page){
+        align();
+        if(regions){
+            regions->push_back({used, size, first_page});
+        }
+        bytes(data, size);
+    }
+
+    std::size_t size() const{
+        return used;
+    }
+
+    //cuts the vector down to what was written and returns the start, to patch the header in
+    std::uint8_t* finish(){
+        out.resize(used);
+        return out.data();
+    }
+};
+
+//reads the fields back in the order they were written, the caller checks the size up front
+class StateReader {
+private:
+    const std::uint8_t* data;
+    std::size_t size;
+    std::size_t used;
+
+public:
+    StateReader(const std::uint8_t* data, std::size_t size) : data(data), size(size){
+        used = 0;
+    }
+
+    void bytes(void* out, std::size_t count){
+        if(used + count > size){
+            //can only happen on a damaged state, leave the rest alone
+            used = size;
+            return;
+        }
+        std::memcpy(out, data + used, count);
+        used += count;
+    }
+
+    template<typename T>
+    void get(T& value){
+        static_assert(std::is_trivially_copyable_v<T>, "only plain data comes out of a state");
+        bytes(&value, sizeof(T));
+    }
+
+    //skips the padding StateWriter::align left
+    void align(){
+        std::size_t padding = (STATE_PAGE_SIZE - used % STATE_PAGE_SIZE) % STATE_PAGE_SIZE;
+        used = used + padding > size ? size : used + padding;
+    }
+
+    //like bytes, but returns whether memory actually changed so caches over it can stay when it did not
+    bool update(void* memory, std::size_t count){
+        if(used + count > size){
+            used = size;
+            return false;
+        }
+        bool changed = std::memcmp(memory, data + used, count) != 0;
+        if(changed){
+            std::memcpy(memory, data + used, count);
+        }
+        used += count;
+        return changed;
+    }
+};
+
+#endif // SAVESTATE_HPP_INCLUDED
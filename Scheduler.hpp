@@ -0,0 +1,132 @@
+#ifndef SCHEDULER_HPP_INCLUDED
+#define SCHEDULER_HPP_INCLUDED
+
+#include<cassert>
+#include<cstdint>
+
+//devices the cpu loop keeps a timed event for
+enum class EventType : std::uint8_t {
+    Ppu,        //vblank and its nmi, scanline counters on the cartridge
+    Apu,        //frame counter steps and their irq, dmc fetches and the dmc irq
+    Count
+};
+
+#define EVENT_COUNT static_cast<int>(EventType::Count)
+
+//priority queue of timed events keyed on the cpu cycle counter
+//every device has at most one pending event, the first cycle where it does something the cpu
+//could notice. devices are run when their event comes up or right before the cpu touches one
+//of their registers, whatever they do in between is caught up in one go
+class Scheduler {
+private:
+    struct Event {
+        std::uint64_t cycle;
+        EventType type;
+    };
+
+    Event heap[EVENT_COUNT];    //binary min heap on cycle
+    int slot[EVENT_COUNT];      //where each type sits in the heap, -1 when not scheduled
+    int size;
+
+    void place(int index, const Event& event){
+        heap[index] = event;
+        slot[static_cast<int>(event.type)] = index;
+    }
+
+    void siftUp(int index){
+        Event event = heap[index];
+        while(index > 0){
+            int parent = (index - 1) / 2;
+            if(heap[parent].cycle <= event.cycle){
+                break;
+            }
+            place(index, heap[parent]);
+            index = parent;
+        }
+        place(index, event);
+    }
+
+    void siftDown(int index){
+        Event event = heap[index];
+        while(true){
+            int child = index * 2 + 1;
+            if(child >= size){
+                break;
+            }
+            if(child + 1 < size && heap[child + 1].cycle < heap[child].cycle){
+                child++;
+            }
+            if(event.cycle <= heap[child].cycle){
+                break;
+            }
+            place(index, heap[child]);
+            index = child;
+        }
+        place(index, event);
+    }
+
+    //a type sits in the heap at most once, so size never passes EVENT_COUNT. debug builds assert
+    //it, release builds hand it to the optimizer, which cannot bound the heap indexes by itself
+    void checkSize() const{
+        assert(size <= EVENT_COUNT);
+        if(size > EVENT_COUNT){
+            __builtin_unreachable();
+        }
+    }
+
+    void removeAt(int index){
+        checkSize();
+        slot[static_cast<int>(heap[index].type)] = -1;
+        size--;
+        if(index < size){
+            place(index, heap[size]);
+            siftUp(index);
+            siftDown(slot[static_cast<int>(heap[size].type)]);
+        }
+    }
+
+public:
+    Scheduler(){
+        clear();
+    }
+
+    void clear(){
+        size = 0;
+        for(int i = 0; i < EVENT_COUNT; i++){
+            slot[i] = -1;
+        }
+    }
+
+    //sets when the device's event fires, replacing the one it had
+    void schedule(EventType type, std::uint64_t cycle){
+        int index = slot[static_cast<int>(type)];
+        if(index < 0){
+            index = size++;
+            checkSize();
+        }
+        place(index, {cycle, type});
+        siftUp(index);
+        siftDown(slot[static_cast<int>(type)]);
+    }
+
+    void cancel(EventType type){
+        int index = slot[static_cast<int>(type)];
+        if(index >= 0){
+            removeAt(index);
+        }
+    }
+
+    //cycle of the earliest event, UINT64_MAX when nothing is scheduled
+    std::uint64_t nextCycle() const{
+        return size > 0 ? heap[0].cycle : UINT64_MAX;
+    }
+
+    //takes the earliest event off the queue, only valid when one is scheduled
+    EventType pop(){
+        EventType type = heap[0].type;
+        removeAt(0);
+        return type;
+    }
+};
+
+#endif // SCHEDULER_HPP_INCLUDED
@@ -0,0 +1,105 @@
+#ifndef SNAPSHOT_HPP_INCLUDED
+#define SNAPSHOT_HPP_INCLUDED
+
+#include<array>
+#include<cstdint>
+#include<cstddef>
+#include<cstring>
+#include<memory>
+#include<vector>
+#include"Bus.hpp"
+#include"SaveState.hpp"
+
+//one page of a state, shared by every snapshot that has the same bytes there
+typedef std::shared_ptr<const std::array<std::uint8_t, STATE_PAGE_SIZE>> SnapshotPage;
+
+//copy on write save state
+//the state is cut into STATE_PAGE_SIZE pages and a snapshot taken against a parent only
+//allocates the pages that differ from it, the rest are shared. pages of memory behind the bus
+//are known to be unchanged when the bus write counter has not moved since the parent, without
+//looking at them, everything else is compared. a chain of snapshots one frame apart costs about
+//the ram a game touches per frame plus the registers, not a full state each
+class Snapshot {
+private:
+    static constexpr std::uint64_t UNTRACKED = UINT64_MAX;
+
+    std::vector<SnapshotPage> pages;
+    std::vector<std::uint64_t> versions;    //bus write counter behind each page, UNTRACKED for the rest
+    const Bus* owner;                       //counters only mean something on the bus they came from
+    std::size_t size;                       //bytes of the state
+    std::size_t fresh;                      //pages this snapshot allocated instead of sharing
+
+public:
+    Snapshot(){
+        owner = nullptr;
+        size = 0;
+        fresh = 0;
+    }
+
+    //cuts a state written with regions into pages, sharing what parent already has
+    void capture(const std::uint8_t* state, std::size_t state_size, const std::vector<TrackedRegion>& regions,
+                 const Bus& bus, const Snapshot* parent){
+        std::size_t count = (state_size + STATE_PAGE_SIZE - 1) / STATE_PAGE_SIZE;
+        pages.resize(count);
+        versions.assign(count, UNTRACKED);
+        for(const TrackedRegion& region : regions){
+            std::size_t first = region.offset / STATE_PAGE_SIZE;
+            std::size_t tracked = region.size / STATE_PAGE_SIZE;
+            for(std::size_t i = 0; i < tracked && region.first_page + i < PAGE_COUNT; i++){
+                versions[first + i] = *bus.getPageVersion(region.first_page + i);
+            }
+        }
+        if(parent && (parent->owner != &bus || parent->size != state_size)){
+            parent = nullptr;
+        }
+
+        owner = &bus;
+        size = state_size;
+        fresh = 0;
+        for(std::size_t i = 0; i < count; i++){
+            const std::uint8_t* bytes = state + i * STATE_PAGE_SIZE;
+            std::size_t length = i + 1 < count ? STATE_PAGE_SIZE : state_size - i * STATE_PAGE_SIZE;
+            if(parent){
+                const SnapshotPage& old = parent->pages[i];
+                bool clean = versions[i] != UNTRACKED && versions[i] == parent->versions[i];
+                if(clean || std::memcmp(old->data(), bytes, length) == 0){
+                    pages[i] = old;
+                    continue;
+                }
+            }
+            auto page = std::make_shared<std::array<std::uint8_t, STATE_PAGE_SIZE>>();
+            std::memcpy(page->data(), bytes, length);
+            std::memset(page->data() + length, 0, STATE_PAGE_SIZE - length);
+            pages[i] = std::move(page);
+            fresh++;
+        }
+    }
+
+    //puts the state back together, out keeps its capacity between calls
+    void copyTo(std::vector<std::uint8_t>& out) const{
+        out.resize(size);
+        for(std::size_t i = 0; i < pages.size(); i++){
+            std::size_t length = i + 1 < pages.size() ? STATE_PAGE_SIZE : size - i * STATE_PAGE_SIZE;
+            std::memcpy(out.data() + i * STATE_PAGE_SIZE, pages[i]->data(), length);
+        }
+    }
+
+    bool empty() const{
+        return pages.empty();
+    }
+
+    std::size_t getSize() const{
+        return size;
+    }
+
+    std::size_t getPageCount() const{
+        return pages.size();
+    }
+
+    //pages allocated when it was taken, the rest came from its parent
+    std::size_t getFreshPages() const{
+        return fresh;
+    }
+};
+
+#endif // SNAPSHOT_HPP_INCLUDED
@@ -0,0 +1,144 @@
+#ifndef THREADPOOL_HPP_INCLUDED
+#define THREADPOOL_HPP_INCLUDED
+
+#include<atomic>
+#include<condition_variable>
+#include<cstddef>
+#include<deque>
+#include<functional>
+#include<memory>
+#include<mutex>
+#include<thread>
+#include<vector>
+
+//work stealing thread pool
+//every worker has its own queue and takes work from the back of it, a worker that runs dry
+//takes from the front of the others before going to sleep. tasks are spread over the queues
+//round robin when submitted, so long ones do not pile up behind each other on one thread
+class ThreadPool {
+private:
+    struct Worker {
+        std::mutex lock;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    std::atomic<std::size_t> queued;        //submitted and not taken yet
+    std::size_t running;                    //submitted and not finished yet, under idle_lock
+    std::size_t next;                       //queue the next submit goes to
+    bool stopping;
+    std::mutex idle_lock;
+    std::condition_variable wake;           //there is work, or the pool is going away
+    std::condition_variable done;           //running reached 0
+
+    bool take(std::size_t self, std::function<void()>& task){
+        {
+            Worker& own = *workers[self];
+            std::lock_guard<std::mutex> guard(own.lock);
+            if(!own.tasks.empty()){
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for(std::size_t i = 1; i < workers.size(); i++){
+            Worker& victim = *workers[(self + i) % workers.size()];
+            std::lock_guard<std::mutex> guard(victim.lock);
+            if(!victim.tasks.empty()){
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void work(std::size_t self){
+        std::function<void()> task;
+        while(true){
+            if(take(self, task)){
+                queued--;
+                task();
+                task = nullptr;
+                std::lock_guard<std::mutex> guard(idle_lock);
+                if(--running == 0){
+                    done.notify_all();
+                }
+                continue;
+            }
+            std::unique_lock<std::mutex> guard(idle_lock);
+            wake.wait(guard, [this]{ return stopping || queued > 0; });
+            if(stopping && queued == 0){
+                return;
+            }
+        }
+    }
+
+public:
+    //0 threads means one per hardware thread
+    explicit ThreadPool(std::size_t count = 0) : queued(0){
+        if(count == 0){
+            count = std::thread::hardware_concurrency();
+        }
+        if(count == 0){
+            count = 1;
+        }
+        running = 0;
+        next = 0;
+        stopping = false;
+        for(std::size_t i = 0; i < count; i++){
+            workers.push_back(std::make_unique<Worker>());
+        }
+        for(std::size_t i = 0; i < count; i++){
+            threads.emplace_back(&ThreadPool::work, this, i);
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    //finishes everything submitted before the threads go away
+    ~ThreadPool(){
+        {
+            std::lock_guard<std::mutex> guard(idle_lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for(std::thread& thread : threads){
+            thread.join();
+        }
+    }
+
+    void submit(std::function<void()> task){
+        std::size_t target;
+        {
+            std::lock_guard<std::mutex> guard(idle_lock);
+            running++;
+            target = next;
+            next = (next + 1) % workers.size();
+        }
+        {
+            std::lock_guard<std::mutex> guard(workers[target]->lock);
+            workers[target]->tasks.push_back(std::move(task));
+        }
+        {
+            //bumped under idle_lock so a worker about to sleep cannot miss it
+            std::lock_guard<std::mutex> guard(idle_lock);
+            queued++;
+        }
+        wake.notify_one();
+    }
+
+    //blocks until every submitted task has returned
+    void wait(){
+        std::unique_lock<std::mutex> guard(idle_lock);
+        done.wait(guard, [this]{ return running == 0; });
+    }
+
+    std::size_t size() const{
+        return threads.size();
+    }
+};
+
+#endif // THREADPOOL_HPP_INCLUDED
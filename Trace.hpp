@@ -0,0 +1,134 @@
+#ifndef TRACE_HPP_INCLUDED
+#define TRACE_HPP_INCLUDED
+
+#include<cstdint>
+#include<cstddef>
+#include<fstream>
+#include<string>
+#include<vector>
+
+#define TRACE_MAGIC 0x4352544e      //"NTRC" in a little endian dump
+#define TRACE_VERSION 1
+
+//what a record is about
+#define TRACE_INSTRUCTION 0         //about to run the instruction at adress
+#define TRACE_READ 1                //the instruction before read value from adress
+#define TRACE_WRITE 2               //the instruction before wrote value to adress over old
+#define TRACE_INTERRUPT 3           //nmi or irq taken through the vector at adress
+
+//one fixed size record, instruction records have the cpu as it was before the instruction,
+//memory records follow the instruction that made them
+struct TraceRecord {
+    std::uint64_t cycle;            //cpu cycles since power on
+    std::uint16_t adress;           //pc, or the adress read or written
+    std::uint8_t kind;              //TRACE_*
+    std::uint8_t bytes[3];          //op code and operands, or value and old value for memory
+    std::uint8_t a;
+    std::uint8_t x;
+    std::uint8_t y;
+    std::uint8_t p;
+    std::uint8_t sp;
+    std::uint8_t unused[3];         //keeps records 24 bytes, always 0
+};
+
+static_assert(sizeof(TraceRecord) == 24, "trace files store records as they are in memory");
+
+//what a trace file starts with, the records follow oldest first
+struct TraceFileHeader {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t record_size;
+    std::uint32_t unused;
+    std::uint64_t count;
+};
+
+//the last records of a run, older ones are overwritten once it is full
+//pushing is a store and an increment, so tracing can stay on for long runs
+class TraceBuffer {
+private:
+    std::vector<TraceRecord> records;
+    std::size_t mask;
+    std::uint64_t written;          //records pushed since the last clear, kept or not
+
+public:
+    //capacity is rounded up to a power of two
+    explicit TraceBuffer(std::size_t capacity){
+        std::size_t size = 1;
+        while(size < capacity){
+            size <<= 1;
+        }
+        records.resize(size);
+        mask = size - 1;
+        written = 0;
+    }
+
+    void push(const TraceRecord& record){
+        records[written & mask] = record;
+        written++;
+    }
+
+    void clear(){
+        written = 0;
+    }
+
+    //records held, at most the capacity
+    std::size_t size() const{
+        return written < records.size() ? written : records.size();
+    }
+
+    std::uint64_t getWritten() const{
+        return written;
+    }
+
+    //the records held, oldest first
+    void copyTo(std::vector<TraceRecord>& out) const{
+        std::size_t count = size();
+        out.resize(count);
+        std::uint64_t first = written - count;
+        for(std::size_t i = 0; i < count; i++){
+            out[i] = records[(first + i) & mask];
+        }
+    }
+
+    //writes the records held to a trace file, false when it could not be written
+    bool dump(const std::string& file_name) const{
+        std::ofstream file(file_name, std::ios_base::binary);
+        if(!file.is_open()){
+            return false;
+        }
+        TraceFileHeader header = {TRACE_MAGIC, TRACE_VERSION, sizeof(TraceRecord), 0, size()};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        std::uint64_t first = written - header.count;
+        for(std::size_t i = 0; i < header.count; i++){
+            file.write(reinterpret_cast<const char*>(&records[(first + i) & mask]), sizeof(TraceRecord));
+        }
+        return file.good();
+    }
+};
+
+//reads a file TraceBuffer::dump wrote, false when it is not one or is cut short
+inline bool loadTrace(const std::string& file_name, std::vector<TraceRecord>& out){
+    std::ifstream file(file_name, std::ios_base::binary);
+    if(!file.is_open()){
+        return false;
+    }
+    TraceFileHeader header;
+    if(!file.read(reinterpret_cast<char*>(&header), sizeof(header))){
+        return false;
+    }
+    if(header.magic != TRACE_MAGIC || header.version != TRACE_VERSION || header.record_size != sizeof(TraceRecord)){
+        return false;
+    }
+    //a damaged count must not turn into a huge allocation
+    std::streamoff start = file.tellg();
+    file.seekg(0, std::ios_base::end);
+    std::uint64_t records = (file.tellg() - start) / sizeof(TraceRecord);
+    file.seekg(start);
+    if(header.count > records){
+        return false;
+    }
+    out.resize(header.count);
+    return (bool)file.read(reinterpret_cast<char*>(out.data()), header.count * sizeof(TraceRecord));
+}
+
+#endif // TRACE_HPP_INCLUDED
@@ -0,0 +1,79 @@
+#ifndef WAVWRITER_HPP_INCLUDED
+#define WAVWRITER_HPP_INCLUDED
+
+#include<cstdint>
+#include<fstream>
+#include<string>
+
+//writes 16 bit mono pcm, the header sizes are filled in on close
+class WavWriter {
+private:
+    std::ofstream file;
+    std::uint32_t sample_rate;
+    std::uint32_t samples;
+
+    void write16(std::uint16_t value){
+        char bytes[2] = {(char)(value & 0xff), (char)(value >> 8)};
+        file.write(bytes, 2);
+    }
+
+    void write32(std::uint32_t value){
+        write16(value & 0xffff);
+        write16(value >> 16);
+    }
+
+    void writeHeader(){
+        file.seekp(0);
+        file.write("RIFF", 4);
+        write32(36 + samples * 2);
+        file.write("WAVE", 4);
+        file.write("fmt ", 4);
+        write32(16);                //fmt chunk size
+        write16(1);                 //pcm
+        write16(1);                 //mono
+        write32(sample_rate);
+        write32(sample_rate * 2);   //bytes per second
+        write16(2);                 //bytes per frame
+        write16(16);                //bits per sample
+        file.write("data", 4);
+        write32(samples * 2);
+    }
+
+public:
+    WavWriter(){
+        sample_rate = 0;
+        samples = 0;
+    }
+
+    ~WavWriter(){
+        close();
+    }
+
+    bool open(const std::string& file_name, std::uint32_t rate){
+        close();
+        file.open(file_name, std::ios_base::binary | std::ios_base::trunc);
+        if(!file.is_open()){
+            return false;
+        }
+        sample_rate = rate;
+        samples = 0;
+        writeHeader();
+        return true;
+    }
+
+    void write(const std::int16_t* data, std::size_t count){
+        for(std::size_t i = 0; i < count; i++){
+            write16((std::uint16_t)data[i]);
+        }
+        samples += count;
+    }
+
+    void close(){
+        if(file.is_open()){
+            writeHeader();
+            file.close();
+        }
+    }
+};
+
+#endif // WAVWRITER_HPP_INCLUDED
@@ -0,0 +1,100 @@
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Batch.hpp"
+
+//nes-batch: runs the same rom and movie on many independent consoles at once and reports
+//how many frames per second all of them together get through
+static void usage(){
+    std::cout<<"usage: nes-batch [-n instances] [-k frames] [-j threads] [-m movie.fm2] [--jit] rom.nes"<<std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    std::size_t instances = 0;
+    std::uint64_t frames = 0;
+    std::size_t threads = 0;
+    std::string movie_file;
+    std::string rom_file;
+    bool jit = false;
+    for(int i = 1; i < argc; i++){
+        bool has_value = i + 1 < argc;
+        if(std::strcmp(argv[i], "-n") == 0 && has_value){
+            instances = std::stoull(argv[++i]);
+        }else if(std::strcmp(argv[i], "-k") == 0 && has_value){
+            frames = std::stoull(argv[++i]);
+        }else if(std::strcmp(argv[i], "-j") == 0 && has_value){
+            threads = std::stoull(argv[++i]);
+        }else if(std::strcmp(argv[i], "-m") == 0 && has_value){
+            movie_file = argv[++i];
+        }else if(std::strcmp(argv[i], "--jit") == 0){
+            jit = true;
+        }else if(argv[i][0] != '-' && rom_file.empty()){
+            rom_file = argv[i];
+        }else{
+            usage();
+            return 1;
+        }
+    }
+    if(rom_file.empty()){
+        usage();
+        return 1;
+    }
+
+    //one read only image for every instance, each one only allocates its own console state
+    std::shared_ptr<const Rom> rom;
+    RomError error = Rom::openShared(rom_file, rom);
+    if(error != RomError::None){
+        std::cout<<"Error: "<<rom_file<<": "<<romErrorString(error)<<std::endl;
+        return 1;
+    }
+
+    std::shared_ptr<Movie> movie;
+    if(!movie_file.empty()){
+        movie = std::make_shared<Movie>();
+        if(!movie->load(movie_file)){
+            std::cout<<"Error: could not read "<<movie_file<<std::endl;
+            return 1;
+        }
+    }
+
+    ThreadPool pool(threads);
+    if(instances == 0){
+        instances = pool.size();
+    }
+    if(frames == 0){
+        //the whole movie, or a minute of play without one
+        frames = movie && movie->size() > 0 ? movie->size() : 3600;
+    }
+    std::vector<BatchJob> jobs(instances, BatchJob{rom, movie, frames, jit, nullptr, false});
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<BatchResult> results = runBatch(jobs, pool);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::uint64_t total_frames = 0;
+    std::uint64_t total_instructions = 0;
+    bool same = true;
+    for(std::size_t i = 0; i < results.size(); i++){
+        const BatchResult& result = results[i];
+        if(result.error != RomError::None){
+            std::cout<<"Error: "<<rom_file<<": "<<romErrorString(result.error)<<std::endl;
+            return 1;
+        }
+        total_frames += result.frames;
+        total_instructions += result.instructions;
+        same = same && result.hash == results[0].hash;
+        if(result.jammed){
+            std::cout<<"instance "<<i<<" jammed after "<<result.frames<<" frames"<<std::endl;
+        }
+    }
+    std::cout<<instances<<" instances x "<<frames<<" frames on "<<pool.size()<<" threads: "
+             <<seconds<<" s, "<<total_frames / seconds<<" frames/s, "
+             <<total_instructions / seconds / 1e6<<" MIPS"<<std::endl;
+    std::cout<<"state hash "<<std::hex<<results[0].hash<<std::dec
+             <<(same ? ", same on every instance" : ", INSTANCES DIFFER")<<std::endl;
+    return same ? 0 : 1;
+}
@@ -0,0 +1,534 @@
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "CPU.hpp"
+#include "PerfCounter.hpp"
+#include "Rewind.hpp"
+#include "Batch.hpp"
+#include "Lanes.hpp"
+
+//tight loop used to measure raw dispatch speed, runs from ram
+//  0x0200  LDX #$00
+//  0x0202  INX
+//  0x0203  ADC #$01
+//  0x0205  STA $10
+//  0x0207  BNE $0202
+//  0x0209  JMP $0200
+static const std::uint8_t program[] = {
+    0xa2, 0x00,
+    0xe8,
+    0x69, 0x01,
+    0x85, 0x10,
+    0xd0, 0xf9,
+    0x4c, 0x00, 0x02
+};
+
+//fills both nametables with tiles 0-255, loads the palette, points every sprite somewhere and turns rendering on
+static const std::uint8_t ppu_program[] = {
+    0xa9, 0x20, 0x8d, 0x06, 0x20,   //LDA #$20, STA $2006
+    0xa9, 0x00, 0x8d, 0x06, 0x20,   //LDA #$00, STA $2006
+    0xa0, 0x08,                     //LDY #$08
+    0xa2, 0x00,                     //LDX #$00
+    0x8e, 0x07, 0x20,               //STX $2007
+    0xe8,                           //INX
+    0xd0, 0xfa,                     //BNE -6
+    0x88,                           //DEY
+    0xd0, 0xf7,                     //BNE -9
+    0xa9, 0x3f, 0x8d, 0x06, 0x20,   //LDA #$3f, STA $2006
+    0xa9, 0x00, 0x8d, 0x06, 0x20,   //LDA #$00, STA $2006
+    0xa2, 0x00,                     //LDX #$00
+    0x8e, 0x07, 0x20,               //STX $2007
+    0xe8,                           //INX
+    0xe0, 0x20,                     //CPX #$20
+    0xd0, 0xf8,                     //BNE -8
+    0xa2, 0x00,                     //LDX #$00
+    0x8a,                           //TXA
+    0x9d, 0x00, 0x02,               //STA $0200,X
+    0xe8,                           //INX
+    0xd0, 0xf9,                     //BNE -7
+    0xa9, 0x02, 0x8d, 0x14, 0x40,   //LDA #$02, STA $4014
+    0xa9, 0x1e, 0x8d, 0x01, 0x20,   //LDA #$1e, STA $2001
+    0xa9, 0x00, 0x8d, 0x05, 0x20,   //LDA #$00, STA $2005
+    0x8d, 0x05, 0x20,               //STA $2005
+    0x4c, 0x46, 0x80                //JMP $8046
+};
+
+static void benchCpu(std::uint64_t instructions){
+    CPU* cpu = new CPU();
+    cpu->loadProgram(program, sizeof(program), 0x0200);
+
+    RunSummary summary = cpu->runHeadless(UINT64_MAX, instructions);
+
+    std::cout<<"instructions: "<<summary.instructions<<std::endl;
+    std::cout<<"seconds: "<<summary.seconds<<std::endl;
+    std::cout<<"instructions/sec: "<<(std::uint64_t)(summary.instructions / summary.seconds)<<std::endl;
+    std::cout<<"MIPS: "<<summary.mips<<std::endl;
+    std::cout<<"cycles: "<<summary.cycles<<std::endl;
+    std::cout<<"emulated MHz: "<<summary.cycles / summary.seconds / 1e6<<std::endl;
+
+    delete cpu;
+}
+
+//NROM image, 16KB PRG with ppu_program at 0x8000 and 8KB of pseudo random CHR
+static std::vector<std::uint8_t> makePpuImage(){
+    std::vector<std::uint8_t> image(16 + 16 * KB + 8 * KB, 0);
+    const std::uint8_t header[] = {'N', 'E', 'S', 0x1a, 1, 1};
+    std::copy(header, header + sizeof(header), image.begin());
+    std::copy(ppu_program, ppu_program + sizeof(ppu_program), image.begin() + 16);
+    image[16 + 0x3ffc] = 0x00;
+    image[16 + 0x3ffd] = 0x80;
+    std::uint32_t seed = 12345;
+    for(std::size_t i = 16 + 16 * KB; i < image.size(); i++){
+        seed = seed * 1103515245 + 12345;
+        image[i] = seed >> 16;
+    }
+    return image;
+}
+
+//build with -DPPU_NAIVE_FETCH to compare against per pixel pattern decoding
+static void benchPpu(std::uint64_t frames){
+    std::vector<std::uint8_t> image = makePpuImage();
+
+    CPU* cpu = new CPU();
+    RomError error = cpu->load(image.data(), image.size());
+    if(error != RomError::None){
+        std::cout<<romErrorString(error)<<std::endl;
+        delete cpu;
+        return;
+    }
+
+    RunSummary summary = cpu->runFrames(frames);
+    double pixels = (double)summary.frames * SCREEN_WIDTH * SCREEN_HEIGHT;
+
+    std::cout<<"frames: "<<summary.frames<<std::endl;
+    std::cout<<"seconds: "<<summary.seconds<<std::endl;
+    std::cout<<"frames/sec: "<<summary.frames / summary.seconds<<std::endl;
+    std::cout<<"pixels/sec: "<<(std::uint64_t)(pixels / summary.seconds)<<std::endl;
+
+    delete cpu;
+}
+
+//build with -DAPU_NAIVE_MIX to compare against clocking every channel every cycle
+static void benchApu(std::uint64_t seconds){
+    Bus* bus = new Bus();
+    APU* apu = new APU(*bus);
+    //every channel playing, with the length counters halted so they keep going
+    const std::uint16_t registers[][2] = {
+        {0x4015, 0x0f},
+        {0x4000, 0xbf}, {0x4002, 0xfd}, {0x4003, 0x00},    //pulse 1, 440Hz
+        {0x4004, 0x7f}, {0x4006, 0x7e}, {0x4007, 0x00},    //pulse 2, 880Hz
+        {0x4008, 0xff}, {0x400a, 0xfd}, {0x400b, 0x00},    //triangle, 220Hz
+        {0x400c, 0x38}, {0x400e, 0x08}, {0x400f, 0x00}     //noise
+    };
+    for(auto& reg : registers){
+        apu->writeRegister(reg[0], reg[1]);
+    }
+
+    std::int16_t out[4096];
+    std::uint64_t samples = 0;
+    std::uint64_t end = seconds * CPU_CLOCK;
+    auto start = std::chrono::steady_clock::now();
+    //run in instruction sized steps like the cpu loop does, draining once per frame
+    for(std::uint64_t cycle = 0; cycle < end; cycle += 3){
+        apu->run(cycle);
+        if(cycle % 29781 < 3){
+            samples += apu->getSamples().pop(out, 4096);
+        }
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    samples += apu->getSamples().pop(out, 4096);
+
+    std::cout<<"emulated seconds: "<<seconds<<std::endl;
+    std::cout<<"seconds: "<<elapsed<<std::endl;
+    std::cout<<"ms per emulated second: "<<elapsed * 1000 / seconds<<std::endl;
+    std::cout<<"samples: "<<samples<<" at "<<apu->getSampleRate()<<"Hz"<<std::endl;
+    std::cout<<"dropped: "<<apu->getDroppedSamples()<<std::endl;
+
+    delete apu;
+    delete bus;
+}
+
+//save plus restore in a loop, the way search tools rewind to a position over and over
+static void benchState(std::uint64_t count){
+    std::vector<std::uint8_t> image = makePpuImage();
+    CPU* cpu = new CPU();
+    cpu->load(image.data(), image.size());
+    cpu->runFrames(30);
+
+    std::vector<std::uint8_t> state;
+    auto start = std::chrono::steady_clock::now();
+    for(std::uint64_t i = 0; i < count; i++){
+        cpu->saveState(state);
+        StateError error = cpu->loadState(state);
+        if(error != StateError::None){
+            std::cout<<stateErrorString(error)<<std::endl;
+            break;
+        }
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout<<"state bytes: "<<state.size()<<std::endl;
+    std::cout<<"seconds: "<<elapsed<<std::endl;
+    std::cout<<"us per save + restore: "<<elapsed * 1e6 / count<<std::endl;
+
+    delete cpu;
+}
+
+//a snapshot every frame into a rewind buffer, reports what a frame of history costs
+static void benchRewind(std::uint64_t frames){
+    std::vector<std::uint8_t> image = makePpuImage();
+    CPU* cpu = new CPU();
+    cpu->load(image.data(), image.size());
+    RewindBuffer history(frames / (double)REWIND_FRAME_RATE, SIZE_MAX);
+
+    double pushing = 0;
+    for(std::uint64_t i = 0; i < frames; i++){
+        cpu->runFrames(1);
+        auto start = std::chrono::steady_clock::now();
+        history.push(*cpu);
+        pushing += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    std::vector<std::uint8_t> state;
+    cpu->saveState(state);
+
+    std::cout<<"frames held: "<<history.size()<<std::endl;
+    std::cout<<"bytes held: "<<history.getMemoryUsed()<<std::endl;
+    std::cout<<"bytes per frame: "<<history.getMemoryUsed() / history.size()<<" (full state "<<state.size()<<")"<<std::endl;
+    std::cout<<"us per snapshot: "<<pushing * 1e6 / frames<<std::endl;
+
+    delete cpu;
+}
+
+//runs both test programs through the interpreter and through the recompiler, the results
+//have to match exactly before the speeds mean anything
+static bool benchJit(std::uint64_t instructions){
+    if(!CPU::jitAvailable()){
+        std::cout<<"recompiler not available on this host"<<std::endl;
+        return false;
+    }
+    std::vector<std::uint8_t> image = makePpuImage();
+    bool same = true;
+    for(int test = 0; test < 2; test++){
+        std::uint64_t hashes[2];
+        double mips[2];
+        for(int jit = 0; jit < 2; jit++){
+            CPU* cpu = new CPU();
+            if(test == 0){
+                cpu->loadProgram(program, sizeof(program), 0x0200);
+            }else{
+                cpu->load(image.data(), image.size());
+            }
+            if(!cpu->setJit(jit == 1)){
+                std::cout<<"no executable memory for the recompiler"<<std::endl;
+                delete cpu;
+                return false;
+            }
+            RunSummary summary = cpu->runHeadless(UINT64_MAX, instructions);
+            hashes[jit] = consoleHash(*cpu);
+            mips[jit] = summary.mips;
+            delete cpu;
+        }
+        std::cout<<(test == 0 ? "cpu loop" : "ppu rom")<<": interpreter "<<mips[0]<<" MIPS, recompiler "
+                 <<mips[1]<<" MIPS, "<<(hashes[0] == hashes[1] ? "same state" : "STATE DIFFERS")<<std::endl;
+        same = same && hashes[0] == hashes[1];
+    }
+    return same;
+}
+
+//synthetic workloads for the suite, each one loops forever from 0x0200 in ram
+//alu: a chain of arithmetic and logic on the accumulator
+//  0x0200  LDX #$00
+//  0x0202  TXA
+//  0x0203  EOR $10
+//  0x0205  ADC #$37
+//  0x0207  ASL A
+//  0x0208  ORA #$01
+//  0x020a  AND #$f7
+//  0x020c  STA $10
+//  0x020e  ROR A
+//  0x020f  SBC $12
+//  0x0211  DEX
+//  0x0212  BNE $0202
+//  0x0214  JMP $0200
+static const std::uint8_t alu_program[] = {
+    0xa2, 0x00, 0x8a, 0x45, 0x10, 0x69, 0x37, 0x0a, 0x09, 0x01, 0x29, 0xf7,
+    0x85, 0x10, 0x6a, 0xe5, 0x12, 0xca, 0xd0, 0xee, 0x4c, 0x00, 0x02
+};
+
+//copy_indexed: two 256 byte copies, the first one crosses a page half of the time
+//  0x0200  LDX #$00
+//  0x0202  LDA $0380,X
+//  0x0205  STA $0500,X
+//  0x0208  INX
+//  0x0209  BNE $0202
+//  0x020b  LDY #$00
+//  0x020d  LDA $0500,Y
+//  0x0210  STA $0600,Y
+//  0x0213  INY
+//  0x0214  BNE $020d
+//  0x0216  JMP $0200
+static const std::uint8_t copy_indexed_program[] = {
+    0xa2, 0x00, 0xbd, 0x80, 0x03, 0x9d, 0x00, 0x05, 0xe8, 0xd0, 0xf7,
+    0xa0, 0x00, 0xb9, 0x00, 0x05, 0x99, 0x00, 0x06, 0xc8, 0xd0, 0xf7,
+    0x4c, 0x00, 0x02
+};
+
+//copy_indirect: a 256 byte copy through zero page pointers, then one byte through (zp,X)
+//  0x0200  LDA #$00, STA $20, STA $22      pointers to 0x0300 and 0x0600
+//  0x0206  LDA #$03, STA $21
+//  0x020a  LDA #$06, STA $23
+//  0x020e  LDY #$00
+//  0x0210  LDA ($20),Y
+//  0x0212  STA ($22),Y
+//  0x0214  INY
+//  0x0215  BNE $0210
+//  0x0217  LDX #$20
+//  0x0219  LDA ($00,X)
+//  0x021b  LDX #$22
+//  0x021d  STA ($00,X)
+//  0x021f  JMP $020e
+static const std::uint8_t copy_indirect_program[] = {
+    0xa9, 0x00, 0x85, 0x20, 0x85, 0x22, 0xa9, 0x03, 0x85, 0x21, 0xa9, 0x06, 0x85, 0x23,
+    0xa0, 0x00, 0xb1, 0x20, 0x91, 0x22, 0xc8, 0xd0, 0xf9,
+    0xa2, 0x20, 0xa1, 0x00, 0xa2, 0x22, 0x81, 0x00, 0x4c, 0x0e, 0x02
+};
+
+//branches: every branch depends on an 8 bit lfsr, so the host predictor gets little help
+//  0x0200  LDA #$01, STA $10
+//  0x0204  LDA $10
+//  0x0206  ASL A
+//  0x0207  BCC $020b
+//  0x0209  EOR #$1d
+//  0x020b  STA $10
+//  0x020d  BMI $0212
+//  0x020f  INX
+//  0x0210  BNE $0213
+//  0x0212  DEY
+//  0x0213  CPX #$80
+//  0x0215  BCS $021b
+//  0x0217  AND #$03
+//  0x0219  BEQ $021d
+//  0x021b  LDX #$00
+//  0x021d  JMP $0204
+static const std::uint8_t branch_program[] = {
+    0xa9, 0x01, 0x85, 0x10, 0xa5, 0x10, 0x0a, 0x90, 0x02, 0x49, 0x1d, 0x85, 0x10,
+    0x30, 0x03, 0xe8, 0xd0, 0x01, 0x88, 0xe0, 0x80, 0xb0, 0x04, 0x29, 0x03, 0xf0, 0x02,
+    0xa2, 0x00, 0x4c, 0x04, 0x02
+};
+
+//stack: nested subroutine calls that save and restore registers
+//  0x0200  LDX #$00
+//  0x0202  JSR $0210
+//  0x0205  INX
+//  0x0206  BNE $0202
+//  0x0208  JMP $0200
+//  0x0210  PHA, PHP
+//  0x0212  JSR $0218
+//  0x0215  PLP, PLA, RTS
+//  0x0218  TXA, PHA, PLA, RTS
+static const std::uint8_t stack_program[] = {
+    0xa2, 0x00, 0x20, 0x10, 0x02, 0xe8, 0xd0, 0xfa, 0x4c, 0x00, 0x02,
+    0xea, 0xea, 0xea, 0xea, 0xea,
+    0x48, 0x08, 0x20, 0x18, 0x02, 0x28, 0x68, 0x60,
+    0x8a, 0x48, 0x68, 0x60
+};
+
+struct Workload {
+    const char* name;
+    const std::uint8_t* program;
+    std::size_t size;
+};
+
+static const Workload workloads[] = {
+    {"dispatch", program, sizeof(program)},
+    {"alu", alu_program, sizeof(alu_program)},
+    {"copy_indexed", copy_indexed_program, sizeof(copy_indexed_program)},
+    {"copy_indirect", copy_indirect_program, sizeof(copy_indirect_program)},
+    {"branches", branch_program, sizeof(branch_program)},
+    {"stack", stack_program, sizeof(stack_program)}
+};
+
+//one run of a workload, host counts are 0 when the counters are unavailable
+struct SuiteRun {
+    RunSummary summary;
+    std::uint64_t host_instructions;
+    std::uint64_t host_cycles;
+    std::uint64_t branch_misses;
+    std::uint64_t hash;
+};
+
+static SuiteRun runWorkload(const Workload& workload, std::uint64_t cycles, bool jit,
+                            PerfCounter& instructions, PerfCounter& host_cycles, PerfCounter& branch_misses){
+    CPU* cpu = new CPU();
+    cpu->loadProgram(workload.program, workload.size, 0x0200);
+    cpu->setJit(jit);
+    SuiteRun run;
+    instructions.start();
+    host_cycles.start();
+    branch_misses.start();
+    run.summary = cpu->runHeadless(cycles);
+    run.branch_misses = branch_misses.stop();
+    run.host_cycles = host_cycles.stop();
+    run.host_instructions = instructions.stop();
+    run.hash = consoleHash(*cpu);
+    delete cpu;
+    return run;
+}
+
+static void printCount(const char* name, bool available, double value, const char* end){
+    if(available){
+        std::printf("      \"%s\": %.3f%s\n", name, value, end);
+    }else{
+        std::printf("      \"%s\": null%s\n", name, end);
+    }
+}
+
+//every workload for a fixed number of emulated cycles through the interpreter and, where there
+//is one, the recompiler, repeated and the median run kept. prints json on stdout so runs can be
+//compared over time, host counts are null where perf events can not be opened
+static bool benchSuite(std::uint64_t cycles, int repeats){
+    PerfCounter instructions(PerfEvent::Instructions);
+    PerfCounter host_cycles(PerfEvent::Cycles);
+    PerfCounter branch_misses(PerfEvent::BranchMisses);
+    bool counters = instructions.available();
+    repeats = std::max(repeats, 1);
+
+    std::printf("{\n");
+    std::printf("  \"bench\": \"cpu-suite\",\n");
+    std::printf("  \"cycles\": %llu,\n", (unsigned long long)cycles);
+    std::printf("  \"repeats\": %d,\n", repeats);
+    std::printf("  \"build\": {\"lazy_flags\": %s, \"block_cache\": %s, \"trace\": %s, \"jit\": %s},\n",
+#ifdef CPU_LAZY_FLAGS
+                "true",
+#else
+                "false",
+#endif
+#ifdef CPU_NO_BLOCK_CACHE
+                "false",
+#else
+                "true",
+#endif
+#ifdef CPU_NO_TRACE
+                "false",
+#else
+                "true",
+#endif
+                CPU::jitAvailable() ? "true" : "false");
+    std::printf("  \"perf_counters\": %s,\n", counters ? "true" : "false");
+    std::printf("  \"results\": [");
+
+    bool ok = true;
+    bool first = true;
+    for(int engine = 0; engine < (CPU::jitAvailable() ? 2 : 1); engine++){
+        for(const Workload& workload : workloads){
+            std::vector<SuiteRun> runs;
+            for(int i = 0; i < repeats; i++){
+                runs.push_back(runWorkload(workload, cycles, engine == 1, instructions, host_cycles, branch_misses));
+            }
+            std::sort(runs.begin(), runs.end(), [](const SuiteRun& a, const SuiteRun& b){
+                return a.summary.seconds < b.summary.seconds;
+            });
+            const SuiteRun& run = runs[runs.size() / 2];
+            const RunSummary& summary = run.summary;
+            ok = ok && !summary.jammed;
+            double emulated = (double)summary.instructions;
+
+            std::printf("%s\n    {\n", first ? "" : ",");
+            first = false;
+            std::printf("      \"workload\": \"%s\",\n", workload.name);
+            std::printf("      \"engine\": \"%s\",\n", engine == 1 ? "recompiler" : "interpreter");
+            std::printf("      \"instructions\": %llu,\n", (unsigned long long)summary.instructions);
+            std::printf("      \"cycles\": %llu,\n", (unsigned long long)summary.cycles);
+            std::printf("      \"seconds\": %.6f,\n", summary.seconds);
+            std::printf("      \"emulated_mhz\": %.3f,\n", summary.cycles / summary.seconds / 1e6);
+            std::printf("      \"mips\": %.3f,\n", summary.mips);
+            std::printf("      \"ns_per_instruction\": %.3f,\n", summary.seconds * 1e9 / emulated);
+            printCount("host_instructions_per_instruction", counters, run.host_instructions / emulated, ",");
+            printCount("host_cycles_per_instruction", counters, run.host_cycles / emulated, ",");
+            printCount("branch_misses_per_instruction", branch_misses.available(), run.branch_misses / emulated, ",");
+            std::printf("      \"state_hash\": \"%016llx\",\n", (unsigned long long)run.hash);
+            std::printf("      \"jammed\": %s\n", summary.jammed ? "true" : "false");
+            std::printf("    }");
+        }
+    }
+    std::printf("\n  ]\n}\n");
+    return ok;
+}
+
+//the suite's workloads on count consoles, each one a cpu of its own and then all of them as
+//lockstep lanes, for the same cycles. lanes start together, then again each a few instructions
+//apart so they sit at different code. independent cpus run through the interpreter like the
+//lanes do, and through the recompiler where there is one. every lane has to end where its cpu did
+static bool benchLanes(std::uint64_t cycles, std::size_t count){
+    bool same = true;
+    for(const Workload& workload : workloads){
+        for(int spread = 0; spread < 2; spread++){
+            double mips[2] = {0, 0};
+            std::vector<std::uint64_t> hashes(count);
+            for(int jit = 0; jit < (CPU::jitAvailable() ? 2 : 1); jit++){
+                std::uint64_t instructions = 0;
+                double seconds = 0;
+                for(std::size_t i = 0; i < count; i++){
+                    auto cpu = std::make_unique<CPU>();
+                    cpu->loadProgram(workload.program, workload.size, 0x0200);
+                    cpu->runHeadless(UINT64_MAX, spread * i * 3);
+                    cpu->setJit(jit == 1);
+                    RunSummary summary = cpu->runHeadless(cycles);
+                    instructions += summary.instructions;
+                    seconds += summary.seconds;
+                    same = same && (jit == 0 || hashes[i] == consoleHash(*cpu));
+                    hashes[i] = consoleHash(*cpu);
+                }
+                mips[jit] = instructions / seconds / 1e6;
+            }
+
+            LaneGroup lanes(count);
+            for(std::size_t i = 0; i < count; i++){
+                lanes.getLane(i).loadProgram(workload.program, workload.size, 0x0200);
+                lanes.getLane(i).runHeadless(UINT64_MAX, spread * i * 3);
+            }
+            LaneSummary summary = lanes.runHeadless(cycles);
+            bool lanes_same = true;
+            for(std::size_t i = 0; i < count; i++){
+                lanes_same = lanes_same && consoleHash(lanes.getLane(i)) == hashes[i];
+            }
+            same = same && lanes_same;
+            std::printf("%-14s %-8s independent %7.1f MIPS", workload.name, spread ? "spread" : "aligned", mips[0]);
+            if(CPU::jitAvailable()){
+                std::printf(", recompiled %7.1f MIPS", mips[1]);
+            }
+            std::printf(", lanes %7.1f MIPS (%.2fx), %5.1f%% grouped, %5.1f%% on vectors, %5.1f%% direct, %s\n", summary.mips,
+                        summary.mips / mips[0], 100.0 * summary.grouped / summary.instructions,
+                        100.0 * summary.vector / summary.instructions, 100.0 * summary.direct / summary.instructions, lanes_same ? "same state" : "STATE DIFFERS");
+        }
+    }
+    return same;
+}
+
+int main(int argc, char* argv[])
+{
+    std::string mode = argc > 1 ? argv[1] : "cpu";
+    if(mode == "cpu"){
+        benchCpu(argc > 2 ? std::stoull(argv[2]) : 200000000);
+    }else if(mode == "ppu"){
+        benchPpu(argc > 2 ? std::stoull(argv[2]) : 2000);
+    }else if(mode == "apu"){
+        benchApu(argc > 2 ? std::stoull(argv[2]) : 60);
+    }else if(mode == "state"){
+        benchState(argc > 2 ? std::stoull(argv[2]) : 1000000);
+    }else if(mode == "rewind"){
+        benchRewind(argc > 2 ? std::stoull(argv[2]) : 600);
+    }else if(mode == "jit"){
+        return benchJit(argc > 2 ? std::stoull(argv[2]) : 50000000) ? 0 : 1;
+    }else if(mode == "suite"){
+        return benchSuite(argc > 2 ? std::stoull(argv[2]) : 20000000, argc > 3 ? std::stoi(argv[3]) : 3) ? 0 : 1;
+    }else if(mode == "lanes"){
+        return benchLanes(argc > 2 ? std::stoull(argv[2]) : 2000000, argc > 3 ? std::stoull(argv[3]) : 64) ? 0 : 1;
+    }else{
+        std::cout<<"usage: bench [cpu|ppu|apu|state|rewind|jit|suite|lanes] [count] [repeats|lanes]"<<std::endl;
+        return 1;
+    }
+    return 0;
+}
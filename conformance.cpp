@@ -0,0 +1,1162 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "Batch.hpp"
+#include "CPU.hpp"
+#include "Disassembler.hpp"
+#include "Lanes.hpp"
+#include "Rewind.hpp"
+
+//conformance: checks the cpu against what it should do and stops at the first thing that differs
+//  nestest nestest.nes nestest.log     runs nestest in its automated mode from 0xc000 and compares
+//                                      the trace line by line with the golden log as it runs
+//  blargg rom.nes...                   runs blargg's test roms headlessly and reads their result
+//                                      from 0x6000
+//  random [seed] [programs]            runs random programs of official op codes on the cpu and on
+//                                      a plain reference 6502 and compares them after every instruction
+//  timing                              runs a hand checked trace of cycle counts on the cpu and on the
+//                                      reference, page crossings and branches included
+//  state                               saves and restores a running console in place, into a fresh
+//                                      cpu and with the recompiler, and feeds loadState damaged states
+//  rewind                              rewinds a running console through its snapshot history and
+//                                      checks it against a full save and against a fresh cpu
+//  jit                                 runs a self modifying loop in ram and the test cartridge through
+//                                      the interpreter and the recompiler and compares where they end
+//  lanes                               runs the test cartridge and the self modifying loop as lockstep
+//                                      lanes and as cpus of their own and compares where they end
+//  trace [trace.bin]                   dumps a wrapped trace ring to a file, reads it back with
+//                                      loadTrace and checks the records and their nestest.log text
+//the test roms and logs are not part of the repo, random and timing need nothing and the test target runs them
+static void usage(){
+    std::cout<<"usage: conformance nestest nestest.nes nestest.log"<<std::endl;
+    std::cout<<"       conformance blargg rom.nes..."<<std::endl;
+    std::cout<<"       conformance random [seed] [programs]"<<std::endl;
+    std::cout<<"       conformance timing"<<std::endl;
+    std::cout<<"       conformance state"<<std::endl;
+    std::cout<<"       conformance rewind"<<std::endl;
+    std::cout<<"       conformance jit"<<std::endl;
+    std::cout<<"       conformance lanes"<<std::endl;
+    std::cout<<"       conformance trace [trace.bin]"<<std::endl;
+}
+
+static std::shared_ptr<const Rom> openRom(const std::string& file_name){
+    std::shared_ptr<const Rom> rom;
+    RomError error = Rom::openShared(file_name, rom);
+    if(error != RomError::None){
+        std::cout<<"Error: "<<file_name<<": "<<romErrorString(error)<<std::endl;
+        return nullptr;
+    }
+    return rom;
+}
+
+//the part of a nestest.log line that is compared, the ppu column is left out since it depends
+//on how the logging emulator counted dots and not on the cpu
+static std::string withoutPpu(const std::string& line){
+    std::size_t ppu = line.find("PPU:");
+    std::size_t cyc = line.find("CYC:");
+    if(ppu == std::string::npos || cyc == std::string::npos || cyc < ppu){
+        return line;
+    }
+    return line.substr(0, ppu) + line.substr(cyc);
+}
+
+static int runNestest(const std::string& rom_file, const std::string& log_file){
+    std::shared_ptr<const Rom> rom = openRom(rom_file);
+    if(!rom){
+        return 1;
+    }
+    std::ifstream log(log_file);
+    if(!log.is_open()){
+        std::cout<<"Error: could not read "<<log_file<<std::endl;
+        return 1;
+    }
+    auto cpu = std::make_unique<CPU>();
+    cpu->load(rom);
+    TraceBuffer buffer(64);
+    if(!cpu->setTrace(&buffer, true)){
+        std::cout<<"Error: built with CPU_NO_TRACE, nestest needs the trace"<<std::endl;
+        return 1;
+    }
+    //the automated mode runs every test without the ppu and leaves the result in 0x02 and 0x03
+    cpu->setPC(0xc000);
+
+    std::vector<TraceRecord> records;
+    std::string expected;
+    std::size_t line = 0;
+    while(std::getline(log, expected)){
+        if(!expected.empty() && expected.back() == '\r'){
+            expected.pop_back();
+        }
+        if(expected.empty()){
+            continue;
+        }
+        line++;
+        //unofficial op codes are marked with a '*' before the mnemonic, the cpu jams on those
+        if(expected.size() > 15 && expected[15] == '*'){
+            std::cout<<"nestest: stopped at the first unofficial op code on line "<<line<<std::endl;
+            break;
+        }
+        buffer.clear();
+        cpu->step();
+        buffer.copyTo(records);
+        NestestWriter writer(records);
+        std::string got = records.empty() || records[0].kind != TRACE_INSTRUCTION ? "" : writer.format(0);
+        if(withoutPpu(got) != withoutPpu(expected)){
+            std::cout<<"nestest: line "<<line<<" differs"<<std::endl;
+            std::cout<<"expected: "<<expected<<std::endl;
+            std::cout<<"got:      "<<got<<std::endl;
+            return 1;
+        }
+    }
+    std::uint8_t official = cpu->getBus().read(0x0002);
+    std::uint8_t unofficial = cpu->getBus().read(0x0003);
+    std::printf("nestest: %zu lines match, result codes %02X %02X\n", line, official, unofficial);
+    return official == 0 ? 0 : 1;
+}
+
+#define BLARGG_RUNNING 0x80
+#define BLARGG_RESET 0x81           //wants the reset button pressed after at least 100ms
+#define BLARGG_MAX_FRAMES 60 * 60   //a minute of emulated time
+
+static int runBlargg(const std::string& rom_file){
+    std::shared_ptr<const Rom> rom = openRom(rom_file);
+    if(!rom){
+        return 1;
+    }
+    auto cpu = std::make_unique<CPU>();
+    cpu->load(rom);
+    Bus& bus = cpu->getBus();
+    //the result in 0x6000 only counts once the signature after it is there
+    auto has_signature = [&bus](){
+        return bus.read(0x6001) == 0xde && bus.read(0x6002) == 0xb0 && bus.read(0x6003) == 0x61;
+    };
+
+    int status = -1;
+    for(int frame = 0; frame < BLARGG_MAX_FRAMES; frame++){
+        RunSummary summary = cpu->runFrames(1);
+        if(summary.jammed){
+            std::printf("%s: jammed at %04X\n", rom_file.c_str(), cpu->getPC());
+            return 1;
+        }
+        if(!has_signature()){
+            continue;
+        }
+        std::uint8_t value = bus.read(0x6000);
+        if(value == BLARGG_RESET){
+            cpu->runFrames(6);
+            cpu->reset();
+        }else if(value != BLARGG_RUNNING){
+            status = value;
+            break;
+        }
+    }
+    if(status < 0){
+        std::printf("%s: no result after %d frames\n", rom_file.c_str(), BLARGG_MAX_FRAMES);
+        return 1;
+    }
+    std::string text;
+    for(std::uint16_t adress = 0x6004; adress < 0x7000; adress++){
+        char c = bus.read(adress);
+        if(c == 0){
+            break;
+        }
+        text += c;
+    }
+    while(!text.empty() && (text.back() == '\n' || text.back() == ' ')){
+        text.pop_back();
+    }
+    while(!text.empty() && text.front() == '\n'){
+        text.erase(0, 1);
+    }
+    std::printf("%s: %s (%d)\n%s\n", rom_file.c_str(), status == 0 ? "passed" : "FAILED", status, text.c_str());
+    return status == 0 ? 0 : 1;
+}
+
+//packs a mnemonic into a number, so the reference can switch on it
+constexpr std::uint32_t mnemonicCode(const char* mnemonic){
+    return (std::uint32_t)mnemonic[0] << 16 | (std::uint32_t)mnemonic[1] << 8 | (std::uint32_t)mnemonic[2];
+}
+
+//cycles of an official op code, from the data sheet's rules rather than from a table: the
+//addressing mode sets what reading the operand costs, stores always pay for the indexed page
+//fix up, read modify write ops add a read back and a write, taken branches are added by the caller
+static int referenceCycles(const OpInfo& info, bool crossed){
+    typedef AddressingMode M;
+    int base = 2;
+    switch(info.mode){
+        case M::ZeroPage: base = 3; break;
+        case M::ZeroPageX: case M::ZeroPageY: case M::Absolute: case M::AbsoluteX: case M::AbsoluteY: base = 4; break;
+        case M::IndirectX: base = 6; break;
+        case M::IndirectY: base = 5; break;
+        default: break;
+    }
+    bool indexed = info.mode == M::AbsoluteX || info.mode == M::AbsoluteY || info.mode == M::IndirectY;
+    switch(mnemonicCode(info.mnemonic)){
+        case mnemonicCode("STA"): case mnemonicCode("STX"): case mnemonicCode("STY"):
+            return base + indexed;
+        case mnemonicCode("ASL"): case mnemonicCode("LSR"): case mnemonicCode("ROL"):
+        case mnemonicCode("ROR"): case mnemonicCode("INC"): case mnemonicCode("DEC"):
+            return info.mode == M::Accumulator ? 2 : base + 2 + indexed;
+        case mnemonicCode("JMP"): return info.mode == M::Indirect ? 5 : 3;
+        case mnemonicCode("JSR"): case mnemonicCode("RTS"): case mnemonicCode("RTI"): return 6;
+        case mnemonicCode("BRK"): return 7;
+        case mnemonicCode("PHA"): case mnemonicCode("PHP"): return 3;
+        case mnemonicCode("PLA"): case mnemonicCode("PLP"): return 4;
+        //reads, only they pay for crossing a page
+        default: return base + crossed;
+    }
+}
+
+//a 6502 written straight from the data sheet, slow and simple, with the 2KB of ram only
+//leaving the ram is not modelled, the program under test ends there
+struct ReferenceCPU {
+    std::uint8_t a = 0;
+    std::uint8_t x = 0;
+    std::uint8_t y = 0;
+    std::uint8_t p = 0x24;
+    std::uint8_t sp = 0xfd;
+    std::uint16_t pc = 0;
+    std::uint64_t cycles = 0;
+    std::uint8_t ram[0x800];
+    bool left_ram = false;
+
+    std::uint8_t read(std::uint16_t adress){
+        if(adress >= 0x2000){
+            left_ram = true;
+            return 0;
+        }
+        return ram[adress & 0x7ff];
+    }
+
+    void write(std::uint16_t adress, std::uint8_t value){
+        if(adress >= 0x2000){
+            left_ram = true;
+            return;
+        }
+        ram[adress & 0x7ff] = value;
+    }
+
+    void setNZ(std::uint8_t value){
+        p = (p & 0x7d) | (value & 0x80) | (value == 0 ? 0x02 : 0);
+    }
+
+    void setCarry(bool carry){
+        p = (p & 0xfe) | (carry ? 0x01 : 0);
+    }
+
+    void push(std::uint8_t value){
+        write(0x100 + sp, value);
+        sp--;
+    }
+
+    std::uint8_t pull(){
+        sp++;
+        return read(0x100 + sp);
+    }
+
+    void add(std::uint8_t value){
+        unsigned sum = a + value + (p & 0x01);
+        bool overflow = !((a ^ value) & 0x80) && ((a ^ sum) & 0x80);
+        p = (p & 0xbf) | (overflow ? 0x40 : 0);
+        setCarry(sum > 0xff);
+        a = sum;
+        setNZ(a);
+    }
+
+    void compare(std::uint8_t reg, std::uint8_t value){
+        setCarry(reg >= value);
+        setNZ(reg - value);
+    }
+
+    void branch(bool taken, std::uint16_t target){
+        if(taken){
+            cycles += (pc ^ target) >> 8 ? 2 : 1;
+            pc = target;
+        }
+    }
+
+    //runs one instruction, false on op codes it does not know
+    bool step(){
+        typedef AddressingMode M;
+        std::uint8_t op_code = read(pc);
+        const OpInfo& info = OP_TABLE[op_code];
+        if(info.mnemonic[0] == '?'){
+            return false;
+        }
+        std::uint8_t low = read(pc + 1);
+        std::uint8_t high = read(pc + 2);
+        std::uint16_t word = low | high << 8;
+        std::uint16_t adress = 0;
+        bool crossed = false;
+        switch(info.mode){
+            case M::Immediate:
+                adress = pc + 1;
+                break;
+            case M::ZeroPage:
+                adress = low;
+                break;
+            case M::ZeroPageX:
+                adress = (std::uint8_t)(low + x);
+                break;
+            case M::ZeroPageY:
+                adress = (std::uint8_t)(low + y);
+                break;
+            case M::Absolute:
+                adress = word;
+                break;
+            case M::AbsoluteX:
+                adress = word + x;
+                crossed = (adress ^ word) >> 8;
+                break;
+            case M::AbsoluteY:
+                adress = word + y;
+                crossed = (adress ^ word) >> 8;
+                break;
+            case M::Indirect:
+                //the high byte comes from the same page
+                adress = read(word) | read((word & 0xff00) | ((word + 1) & 0xff)) << 8;
+                break;
+            case M::IndirectX:{
+                std::uint8_t pointer = low + x;
+                adress = read(pointer) | read((std::uint8_t)(pointer + 1)) << 8;
+                break;
+            }
+            case M::IndirectY:{
+                std::uint16_t base = read(low) | read((std::uint8_t)(low + 1)) << 8;
+                adress = base + y;
+                crossed = (adress ^ base) >> 8;
+                break;
+            }
+            case M::Relative:
+                adress = pc + 2 + (std::int8_t)low;
+                break;
+            default:
+                break;
+        }
+        cycles += referenceCycles(info, crossed);
+        pc += instructionLength(info.mode);
+
+        //read modify write ops work on the accumulator or on memory
+        auto modify = [&](auto operation){
+            if(info.mode == M::Accumulator){
+                a = operation(a);
+            }else{
+                write(adress, operation(read(adress)));
+            }
+        };
+        std::uint8_t carry = p & 0x01;
+        switch(mnemonicCode(info.mnemonic)){
+            case mnemonicCode("ADC"): add(read(adress)); break;
+            case mnemonicCode("SBC"): add(~read(adress)); break;
+            case mnemonicCode("AND"): a &= read(adress); setNZ(a); break;
+            case mnemonicCode("ORA"): a |= read(adress); setNZ(a); break;
+            case mnemonicCode("EOR"): a ^= read(adress); setNZ(a); break;
+            case mnemonicCode("LDA"): a = read(adress); setNZ(a); break;
+            case mnemonicCode("LDX"): x = read(adress); setNZ(x); break;
+            case mnemonicCode("LDY"): y = read(adress); setNZ(y); break;
+            case mnemonicCode("CMP"): compare(a, read(adress)); break;
+            case mnemonicCode("CPX"): compare(x, read(adress)); break;
+            case mnemonicCode("CPY"): compare(y, read(adress)); break;
+            case mnemonicCode("STA"): write(adress, a); break;
+            case mnemonicCode("STX"): write(adress, x); break;
+            case mnemonicCode("STY"): write(adress, y); break;
+            case mnemonicCode("BIT"):{
+                std::uint8_t value = read(adress);
+                p = (p & 0x3d) | (value & 0xc0) | ((value & a) == 0 ? 0x02 : 0);
+                break;
+            }
+            case mnemonicCode("ASL"):
+                modify([&](std::uint8_t value){ setCarry(value & 0x80); value <<= 1; setNZ(value); return value; });
+                break;
+            case mnemonicCode("LSR"):
+                modify([&](std::uint8_t value){ setCarry(value & 0x01); value >>= 1; setNZ(value); return value; });
+                break;
+            case mnemonicCode("ROL"):
+                modify([&](std::uint8_t value){ setCarry(value & 0x80); value = value << 1 | carry; setNZ(value); return value; });
+                break;
+            case mnemonicCode("ROR"):
+                modify([&](std::uint8_t value){ setCarry(value & 0x01); value = value >> 1 | carry << 7; setNZ(value); return value; });
+                break;
+            case mnemonicCode("INC"):
+                modify([&](std::uint8_t value){ value++; setNZ(value); return value; });
+                break;
+            case mnemonicCode("DEC"):
+                modify([&](std::uint8_t value){ value--; setNZ(value); return value; });
+                break;
+            case mnemonicCode("INX"): x++; setNZ(x); break;
+            case mnemonicCode("INY"): y++; setNZ(y); break;
+            case mnemonicCode("DEX"): x--; setNZ(x); break;
+            case mnemonicCode("DEY"): y--; setNZ(y); break;
+            case mnemonicCode("TAX"): x = a; setNZ(x); break;
+            case mnemonicCode("TAY"): y = a; setNZ(y); break;
+            case mnemonicCode("TXA"): a = x; setNZ(a); break;
+            case mnemonicCode("TYA"): a = y; setNZ(a); break;
+            case mnemonicCode("TSX"): x = sp; setNZ(x); break;
+            case mnemonicCode("TXS"): sp = x; break;
+            case mnemonicCode("CLC"): p &= ~0x01; break;
+            case mnemonicCode("SEC"): p |= 0x01; break;
+            case mnemonicCode("CLI"): p &= ~0x04; break;
+            case mnemonicCode("SEI"): p |= 0x04; break;
+            case mnemonicCode("CLV"): p &= ~0x40; break;
+            case mnemonicCode("CLD"): p &= ~0x08; break;
+            case mnemonicCode("SED"): p |= 0x08; break;
+            case mnemonicCode("NOP"): break;
+            case mnemonicCode("PHA"): push(a); break;
+            case mnemonicCode("PHP"): push(p | 0x30); break;
+            case mnemonicCode("PLA"): a = pull(); setNZ(a); break;
+            case mnemonicCode("PLP"): p = (pull() & 0xcf) | 0x20; break;
+            case mnemonicCode("JMP"): pc = adress; break;
+            case mnemonicCode("JSR"):
+                push((pc - 1) >> 8);
+                push(pc - 1);
+                pc = adress;
+                break;
+            case mnemonicCode("RTS"):{
+                std::uint16_t return_low = pull();
+                pc = (return_low | pull() << 8) + 1;
+                break;
+            }
+            case mnemonicCode("RTI"):{
+                p = (pull() & 0xcf) | 0x20;
+                std::uint16_t return_low = pull();
+                pc = return_low | pull() << 8;
+                break;
+            }
+            case mnemonicCode("BRK"):
+                push((pc + 1) >> 8);
+                push(pc + 1);
+                push(p | 0x30);
+                p |= 0x04;
+                pc = read(0xfffe) | read(0xffff) << 8;
+                break;
+            case mnemonicCode("BCC"): branch(!(p & 0x01), adress); break;
+            case mnemonicCode("BCS"): branch(p & 0x01, adress); break;
+            case mnemonicCode("BNE"): branch(!(p & 0x02), adress); break;
+            case mnemonicCode("BEQ"): branch(p & 0x02, adress); break;
+            case mnemonicCode("BPL"): branch(!(p & 0x80), adress); break;
+            case mnemonicCode("BMI"): branch(p & 0x80, adress); break;
+            case mnemonicCode("BVC"): branch(!(p & 0x40), adress); break;
+            case mnemonicCode("BVS"): branch(p & 0x40, adress); break;
+            default:
+                return false;
+        }
+        return true;
+    }
+};
+
+#define RANDOM_PROGRAM_STEPS 2000   //most programs leave the ram or hit a bad op code well before
+
+static int runRandom(unsigned seed, int programs){
+    std::mt19937 random(seed);
+    std::vector<std::uint8_t> op_codes;
+    for(int op_code = 0; op_code < 256; op_code++){
+        //brk would leave the ram through the vector right away
+        if(OP_TABLE[op_code].mnemonic[0] != '?' && op_code != 0x00){
+            op_codes.push_back(op_code);
+        }
+    }
+
+    std::uint64_t instructions = 0;
+    TraceBuffer buffer(64);
+    std::vector<TraceRecord> records;
+    for(int program = 0; program < programs; program++){
+        auto reference = std::make_unique<ReferenceCPU>();
+        std::uint8_t* ram = reference->ram;
+        //zero page and stack hold adresses that mostly stay in ram, code starts at 0x200
+        for(int i = 0; i < 0x200; i++){
+            ram[i] = random() & (i & 1 ? 0x07 : 0xff);
+        }
+        for(int i = 0x200; i < 0x7f0;){
+            std::uint8_t op_code = op_codes[random() % op_codes.size()];
+            AddressingMode mode = OP_TABLE[op_code].mode;
+            int length = instructionLength(mode);
+            ram[i] = op_code;
+            ram[i + 1] = mode == AddressingMode::Relative ? random() % 24 - 8 : random();
+            ram[i + 2] = random() & 0x07;
+            i += length;
+        }
+        for(int i = 0x7f0; i < 0x800; i++){
+            ram[i] = random();
+        }
+
+        auto cpu = std::make_unique<CPU>();
+        cpu->loadProgram(ram, 0x800, 0x0000);
+        cpu->setPC(0x200);
+        cpu->setTrace(&buffer, true);
+        Registers registers = cpu->getRegisters();
+        reference->a = registers.a;
+        reference->x = registers.x;
+        reference->y = registers.y;
+        reference->p = registers.p;
+        reference->sp = registers.sp;
+        reference->pc = registers.pc;
+        reference->cycles = cpu->getCycles();
+
+        for(int i = 0; i < RANDOM_PROGRAM_STEPS; i++){
+            if(!reference->step() || reference->left_ram){
+                break;
+            }
+            buffer.clear();
+            cpu->step();
+            instructions++;
+            registers = cpu->getRegisters();
+            bool same = registers.a == reference->a && registers.x == reference->x && registers.y == reference->y &&
+                        registers.p == reference->p && registers.sp == reference->sp && registers.pc == reference->pc &&
+                        cpu->getCycles() == reference->cycles &&
+                        std::memcmp(cpu->getBus().getRam(), reference->ram, 0x800) == 0;
+            if(!same){
+                buffer.copyTo(records);
+                NestestWriter writer(records);
+                std::printf("random: seed %u program %d instruction %d differs\n", seed, program, i);
+                if(!records.empty() && records[0].kind == TRACE_INSTRUCTION){
+                    std::printf("ran:      %s\n", writer.format(0).c_str());
+                }
+                std::printf("expected: A:%02X X:%02X Y:%02X P:%02X SP:%02X PC:%04X CYC:%llu\n", reference->a, reference->x,
+                            reference->y, reference->p, reference->sp, reference->pc, (unsigned long long)reference->cycles);
+                std::printf("got:      A:%02X X:%02X Y:%02X P:%02X SP:%02X PC:%04X CYC:%llu\n", registers.a, registers.x,
+                            registers.y, registers.p, registers.sp, registers.pc, (unsigned long long)cpu->getCycles());
+                for(int adress = 0; adress < 0x800; adress++){
+                    if(cpu->getBus().getRam()[adress] != reference->ram[adress]){
+                        std::printf("ram %04X: expected %02X got %02X\n", adress, reference->ram[adress],
+                                    cpu->getBus().getRam()[adress]);
+                        break;
+                    }
+                }
+                return 1;
+            }
+        }
+    }
+    std::printf("random: %d programs, %llu instructions match\n", programs, (unsigned long long)instructions);
+    return 0;
+}
+
+//a UxROM cartridge for the checks that need the whole console: the fixed bank sets up the ppu
+//and the apu, then loops copying what it finds at 0x8000 into ram and calling the subroutine
+//every bank has at 0xa000, while the nmi scrolls, starts sprite dma and retunes pulse 1. the
+//loop switches to the next PRG bank once a frame, so the subroutine gets hot before it changes
+//  0xc000  SEI
+//  0xc001  LDA #$0f, STA $4015     pulse 1 playing
+//  0xc006  LDA #$bf, STA $4000
+//  0xc00b  LDA #$00, STA $4003
+//  0xc010  ...                     both nametables get tiles 0-255, the palette 0-31, sprites 0x0200
+//  0xc044  LDA #$1e, STA $2001     rendering on
+//  0xc049  LDA #$80, STA $2000     nmi on
+//  0xc04e  INC $10
+//  0xc050  LDA $11                 frames so far
+//  0xc052  AND #$03
+//  0xc054  STA $8000               bank switch, a new bank once a frame
+//  0xc057  LDA $8000
+//  0xc05a  LDX $10
+//  0xc05c  STA $0300,X
+//  0xc05f  JSR $a000               into the bank just switched in
+//  0xc062  JMP $c04e
+//  0xc065  PHA                     nmi
+//  0xc066  LDA #$02, STA $4014
+//  0xc06b  INC $11
+//  0xc06d  LDA $11
+//  0xc06f  STA $2005, STA $2005
+//  0xc075  STA $4002
+//  0xc078  PLA
+//  0xc079  RTI
+//every bank:
+//  0xa000  LDA #bank
+//  0xa002  ORA $12
+//  0xa004  ASL A                   LSR A in the odd banks
+//  0xa005  STA $12
+//  0xa007  RTS
+static const std::uint8_t console_program[] = {
+    0x78,
+    0xa9, 0x0f, 0x8d, 0x15, 0x40,
+    0xa9, 0xbf, 0x8d, 0x00, 0x40,
+    0xa9, 0x00, 0x8d, 0x03, 0x40,
+    0xa9, 0x20, 0x8d, 0x06, 0x20,
+    0xa9, 0x00, 0x8d, 0x06, 0x20,
+    0xa0, 0x08, 0xa2, 0x00, 0x8e, 0x07, 0x20, 0xe8, 0xd0, 0xfa, 0x88, 0xd0, 0xf7,
+    0xa9, 0x3f, 0x8d, 0x06, 0x20,
+    0xa9, 0x00, 0x8d, 0x06, 0x20,
+    0xa2, 0x00, 0x8e, 0x07, 0x20, 0xe8, 0xe0, 0x20, 0xd0, 0xf8,
+    0xa2, 0x00, 0x8a, 0x9d, 0x00, 0x02, 0xe8, 0xd0, 0xf9,
+    0xa9, 0x1e, 0x8d, 0x01, 0x20,
+    0xa9, 0x80, 0x8d, 0x00, 0x20,
+    0xe6, 0x10, 0xa5, 0x11, 0x29, 0x03, 0x8d, 0x00, 0x80, 0xad, 0x00, 0x80,
+    0xa6, 0x10, 0x9d, 0x00, 0x03, 0x20, 0x00, 0xa0, 0x4c, 0x4e, 0xc0,
+    0x48, 0xa9, 0x02, 0x8d, 0x14, 0x40, 0xe6, 0x11, 0xa5, 0x11,
+    0x8d, 0x05, 0x20, 0x8d, 0x05, 0x20, 0x8d, 0x02, 0x40, 0x68, 0x40
+};
+
+#define CONSOLE_NMI 0xc065
+
+//four 16KB PRG banks starting with their number and with their subroutine at 0x2000,
+//console_program in the last one, and 8KB of pseudo random CHR
+static std::vector<std::uint8_t> makeConsoleImage(){
+    const std::size_t bank_size = 16 * 1024;
+    std::vector<std::uint8_t> image(16 + 4 * bank_size + 8 * 1024, 0);
+    const std::uint8_t header[] = {'N', 'E', 'S', 0x1a, 4, 1, 0x20};
+    std::copy(header, header + sizeof(header), image.begin());
+    std::uint32_t seed = 12345;
+    for(std::size_t i = 16; i < image.size(); i++){
+        seed = seed * 1103515245 + 12345;
+        image[i] = seed >> 16;
+    }
+    for(int bank = 0; bank < 4; bank++){
+        std::uint8_t* start = image.data() + 16 + bank * bank_size;
+        const std::uint8_t subroutine[] = {0xa9, (std::uint8_t)bank, 0x05, 0x12, (std::uint8_t)(bank & 1 ? 0x4a : 0x0a),
+                                          0x85, 0x12, 0x60};
+        start[0] = bank;
+        std::copy(subroutine, subroutine + sizeof(subroutine), start + 0x2000);
+    }
+    std::uint8_t* fixed = image.data() + 16 + 3 * bank_size;
+    std::copy(console_program, console_program + sizeof(console_program), fixed);
+    const std::uint8_t vectors[] = {CONSOLE_NMI & 0xff, CONSOLE_NMI >> 8, 0x00, 0xc0, 0x00, 0xc0};
+    std::copy(vectors, vectors + sizeof(vectors), fixed + 0x3ffa);
+    return image;
+}
+
+static std::unique_ptr<CPU> powerOn(const std::vector<std::uint8_t>& image, bool jit){
+    auto cpu = std::make_unique<CPU>();
+    RomError error = cpu->load(image.data(), image.size());
+    if(error != RomError::None){
+        std::cout<<"Error: test cartridge: "<<romErrorString(error)<<std::endl;
+        return nullptr;
+    }
+    if(jit && !cpu->setJit(true)){
+        std::cout<<"Error: no executable memory for the recompiler"<<std::endl;
+        return nullptr;
+    }
+    return cpu;
+}
+
+//prints what went wrong when ok is false
+static bool expect(bool ok, const char* mode, const std::string& what){
+    if(!ok){
+        std::printf("%s: %s\n", mode, what.c_str());
+    }
+    return ok;
+}
+
+//a hand checked trace for the timing rules, independent of both cpus: every op runs at pc and
+//takes cycles, page crossings and branches included. registers come from the ops before it,
+//X is 0xff and Y is 1 until the INX, 0x20 points at 0x03ff and 0x30 at 0x0270
+struct TimingStep {
+    std::uint16_t pc;
+    std::uint8_t bytes[3];
+    std::uint8_t cycles;
+};
+
+static const TimingStep timing_trace[] = {
+    {0x0200, {0xa2, 0xff}, 2},          //LDX #$ff
+    {0x0202, {0xa0, 0x01}, 2},          //LDY #$01
+    {0x0204, {0xa9, 0xff}, 2},          //LDA #$ff
+    {0x0206, {0x85, 0x20}, 3},          //STA $20
+    {0x0208, {0xa9, 0x03}, 2},          //LDA #$03
+    {0x020a, {0x85, 0x21}, 3},          //STA $21
+    {0x020c, {0xa9, 0x70}, 2},          //LDA #$70
+    {0x020e, {0x85, 0x30}, 3},          //STA $30
+    {0x0210, {0xa9, 0x02}, 2},          //LDA #$02
+    {0x0212, {0x8d, 0x31, 0x00}, 4},    //STA $0031
+    {0x0215, {0xbd, 0x01, 0x03}, 5},    //LDA $0301,X     crosses into 0x0400
+    {0x0218, {0xbd, 0x00, 0x03}, 4},    //LDA $0300,X
+    {0x021b, {0xb9, 0xff, 0x03}, 5},    //LDA $03ff,Y     crosses
+    {0x021e, {0xb9, 0x00, 0x03}, 4},    //LDA $0300,Y
+    {0x0221, {0xb1, 0x20}, 6},          //LDA ($20),Y     crosses
+    {0x0223, {0xa1, 0x21}, 6},          //LDA ($21,X)     the pointer wraps around to 0x20
+    {0x0225, {0xa5, 0x10}, 3},          //LDA $10
+    {0x0227, {0xb5, 0x11}, 4},          //LDA $11,X
+    {0x0229, {0xb6, 0x10}, 4},          //LDX $10,Y
+    {0x022b, {0xa2, 0xff}, 2},          //LDX #$ff
+    {0x022d, {0x9d, 0x00, 0x03}, 5},    //STA $0300,X     stores pay for the page fix up either way
+    {0x0230, {0x99, 0x00, 0x04}, 5},    //STA $0400,Y
+    {0x0233, {0x91, 0x20}, 6},          //STA ($20),Y
+    {0x0235, {0x81, 0x21}, 6},          //STA ($21,X)
+    {0x0237, {0x95, 0x11}, 4},          //STA $11,X
+    {0x0239, {0x86, 0x12}, 3},          //STX $12
+    {0x023b, {0x8c, 0x00, 0x03}, 4},    //STY $0300
+    {0x023e, {0x0a}, 2},                //ASL A
+    {0x023f, {0x06, 0x10}, 5},          //ASL $10
+    {0x0241, {0x36, 0x11}, 6},          //ROL $11,X
+    {0x0243, {0x4e, 0x00, 0x03}, 6},    //LSR $0300
+    {0x0246, {0x7e, 0x00, 0x03}, 7},    //ROR $0300,X
+    {0x0249, {0xfe, 0x01, 0x03}, 7},    //INC $0301,X     crossing costs nothing more
+    {0x024c, {0xce, 0x00, 0x03}, 6},    //DEC $0300
+    {0x024f, {0x2c, 0x00, 0x03}, 4},    //BIT $0300
+    {0x0252, {0x24, 0x10}, 3},          //BIT $10
+    {0x0254, {0xc9, 0x00}, 2},          //CMP #$00
+    {0x0256, {0xe4, 0x10}, 3},          //CPX $10
+    {0x0258, {0xcc, 0x00, 0x03}, 4},    //CPY $0300
+    {0x025b, {0x20, 0x80, 0x02}, 6},    //JSR $0280
+    {0x0280, {0x48}, 3},                //PHA
+    {0x0281, {0x08}, 3},                //PHP
+    {0x0282, {0x28}, 4},                //PLP
+    {0x0283, {0x68}, 4},                //PLA
+    {0x0284, {0x60}, 6},                //RTS
+    {0x025e, {0x6c, 0x30, 0x00}, 5},    //JMP ($0030)
+    {0x0270, {0xe8}, 2},                //INX             X is 0, Z set
+    {0x0271, {0xd0, 0x10}, 2},          //BNE             not taken
+    {0x0273, {0xf0, 0x00}, 3},          //BEQ             taken
+    {0x0275, {0x4c, 0xf0, 0x02}, 3},    //JMP $02f0
+    {0x02f0, {0xf0, 0x1e}, 4},          //BEQ             taken into the next page
+    {0x0310, {0xa9, 0x03}, 2},          //LDA #$03
+    {0x0312, {0x48}, 3},                //PHA
+    {0x0313, {0xa9, 0x20}, 2},          //LDA #$20
+    {0x0315, {0x48}, 3},                //PHA
+    {0x0316, {0x08}, 3},                //PHP
+    {0x0317, {0x40}, 6},                //RTI
+    {0x0320, {0xea}, 2}                 //NOP
+};
+
+//runs timing_trace on the cpu and on the reference, so the timing of both is held against
+//numbers neither of them produced
+static int runTiming(){
+    std::uint8_t ram[0x800] = {};
+    for(const TimingStep& step : timing_trace){
+        int length = instructionLength(OP_TABLE[step.bytes[0]].mode);
+        std::memcpy(ram + step.pc, step.bytes, length);
+    }
+    auto cpu = std::make_unique<CPU>();
+    cpu->loadProgram(ram, 0x800, 0x0000);
+    cpu->setPC(timing_trace[0].pc);
+    auto reference = std::make_unique<ReferenceCPU>();
+    std::memcpy(reference->ram, ram, 0x800);
+    Registers registers = cpu->getRegisters();
+    reference->p = registers.p;
+    reference->sp = registers.sp;
+    reference->pc = registers.pc;
+
+    int steps = 0;
+    for(const TimingStep& step : timing_trace){
+        std::uint64_t cpu_start = cpu->getCycles();
+        std::uint64_t reference_start = reference->cycles;
+        std::uint16_t cpu_pc = cpu->getPC();
+        std::uint16_t reference_pc = reference->pc;
+        cpu->step();
+        reference->step();
+        std::string where = "step " + std::to_string(steps) + " " + OP_TABLE[step.bytes[0]].mnemonic;
+        if(!expect(cpu_pc == step.pc && cpu->getCycles() - cpu_start == step.cycles, "timing", "cpu at " + where) ||
+           !expect(reference_pc == step.pc && reference->cycles - reference_start == step.cycles, "timing",
+                   "reference at " + where)){
+            std::printf("expected PC:%04X %d cycles, cpu PC:%04X %llu cycles, reference PC:%04X %llu cycles\n", step.pc,
+                        step.cycles, cpu_pc, (unsigned long long)(cpu->getCycles() - cpu_start), reference_pc,
+                        (unsigned long long)(reference->cycles - reference_start));
+            return 1;
+        }
+        steps++;
+    }
+    std::printf("timing: %d steps take the documented cycles\n", steps);
+    return 0;
+}
+
+#define STATE_FRAMES 30
+
+//a state with one header field changed
+static std::vector<std::uint8_t> patchHeader(std::vector<std::uint8_t> state, void (*patch)(StateHeader&)){
+    StateHeader header;
+    std::memcpy(&header, state.data(), sizeof(header));
+    patch(header);
+    std::memcpy(state.data(), &header, sizeof(header));
+    return state;
+}
+
+static int runState(){
+    std::vector<std::uint8_t> image = makeConsoleImage();
+    std::vector<std::uint8_t> saved;
+    std::vector<std::uint8_t> expected_state;
+    std::vector<std::uint8_t> state;
+    std::uint64_t expected_hash = 0;
+    for(int jit = 0; jit < 2; jit++){
+        if(jit == 1 && !CPU::jitAvailable()){
+            std::cout<<"state: recompiler not available on this host, interpreter only"<<std::endl;
+            break;
+        }
+        const char* name = jit == 1 ? "state (recompiler)" : "state";
+        std::unique_ptr<CPU> cpu = powerOn(image, jit == 1);
+        if(!cpu){
+            return 1;
+        }
+        cpu->runFrames(STATE_FRAMES);
+        cpu->saveState(state);
+        if(jit == 0){
+            saved = state;
+        }else if(!expect(state == saved, name, "saved state differs from the interpreter's")){
+            return 1;
+        }
+        cpu->runFrames(STATE_FRAMES);
+        if(jit == 0){
+            expected_hash = consoleHash(*cpu);
+            cpu->saveState(expected_state);
+        }else if(!expect(consoleHash(*cpu) == expected_hash, name, "ran to a different console than the interpreter")){
+            return 1;
+        }
+
+        //back in place over a console that ran on, then into one that never ran
+        std::unique_ptr<CPU> fresh = powerOn(image, jit == 1);
+        if(!fresh){
+            return 1;
+        }
+        CPU* targets[] = {cpu.get(), fresh.get()};
+        const char* target_names[] = {"in place", "into a fresh cpu"};
+        for(int target = 0; target < 2; target++){
+            CPU* restored = targets[target];
+            std::string where = target_names[target];
+            StateError error = restored->loadState(saved);
+            if(!expect(error == StateError::None, name, where + ": " + stateErrorString(error))){
+                return 1;
+            }
+            restored->saveState(state);
+            if(!expect(state == saved, name, where + ": saving again gives a different state")){
+                return 1;
+            }
+            restored->runFrames(STATE_FRAMES);
+            restored->saveState(state);
+            if(!expect(consoleHash(*restored) == expected_hash && state == expected_state, name,
+                       where + ": running on from the state ends somewhere else")){
+                return 1;
+            }
+        }
+    }
+
+    //damaged states are turned down without touching the console
+    std::vector<std::uint8_t> other_image = image;
+    other_image[16 + 0x100]++;
+    struct Damaged {
+        const char* what;
+        std::vector<std::uint8_t> state;
+        StateError error;
+    };
+    const Damaged damaged[] = {
+        {"wrong rom checksum", patchHeader(saved, [](StateHeader& header){ header.rom ^= 1; }), StateError::WrongRom},
+        {"wrong version", patchHeader(saved, [](StateHeader& header){ header.version++; }), StateError::BadVersion},
+        {"wrong magic", patchHeader(saved, [](StateHeader& header){ header.magic = 0; }), StateError::BadMagic},
+        {"truncated", std::vector<std::uint8_t>(saved.begin(), saved.end() - 1), StateError::BadSize},
+        {"truncated header", std::vector<std::uint8_t>(saved.begin(), saved.begin() + sizeof(StateHeader) - 1), StateError::TooSmall}
+    };
+    std::unique_ptr<CPU> cpu = powerOn(image, false);
+    std::unique_ptr<CPU> other = powerOn(other_image, false);
+    if(!cpu || !other){
+        return 1;
+    }
+    cpu->runFrames(STATE_FRAMES / 2);
+    std::vector<std::uint8_t> before;
+    cpu->saveState(before);
+    for(const Damaged& test : damaged){
+        StateError error = cpu->loadState(test.state);
+        if(!expect(error == test.error, "state", std::string(test.what) + ": got " + stateErrorString(error))){
+            return 1;
+        }
+        cpu->saveState(state);
+        if(!expect(state == before, "state", std::string(test.what) + ": the console changed")){
+            return 1;
+        }
+    }
+    StateError error = other->loadState(saved);
+    if(!expect(error == StateError::WrongRom, "state", std::string("another rom: got ") + stateErrorString(error))){
+        return 1;
+    }
+    std::printf("state: %zu byte state restores in place and into a fresh cpu%s, %zu damaged states turned down\n",
+                saved.size(), CPU::jitAvailable() ? ", with and without the recompiler" : "",
+                sizeof(damaged) / sizeof(damaged[0]) + 1);
+    return 0;
+}
+
+#define REWIND_FRAMES 100
+#define REWIND_RUN_ON 50
+
+//a snapshot every frame for twice REWIND_FRAMES, then back REWIND_FRAMES of them
+static int runRewind(){
+    std::vector<std::uint8_t> image = makeConsoleImage();
+    std::unique_ptr<CPU> cpu = powerOn(image, false);
+    std::unique_ptr<CPU> fresh = powerOn(image, false);
+    if(!cpu || !fresh){
+        return 1;
+    }
+    RewindBuffer history(2.0 * REWIND_FRAMES / REWIND_FRAME_RATE + 1, SIZE_MAX);
+    std::vector<std::uint8_t> expected_state;
+    for(int frame = 1; frame <= 2 * REWIND_FRAMES; frame++){
+        cpu->runFrames(1);
+        history.push(*cpu);
+        if(frame == REWIND_FRAMES){
+            cpu->saveState(expected_state);
+        }
+    }
+    std::size_t held = history.getMemoryUsed();
+
+    if(!expect(history.rewind(*cpu, REWIND_FRAMES), "rewind", "could not restore the snapshot")){
+        return 1;
+    }
+    std::vector<std::uint8_t> state;
+    cpu->saveState(state);
+    if(!expect(state == expected_state, "rewind", "the rewound console differs from a full save of that frame")){
+        return 1;
+    }
+    if(!expect(history.size() == REWIND_FRAMES, "rewind", "newer snapshots were kept")){
+        return 1;
+    }
+
+    cpu->runFrames(REWIND_RUN_ON);
+    fresh->runFrames(REWIND_FRAMES + REWIND_RUN_ON);
+    std::vector<std::uint8_t> fresh_state;
+    cpu->saveState(state);
+    fresh->saveState(fresh_state);
+    if(!expect(consoleHash(*cpu) == consoleHash(*fresh) && state == fresh_state, "rewind",
+               "running on from the rewound frame ends somewhere else than a fresh cpu")){
+        return 1;
+    }
+    std::printf("rewind: %d frames back in %zu bytes of history match a full save and a fresh cpu\n",
+                REWIND_FRAMES, held);
+    return 0;
+}
+
+//rewrites the operands of its own ADC and STA on every pass, so its decoded block goes stale every time
+//  0x0200  LDX #$00
+//  0x0202  INX
+//  0x0203  ADC #$01
+//  0x0205  STA $10
+//  0x0207  STX $0204
+//  0x020a  STX $0206
+//  0x020d  BNE $0202
+//  0x020f  JMP $0200
+static const std::uint8_t self_modifying_program[] = {
+    0xa2, 0x00, 0xe8, 0x69, 0x01, 0x85, 0x10, 0x8e, 0x04, 0x02, 0x8e, 0x06, 0x02, 0xd0, 0xf3,
+    0x4c, 0x00, 0x02
+};
+
+#define JIT_INSTRUCTIONS 1000000
+#define JIT_FRAMES 60
+
+static int runJit(){
+    if(!CPU::jitAvailable()){
+        std::cout<<"jit: recompiler not available in this build, nothing to check"<<std::endl;
+        return 0;
+    }
+    std::vector<std::uint8_t> image = makeConsoleImage();
+    const char* test_names[] = {"self modifying loop", "test cartridge"};
+    for(int test = 0; test < 2; test++){
+        std::uint64_t hashes[2];
+        std::vector<std::uint8_t> states[2];
+        for(int jit = 0; jit < 2; jit++){
+            std::unique_ptr<CPU> cpu;
+            if(test == 0){
+                cpu = std::make_unique<CPU>();
+                cpu->loadProgram(self_modifying_program, sizeof(self_modifying_program), 0x0200);
+                if(!cpu->setJit(jit == 1)){
+                    std::cout<<"Error: no executable memory for the recompiler"<<std::endl;
+                    return 1;
+                }
+                cpu->runHeadless(UINT64_MAX, JIT_INSTRUCTIONS);
+            }else{
+                cpu = powerOn(image, jit == 1);
+                if(!cpu){
+                    return 1;
+                }
+                cpu->runFrames(JIT_FRAMES);
+            }
+            hashes[jit] = consoleHash(*cpu);
+            cpu->saveState(states[jit]);
+        }
+        if(!expect(hashes[0] == hashes[1] && states[0] == states[1], "jit",
+                   std::string(test_names[test]) + ": the recompiler ends somewhere else than the interpreter")){
+            return 1;
+        }
+    }
+    std::printf("jit: recompiler matches the interpreter over %d instructions of self modifying code and %d frames\n",
+                JIT_INSTRUCTIONS, JIT_FRAMES);
+    return 0;
+}
+
+#define LANE_COUNT 40         //two full vectors and a partly filled one
+#define LANE_FRAMES 30
+#define LANE_CYCLES 200000
+
+//runs the test cartridge and the self modifying loop as lockstep lanes and every lane again as a
+//cpu of its own, they have to end in the same state. lanes start a few frames and instructions
+//apart, so at the same pc some of them have another bank switched in or other operands written
+//into their code than the block they would share
+static int runLanes(){
+    std::vector<std::uint8_t> image = makeConsoleImage();
+    std::shared_ptr<const Rom> rom;
+    RomError error = Rom::openShared(image.data(), image.size(), rom);
+    if(!expect(error == RomError::None, "lanes", "could not open the test cartridge")){
+        return 1;
+    }
+    const char* test_names[] = {"test cartridge", "self modifying loop"};
+    for(int test = 0; test < 2; test++){
+        LaneGroup lanes(LANE_COUNT);
+        std::vector<std::unique_ptr<CPU>> alone;
+        for(int i = 0; i < LANE_COUNT; i++){
+            alone.push_back(std::make_unique<CPU>());
+            for(CPU* cpu : {&lanes.getLane(i), alone.back().get()}){
+                if(test == 0){
+                    cpu->load(rom);
+                    cpu->runFrames(i % 5);
+                }else{
+                    cpu->loadProgram(self_modifying_program, sizeof(self_modifying_program), 0x0200);
+                }
+                cpu->runHeadless(UINT64_MAX, i / 5 * 3);
+            }
+        }
+        LaneSummary summary = test == 0 ? lanes.runFrames(LANE_FRAMES) : lanes.runHeadless(LANE_CYCLES);
+        std::uint64_t instructions = 0;
+        std::vector<std::uint8_t> expected_state;
+        std::vector<std::uint8_t> state;
+        for(int i = 0; i < LANE_COUNT; i++){
+            RunSummary run = test == 0 ? alone[i]->runFrames(LANE_FRAMES) : alone[i]->runHeadless(LANE_CYCLES);
+            instructions += run.instructions;
+            alone[i]->saveState(expected_state);
+            lanes.getLane(i).saveState(state);
+            if(!expect(state == expected_state && lanes.getLane(i).getPC() == alone[i]->getPC(), "lanes",
+                       std::string(test_names[test]) + ": lane " + std::to_string(i) + " ends somewhere else than a cpu of its own")){
+                return 1;
+            }
+        }
+        if(!expect(summary.instructions == instructions, "lanes", std::string(test_names[test]) + ": lanes ran " +
+                   std::to_string(summary.instructions) + " instructions instead of " + std::to_string(instructions)) ||
+           !expect(summary.vector > 0 && summary.direct > 0, "lanes",
+                   std::string(test_names[test]) + ": the lanes never ran together")){
+            return 1;
+        }
+        std::printf("lanes: %s, %d lanes match, %.1f%% of %llu instructions grouped, %.1f%% on vectors, %.1f%% direct\n",
+                    test_names[test], LANE_COUNT, 100.0 * summary.grouped / summary.instructions,
+                    (unsigned long long)summary.instructions, 100.0 * summary.vector / summary.instructions,
+                    100.0 * summary.direct / summary.instructions);
+    }
+    return 0;
+}
+
+#define TRACE_FRAMES 3
+#define TRACE_RING 4096     //small enough that the frames wrap it many times
+
+//nestest.log text of a trace, and how many lines it has
+static std::string traceText(const std::vector<TraceRecord>& records, std::size_t& lines){
+    std::ostringstream out;
+    NestestWriter writer(records);
+    lines = writer.write(out);
+    return out.str();
+}
+
+//one console traced whole and one into a small ring, the ring has to come back from its file
+//as the tail of the whole trace
+static int runTrace(const std::string& file_name){
+    if(!CPU::traceAvailable()){
+        std::cout<<"trace: built with CPU_NO_TRACE, nothing to check"<<std::endl;
+        return 0;
+    }
+    std::vector<std::uint8_t> image = makeConsoleImage();
+    std::unique_ptr<CPU> whole_cpu = powerOn(image, false);
+    std::unique_ptr<CPU> ring_cpu = powerOn(image, false);
+    if(!whole_cpu || !ring_cpu){
+        return 1;
+    }
+    TraceBuffer whole(1 << 20);
+    TraceBuffer ring(TRACE_RING);
+    whole_cpu->setTrace(&whole, true);
+    ring_cpu->setTrace(&ring, true);
+    RunSummary summary = whole_cpu->runFrames(TRACE_FRAMES);
+    ring_cpu->runFrames(TRACE_FRAMES);
+
+    std::vector<TraceRecord> expected;
+    whole.copyTo(expected);
+    if(!expect(whole.getWritten() == expected.size() && ring.getWritten() == expected.size() &&
+               expected.size() > TRACE_RING, "trace", "the traces did not record the same run")){
+        return 1;
+    }
+    std::size_t lines = 0;
+    std::string text = traceText(expected, lines);
+    if(!expect(lines == summary.instructions, "trace", "instruction lines do not match the instructions run") ||
+       !expect(text.compare(0, 18, "C000  78        SE") == 0, "trace", "the trace does not start at the reset vector")){
+        return 1;
+    }
+
+    if(!expect(ring.dump(file_name), "trace", "could not write " + file_name)){
+        return 1;
+    }
+    std::vector<TraceRecord> loaded;
+    bool read = loadTrace(file_name, loaded);
+    std::vector<TraceRecord> tail(expected.end() - TRACE_RING, expected.end());
+    if(!expect(read, "trace", "could not read back " + file_name) ||
+       !expect(loaded.size() == TRACE_RING &&
+               std::memcmp(loaded.data(), tail.data(), TRACE_RING * sizeof(TraceRecord)) == 0,
+               "trace", "the file does not hold the last records of the run")){
+        std::remove(file_name.c_str());
+        return 1;
+    }
+    std::size_t tail_lines = 0;
+    std::string tail_text = traceText(tail, tail_lines);
+    std::size_t loaded_lines = 0;
+    if(!expect(traceText(loaded, loaded_lines) == tail_text && loaded_lines == tail_lines && tail_lines > 0 &&
+               text.compare(text.size() - tail_text.size(), tail_text.size(), tail_text) == 0,
+               "trace", "the text of the file differs from the text of the whole trace")){
+        std::remove(file_name.c_str());
+        return 1;
+    }
+
+    //a file cut short is turned down instead of read as far as it goes
+    {
+        std::ifstream in(file_name, std::ios_base::binary);
+        std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        in.close();
+        std::ofstream out(file_name, std::ios_base::binary);
+        out.write(bytes.data(), bytes.size() - 1);
+    }
+    read = loadTrace(file_name, loaded);
+    std::remove(file_name.c_str());
+    if(!expect(!read, "trace", "a truncated file was read")){
+        return 1;
+    }
+    std::printf("trace: %zu of %zu records through %s, %zu nestest.log lines match\n", (std::size_t)TRACE_RING,
+                expected.size(), file_name.c_str(), tail_lines);
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    if(argc < 2){
+        usage();
+        return 1;
+    }
+    std::string mode = argv[1];
+    if(mode == "nestest" && argc == 4){
+        return runNestest(argv[2], argv[3]);
+    }
+    if(mode == "blargg" && argc > 2){
+        int failed = 0;
+        for(int i = 2; i < argc; i++){
+            failed += runBlargg(argv[i]);
+        }
+        if(argc > 3){
+            std::printf("%d of %d failed\n", failed, argc - 2);
+        }
+        return failed == 0 ? 0 : 1;
+    }
+    if(mode == "random" && argc <= 4){
+        unsigned seed = argc > 2 ? std::stoul(argv[2]) : 1;
+        int programs = argc > 3 ? std::stoi(argv[3]) : 2000;
+        return runRandom(seed, programs);
+    }
+    if(mode == "timing" && argc == 2){
+        return runTiming();
+    }
+    if(mode == "state" && argc == 2){
+        return runState();
+    }
+    if(mode == "rewind" && argc == 2){
+        return runRewind();
+    }
+    if(mode == "jit" && argc == 2){
+        return runJit();
+    }
+    if(mode == "lanes" && argc == 2){
+        return runLanes();
+    }
+    if(mode == "trace" && argc <= 3){
+        return runTrace(argc > 2 ? argv[2] : "conformance-trace.bin");
+    }
+    usage();
+    return 1;
+}
@@ -1,8 +1,86 @@
+#include <cstring>
 #include <iostream>
-#include "CPU.hpp"
+#include <memory>
+#include <string>
+#include "Batch.hpp"
 
+//nes: runs a rom headlessly on one console, with the inputs of a movie when one is given, and
+//prints how fast it went and the state hash it ended on. --trace keeps the last TRACE_RECORDS
+//instructions, and their reads and writes with --trace-memory, and writes them to a trace file
+//when the run ends or jams, trace2log turns it into text
+static void usage(){
+    std::cout<<"usage: nes [-k frames] [-m movie.fm2] [--jit] [--trace trace.bin [--trace-memory]] rom.nes"<<std::endl;
+}
+
+#define TRACE_RECORDS (1 << 20)
 
-int main()
+int main(int argc, char* argv[])
 {
+    BatchJob job = {};
+    std::string movie_file;
+    std::string rom_file;
+    std::string trace_file;
+    for(int i = 1; i < argc; i++){
+        bool has_value = i + 1 < argc;
+        if(std::strcmp(argv[i], "-k") == 0 && has_value){
+            job.frames = std::stoull(argv[++i]);
+        }else if(std::strcmp(argv[i], "-m") == 0 && has_value){
+            movie_file = argv[++i];
+        }else if(std::strcmp(argv[i], "--jit") == 0){
+            job.jit = true;
+        }else if(std::strcmp(argv[i], "--trace") == 0 && has_value){
+            trace_file = argv[++i];
+        }else if(std::strcmp(argv[i], "--trace-memory") == 0){
+            job.trace_memory = true;
+        }else if(argv[i][0] != '-' && rom_file.empty()){
+            rom_file = argv[i];
+        }else{
+            usage();
+            return 1;
+        }
+    }
+    if(rom_file.empty() || (job.trace_memory && trace_file.empty())){
+        usage();
+        return 1;
+    }
+    if(!trace_file.empty() && !CPU::traceAvailable()){
+        std::cout<<"Error: built with CPU_NO_TRACE, there is no trace to write"<<std::endl;
+        return 1;
+    }
+
+    RomError error = Rom::openShared(rom_file, job.rom);
+    if(error != RomError::None){
+        std::cout<<"Error: "<<rom_file<<": "<<romErrorString(error)<<std::endl;
+        return 1;
+    }
+    if(!movie_file.empty()){
+        auto movie = std::make_shared<Movie>();
+        if(!movie->load(movie_file)){
+            std::cout<<"Error: could not read "<<movie_file<<std::endl;
+            return 1;
+        }
+        job.movie = movie;
+    }
+    if(job.frames == 0){
+        job.frames = job.movie && job.movie->size() > 0 ? job.movie->size() : 3600;
+    }
+
+    std::unique_ptr<TraceBuffer> trace;
+    if(!trace_file.empty()){
+        trace = std::make_unique<TraceBuffer>(TRACE_RECORDS);
+        job.trace = trace.get();
+    }
+
+    BatchResult result = runJob(job);
+    std::cout<<result.frames<<" frames in "<<result.seconds<<" s, "<<result.frames / result.seconds<<" frames/s, "
+             <<result.instructions / result.seconds / 1e6<<" MIPS"<<(result.jammed ? ", jammed" : "")<<std::endl;
+    std::cout<<"state hash "<<std::hex<<result.hash<<std::dec<<std::endl;
+    if(trace){
+        if(!trace->dump(trace_file)){
+            std::cout<<"Error: could not write "<<trace_file<<std::endl;
+            return 1;
+        }
+        std::cout<<"trace: last "<<trace->size()<<" of "<<trace->getWritten()<<" records in "<<trace_file<<std::endl;
+    }
     return 0;
 }
@@ -0,0 +1,89 @@
+#define CPU_PROFILE
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include "CPU.hpp"
+#include "Movie.hpp"
+
+//nes-profile: runs a rom headlessly with the profiler on and prints where the guest spent its
+//cycles, by op code, by addressing mode and by adress. with -o the call stacks are written as
+//folded stacks for flamegraph.pl or speedscope. CPU_PROFILE is only defined here, every other
+//build of the cpu has no profiler in it
+static void usage(){
+    std::cout<<"usage: nes-profile [-k frames] [-m movie.fm2] [-t hot spots] [-o out.folded] rom.nes"<<std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    std::uint64_t frames = 0;
+    std::size_t hot_spots = 20;
+    std::string movie_file;
+    std::string folded_file;
+    std::string rom_file;
+    for(int i = 1; i < argc; i++){
+        bool has_value = i + 1 < argc;
+        if(std::strcmp(argv[i], "-k") == 0 && has_value){
+            frames = std::stoull(argv[++i]);
+        }else if(std::strcmp(argv[i], "-m") == 0 && has_value){
+            movie_file = argv[++i];
+        }else if(std::strcmp(argv[i], "-t") == 0 && has_value){
+            hot_spots = std::stoull(argv[++i]);
+        }else if(std::strcmp(argv[i], "-o") == 0 && has_value){
+            folded_file = argv[++i];
+        }else if(argv[i][0] != '-' && rom_file.empty()){
+            rom_file = argv[i];
+        }else{
+            usage();
+            return 1;
+        }
+    }
+    if(rom_file.empty()){
+        usage();
+        return 1;
+    }
+
+    auto cpu = std::make_unique<CPU>();
+    RomError error = cpu->load(rom_file);
+    if(error != RomError::None){
+        std::cout<<"Error: "<<rom_file<<": "<<romErrorString(error)<<std::endl;
+        return 1;
+    }
+    Movie movie;
+    if(!movie_file.empty() && !movie.load(movie_file)){
+        std::cout<<"Error: could not read "<<movie_file<<std::endl;
+        return 1;
+    }
+    if(frames == 0){
+        frames = movie.size() > 0 ? movie.size() : 600;
+    }
+
+    Profiler profiler(cpu->getRom().getPrgRom().size());
+    cpu->setProfiler(&profiler);
+    std::uint64_t ran = 0;
+    bool jammed = false;
+    for(; ran < frames && !jammed; ran++){
+        if(!movie_file.empty()){
+            cpu->setButtons(0, movie.getButtons(ran, 0));
+            cpu->setButtons(1, movie.getButtons(ran, 1));
+        }
+        jammed = cpu->runFrames(1).jammed;
+    }
+    cpu->setProfiler(nullptr);
+
+    std::cout<<rom_file<<": "<<ran<<" frames, "<<cpu->getCycles()<<" cycles"<<(jammed ? ", jammed" : "")<<std::endl;
+    profiler.writeReport(std::cout, hot_spots);
+    if(!folded_file.empty()){
+        std::ofstream out(folded_file);
+        if(!out.is_open()){
+            std::cout<<"Error: could not write "<<folded_file<<std::endl;
+            return 1;
+        }
+        profiler.writeFolded(out);
+        if(!out.good()){
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,31 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Disassembler.hpp"
+
+//trace2log: turns a trace file from TraceBuffer::dump into nestest.log text, on stdout or into a file
+int main(int argc, char* argv[])
+{
+    if(argc < 2 || argc > 3){
+        std::cout<<"usage: trace2log trace.bin [out.log]"<<std::endl;
+        return 1;
+    }
+    std::vector<TraceRecord> records;
+    if(!loadTrace(argv[1], records)){
+        std::cout<<"Error: "<<argv[1]<<" is not a readable trace file"<<std::endl;
+        return 1;
+    }
+    NestestWriter writer(records);
+    if(argc == 3){
+        std::ofstream out(argv[2]);
+        if(!out.is_open()){
+            std::cout<<"Error: could not write "<<argv[2]<<std::endl;
+            return 1;
+        }
+        writer.write(out);
+        return out.good() ? 0 : 1;
+    }
+    writer.write(std::cout);
+    return 0;
+}